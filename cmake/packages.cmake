@@ -35,6 +35,11 @@ include_directories(${Pangolin_INCLUDE_DIRS})
 find_package(yaml-cpp REQUIRED)
 include_directories(${yaml-cpp_INCLUDE_DIRS})
 
+# google benchmark, only for src/benchmarks
+if(BUILD_BENCHMARKS)
+    find_package(benchmark REQUIRED)
+endif()
+
 include_directories(${PROJECT_SOURCE_DIR}/thirdparty)
 
 set(third_party_libs
@@ -0,0 +1,153 @@
+#include "batch_manifest.h"
+
+#include <glog/logging.h>
+#include <fstream>
+#include <sstream>
+
+namespace imu_gps {
+
+namespace {
+
+bool ParseDouble(const std::string& value, double& result) {
+    try {
+        size_t pos = 0;
+        result = std::stod(value, &pos);
+        return pos == value.size();
+    } catch (...) {
+        return false;
+    }
+}
+
+bool ParseInt(const std::string& value, int& result) {
+    try {
+        size_t pos = 0;
+        result = std::stoi(value, &pos);
+        return pos == value.size();
+    } catch (...) {
+        return false;
+    }
+}
+
+bool ParseBool(const std::string& value, bool& result) {
+    if (value == "1" || value == "true") {
+        result = true;
+        return true;
+    }
+    if (value == "0" || value == "false") {
+        result = false;
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+bool SetReplayOption(GinsReplayOptions& options, const std::string& key, const std::string& value) {
+    auto& eskf = options.eskf_options_;
+    auto& init = options.init_options_;
+
+    // clang-format off
+    std::pair<const char*, double*> double_options[] = {
+        {"imu_dt", &eskf.imu_dt_},
+        {"gyro_var", &eskf.gyro_var_},
+        {"acce_var", &eskf.acce_var_},
+        {"bias_gyro_var", &eskf.bias_gyro_var_},
+        {"bias_acce_var", &eskf.bias_acce_var_},
+        {"odom_var", &eskf.odom_var_},
+        {"odom_span", &eskf.odom_span_},
+        {"wheel_radius", &eskf.wheel_radius_},
+        {"circle_pulse", &eskf.circle_pulse_},
+        {"gnss_pos_noise", &eskf.gnss_pos_noise_},
+        {"gnss_height_noise", &eskf.gnss_height_noise_},
+        {"gnss_ang_noise", &eskf.gnss_ang_noise_},
+        {"gnss_float_noise_scale", &eskf.gnss_float_noise_scale_},
+        {"gnss_pseudo_noise_scale", &eskf.gnss_pseudo_noise_scale_},
+        {"gnss_single_noise_scale", &eskf.gnss_single_noise_scale_},
+        {"gnss_gate_chi2", &eskf.gnss_gate_chi2_},
+        {"quit_eps", &eskf.quit_eps_},
+        {"init_time_seconds", &init.init_time_seconds_},
+        {"max_static_gyro_var", &init.max_static_gyro_var},
+        {"max_static_acce_var", &init.max_static_acce_var},
+        {"gravity_norm", &init.gravity_norm_},
+        {"antenna_angle", &options.antenna_angle_},
+        {"antenna_pos_x", &options.antenna_pos_[0]},
+        {"antenna_pos_y", &options.antenna_pos_[1]},
+    };
+    std::pair<const char*, bool*> bool_options[] = {
+        {"update_bias_gyro", &eskf.update_bias_gyro_},
+        {"update_bias_acce", &eskf.update_bias_acce_},
+        {"block_predict", &eskf.block_predict_},
+        {"use_speed_for_static_checking", &init.use_speed_for_static_checking_},
+        {"with_odom", &options.with_odom_},
+    };
+    std::pair<const char*, int*> int_options[] = {
+        {"cov_predict_interval", &eskf.cov_predict_interval_},
+        {"max_iterations", &eskf.max_iterations_},
+        {"init_imu_queue_max_size", &init.init_imu_queue_max_size_},
+        {"static_odom_pulse", &init.static_odom_pulse_},
+    };
+    // clang-format on
+
+    for (auto& [name, ptr] : double_options) {
+        if (key == name) {
+            return ParseDouble(value, *ptr);
+        }
+    }
+    for (auto& [name, ptr] : bool_options) {
+        if (key == name) {
+            return ParseBool(value, *ptr);
+        }
+    }
+    for (auto& [name, ptr] : int_options) {
+        if (key == name) {
+            return ParseInt(value, *ptr);
+        }
+    }
+    return false;
+}
+
+bool LoadBatchManifest(const std::string& manifest_path, std::vector<BatchRunSpec>& runs) {
+    std::ifstream fin(manifest_path);
+    if (!fin) {
+        LOG(ERROR) << "Unable to open manifest: " << manifest_path;
+        return false;
+    }
+
+    std::string line;
+    int line_no = 0;
+    while (std::getline(fin, line)) {
+        ++line_no;
+        std::stringstream ss(line);
+        BatchRunSpec spec;
+        if (!(ss >> spec.log_path_) || spec.log_path_[0] == '#') {
+            continue;
+        }
+        if (!(ss >> spec.output_path_)) {
+            LOG(ERROR) << manifest_path << ":" << line_no << ": missing output path";
+            return false;
+        }
+
+        std::string token;
+        while (ss >> token) {
+            auto eq = token.find('=');
+            if (eq == std::string::npos) {
+                spec.name_ = token;
+                continue;
+            }
+
+            if (!SetReplayOption(spec.options_, token.substr(0, eq), token.substr(eq + 1))) {
+                LOG(ERROR) << manifest_path << ":" << line_no << ": invalid option " << token;
+                return false;
+            }
+        }
+
+        if (spec.name_.empty()) {
+            spec.name_ = "run" + std::to_string(runs.size());
+        }
+        runs.emplace_back(std::move(spec));
+    }
+
+    return true;
+}
+
+}  // namespace imu_gps
@@ -0,0 +1,38 @@
+#ifndef IMU_GPS_BATCH_MANIFEST_H
+#define IMU_GPS_BATCH_MANIFEST_H
+
+#include "gins_replay.h"
+
+#include <string>
+#include <vector>
+
+namespace imu_gps {
+
+/// One entry of a batch manifest: a log file replayed with one option variant
+struct BatchRunSpec {
+    std::string log_path_;     // Input log (text or binary)
+    std::string output_path_;  // Trajectory output
+    std::string name_;         // Name shown in the summary
+    GinsReplayOptions options_;
+};
+
+/**
+ * Set a single replay option by name, e.g. "gyro_var=1e-5".
+ * Accepted keys are the ESKFOptions and StaticIMUInit::Options members (without the trailing underscore) plus
+ * with_odom, antenna_angle, antenna_pos_x and antenna_pos_y.
+ * @return false if the key is unknown or the value cannot be parsed
+ */
+bool SetReplayOption(GinsReplayOptions& options, const std::string& key, const std::string& value);
+
+/**
+ * Load a batch manifest.
+ * Each non-empty line that does not start with # describes one run:
+ *     <log_path> <output_path> [name] [key=value ...]
+ * The name defaults to "run<line index>". Paths are used as given.
+ * @return false if the file cannot be opened or a line is malformed
+ */
+bool LoadBatchManifest(const std::string& manifest_path, std::vector<BatchRunSpec>& runs);
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_BATCH_MANIFEST_H
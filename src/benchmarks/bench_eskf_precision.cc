@@ -0,0 +1,95 @@
+//
+// ESKFF against ESKFD: cost of the filter steps and accuracy of the float filter on the benchmark log.
+//
+// Counters (BM_ReplayLog only):
+//   gnss_rmse     RMS distance between predicted and observed GNSS positions over the log
+//   max_pos_diff  largest position difference to the ESKFD trajectory, in meters
+//   rms_pos_diff  RMS position difference to the ESKFD trajectory, in meters
+//   max_rot_diff  largest rotation difference to the ESKFD trajectory, in degrees
+//
+
+#include "benchmarks/bench_fixtures.h"
+#include "benchmarks/bench_log.h"
+#include "eskf.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+using namespace imu_gps;
+using bench::MakeFilter;
+using bench::SyntheticIMU;
+
+template <typename S>
+void BM_Predict(benchmark::State& state) {
+    ESKF<S> eskf = MakeFilter<S>();
+    const auto& samples = SyntheticIMU();
+
+    size_t i = 0;
+    double t = 0;
+    for (auto _ : state) {
+        IMU imu = samples[i++ % samples.size()];
+        t += 0.01;
+        imu.timestamp_ = t;
+        benchmark::DoNotOptimize(eskf.Predict(imu));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_Predict, double);
+BENCHMARK_TEMPLATE(BM_Predict, float);
+
+template <typename S>
+void BM_ObserveSE3(benchmark::State& state) {
+    ESKF<S> eskf = MakeFilter<S>();
+    const SE3 pose(SO3::exp(Vec3d(0.01, -0.02, 0.03)), Vec3d(0.1, 0.2, 0.3));
+
+    for (auto _ : state) {
+        // keep the covariance from collapsing so every iteration does the same work
+        eskf.SetCov(Eigen::Matrix<S, 18, 18>::Identity() * S(1e-2));
+        benchmark::DoNotOptimize(eskf.ObserveSE3(pose, 0.1, 1.0 * math::kDEG2RAD));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_ObserveSE3, double);
+BENCHMARK_TEMPLATE(BM_ObserveSE3, float);
+
+template <typename S>
+void BM_ReplayLog(benchmark::State& state) {
+    if (bench::BenchLog().empty()) {
+        state.SkipWithError("benchmark log is empty or missing, set IMU_GPS_BENCH_LOG");
+        return;
+    }
+
+    GinsReplayStats stats;
+    for (auto _ : state) {
+        stats = bench::ReplayBenchLog<ESKF<S>>(GinsReplayOptions());
+    }
+    state.SetItemsProcessed(state.iterations() * stats.num_predict_);
+
+    static const std::vector<NavStated> ref = [] {
+        std::vector<NavStated> states;
+        bench::ReplayBenchLog<ESKFD>(GinsReplayOptions(), &states);
+        return states;
+    }();
+    std::vector<NavStated> states;
+    bench::ReplayBenchLog<ESKF<S>>(GinsReplayOptions(), &states);
+
+    double max_pos = 0, sum_sq_pos = 0, max_rot = 0;
+    const size_t n = std::min(ref.size(), states.size());
+    for (size_t i = 0; i < n; ++i) {
+        const double dp = (ref[i].p_ - states[i].p_).norm();
+        max_pos = std::max(max_pos, dp);
+        sum_sq_pos += dp * dp;
+        max_rot = std::max(max_rot, (ref[i].R_.inverse() * states[i].R_).log().norm());
+    }
+    state.counters["gnss_rmse"] = stats.GnssRmse();
+    state.counters["max_pos_diff"] = max_pos;
+    state.counters["rms_pos_diff"] = n > 0 ? std::sqrt(sum_sq_pos / n) : 0;
+    state.counters["max_rot_diff"] = max_rot * math::kRAD2DEG;
+}
+BENCHMARK_TEMPLATE(BM_ReplayLog, double)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_ReplayLog, float)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
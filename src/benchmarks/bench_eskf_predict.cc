@@ -0,0 +1,114 @@
+//
+// ESKF prediction cost and accuracy, per-sample covariance propagation against the multi-rate
+// (pre-integrated) mode of ESKFOptions::cov_predict_interval_.
+//
+// Counters:
+//   cov_rel_err   relative Frobenius error of P after 1 s of 1 kHz IMU against propagating every sample
+//   pos_var_err   worst relative error of the position variances, same setting
+//   gnss_rmse     RMS distance between predicted and observed GNSS positions over the log
+//   max_pos_diff  largest position difference to the per-sample trajectory over the log, in meters
+//
+
+#include "benchmarks/bench_fixtures.h"
+#include "benchmarks/bench_log.h"
+#include "eskf.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+using namespace imu_gps;
+
+constexpr double kHighRateDt = 0.001;  // 1 kHz
+
+/// Faster rotations than bench::SyntheticIMU(), the pre-integration error grows with them
+const std::vector<IMU>& SyntheticIMU() {
+    static const std::vector<IMU> samples = bench::MakeSyntheticIMU(0.5);
+    return samples;
+}
+
+ESKFD MakeHighRateFilter(int interval) {
+    ESKFOptions options;
+    options.imu_dt_ = kHighRateDt;
+    options.cov_predict_interval_ = interval;
+    return bench::MakeFilter(options);
+}
+
+/// Covariance after one second of synthetic 1 kHz IMU
+Mat18d HighRateCov(int interval) {
+    ESKFD eskf = MakeHighRateFilter(interval);
+    const auto& samples = SyntheticIMU();
+    for (int i = 1; i <= 1000; ++i) {
+        IMU imu = samples[i];
+        imu.timestamp_ = i * kHighRateDt;
+        eskf.Predict(imu);
+    }
+    return eskf.GetCov();
+}
+
+void BM_PredictHighRate(benchmark::State& state) {
+    const int interval = state.range(0);
+    ESKFD eskf = MakeHighRateFilter(interval);
+    const auto& samples = SyntheticIMU();
+
+    size_t i = 0;
+    double t = 0;
+    for (auto _ : state) {
+        IMU imu = samples[i++ % samples.size()];
+        t += kHighRateDt;
+        imu.timestamp_ = t;
+        benchmark::DoNotOptimize(eskf.Predict(imu));
+    }
+    eskf.FlushCov();
+    benchmark::DoNotOptimize(eskf.GetCov());
+    state.SetItemsProcessed(state.iterations());
+
+    const Mat18d ref = HighRateCov(1);
+    const Mat18d cov = HighRateCov(interval);
+    state.counters["cov_rel_err"] = (cov - ref).norm() / ref.norm();
+    state.counters["pos_var_err"] =
+        ((cov.diagonal().head<3>() - ref.diagonal().head<3>()).array() / ref.diagonal().head<3>().array())
+            .abs()
+            .maxCoeff();
+}
+BENCHMARK(BM_PredictHighRate)->Arg(1)->Arg(2)->Arg(5)->Arg(10)->Arg(20)->Arg(50)->Arg(100)->Arg(1 << 30);
+
+GinsReplayStats ReplayLog(int interval, std::vector<NavStated>* states = nullptr) {
+    GinsReplayOptions options;
+    options.eskf_options_.cov_predict_interval_ = interval;
+    return bench::ReplayBenchLog(options, states);
+}
+
+void BM_ReplayLog(benchmark::State& state) {
+    const int interval = state.range(0);
+    if (bench::BenchLog().empty()) {
+        state.SkipWithError("benchmark log is empty or missing, set IMU_GPS_BENCH_LOG");
+        return;
+    }
+
+    GinsReplayStats stats;
+    for (auto _ : state) {
+        stats = ReplayLog(interval);
+    }
+    state.SetItemsProcessed(state.iterations() * stats.num_predict_);
+
+    static const std::vector<NavStated> ref = [] {
+        std::vector<NavStated> states;
+        ReplayLog(1, &states);
+        return states;
+    }();
+    std::vector<NavStated> states;
+    ReplayLog(interval, &states);
+
+    double max_diff = 0;
+    for (size_t i = 0; i < std::min(ref.size(), states.size()); ++i) {
+        max_diff = std::max(max_diff, (ref[i].p_ - states[i].p_).norm());
+    }
+    state.counters["gnss_rmse"] = stats.GnssRmse();
+    state.counters["max_pos_diff"] = max_diff;
+}
+BENCHMARK(BM_ReplayLog)->Arg(1)->Arg(2)->Arg(5)->Arg(10)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,43 @@
+#ifndef IMU_GPS_BENCH_FIXTURES_H
+#define IMU_GPS_BENCH_FIXTURES_H
+
+#include "common/eigen_types.h"
+#include "common/imu.h"
+#include "eskf.hpp"
+
+#include <random>
+#include <vector>
+
+namespace imu_gps::bench {
+
+/**
+ * Random-motion IMU readings around a level, static pose, timestamps are assigned by the caller
+ * @param gyro_sigma standard deviation of the angular rates, rad/s
+ */
+inline std::vector<IMU> MakeSyntheticIMU(double gyro_sigma) {
+    std::mt19937 rng(42);
+    std::normal_distribution<double> nd;
+    std::vector<IMU> result;
+    for (int i = 0; i < 4096; ++i) {
+        result.emplace_back(0, Vec3d(nd(rng), nd(rng), nd(rng)) * gyro_sigma, Vec3d(nd(rng), nd(rng), 9.8 + nd(rng)));
+    }
+    return result;
+}
+
+/// MakeSyntheticIMU(0.1), generated once
+inline const std::vector<IMU>& SyntheticIMU() {
+    static const std::vector<IMU> samples = MakeSyntheticIMU(0.1);
+    return samples;
+}
+
+/// A filter set up with small biases and level gravity, as after a static initialization
+template <typename S = double, typename L = ESKFLayout18>
+ESKF<S, L> MakeFilter(const ESKFOptions& options = ESKFOptions()) {
+    ESKF<S, L> eskf(options);
+    eskf.SetInitialConditions(options, Vec3d(1e-3, 2e-3, -1e-3), Vec3d(0.01, 0.02, 0.03), Vec3d(0, 0, -9.8));
+    return eskf;
+}
+
+}  // namespace imu_gps::bench
+
+#endif  // IMU_GPS_BENCH_FIXTURES_H
@@ -0,0 +1,521 @@
+//
+// Per-kernel throughput of the filter, initialization, conversion and IO code, items_per_second is samples/sec.
+//
+// Compare a run against a stored baseline with compare_baseline.py:
+//   ./bench_kernels --benchmark_out=current.json --benchmark_out_format=json
+//   python3 ../src/benchmarks/compare_baseline.py baseline.json current.json
+//
+
+#include "benchmarks/bench_fixtures.h"
+#include "benchmarks/bench_log.h"
+#include "common/math_utils.h"
+#include "common/pose_history.h"
+#include "eskf.hpp"
+#include "eskf_bank.hpp"
+#include "ieskf/ieskf.h"
+#include "imu_integration.h"
+#include "static_imu_init.h"
+#include "utm_convert.h"
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <random>
+
+namespace {
+
+using namespace imu_gps;
+using bench::MakeFilter;
+using bench::SyntheticIMU;
+
+constexpr double kImuDt = 0.01;  // 100 Hz, as in data/10.txt
+
+/// Readings of a vehicle standing still, quiet enough for StaticIMUInit's variance checks
+const std::vector<IMU>& StaticIMU() {
+    static const std::vector<IMU> samples = [] {
+        std::mt19937 rng(7);
+        std::normal_distribution<double> nd;
+        std::vector<IMU> result;
+        for (int i = 0; i < 4096; ++i) {
+            result.emplace_back(0, Vec3d(nd(rng), nd(rng), nd(rng)) * 0.01,
+                                Vec3d(0, 0, 9.81) + Vec3d(nd(rng), nd(rng), nd(rng)) * 0.05);
+        }
+        return result;
+    }();
+    return samples;
+}
+
+/// GNSS readings of the benchmark log, or synthetic ones around Beijing if the log is missing
+const std::vector<GNSS>& GnssReadings() {
+    static const std::vector<GNSS> readings = [] {
+        std::vector<GNSS> result;
+        for (const auto& event : bench::BenchLog()) {
+            if (const GNSS* gnss = std::get_if<GNSS>(&event)) {
+                result.emplace_back(*gnss);
+            }
+        }
+        if (result.empty()) {
+            std::mt19937 rng(42);
+            std::uniform_real_distribution<double> ud(-0.01, 0.01);
+            for (int i = 0; i < 1024; ++i) {
+                result.emplace_back(i, 4, Vec3d(40.0 + ud(rng), 116.0 + ud(rng), 50.0), 90.0 + ud(rng) * 100, true);
+            }
+        }
+        return result;
+    }();
+    return readings;
+}
+
+template <typename S>
+void BM_ESKFPredict(benchmark::State& state) {
+    ESKF<S> eskf = MakeFilter<S>();
+    const auto& samples = SyntheticIMU();
+
+    size_t i = 0;
+    double t = 0;
+    for (auto _ : state) {
+        IMU imu = samples[i++ % samples.size()];
+        t += kImuDt;
+        imu.timestamp_ = t;
+        benchmark::DoNotOptimize(eskf.Predict(imu));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_ESKFPredict, double);
+BENCHMARK_TEMPLATE(BM_ESKFPredict, float);
+
+/// Predict with a smaller error state, to compare with BM_ESKFPredict<double>
+template <typename L>
+void BM_ESKFPredictLayout(benchmark::State& state) {
+    ESKF<double, L> eskf = MakeFilter<double, L>();
+    const auto& samples = SyntheticIMU();
+
+    size_t i = 0;
+    double t = 0;
+    for (auto _ : state) {
+        IMU imu = samples[i++ % samples.size()];
+        t += kImuDt;
+        imu.timestamp_ = t;
+        benchmark::DoNotOptimize(eskf.Predict(imu));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_ESKFPredictLayout, ESKFLayout15);
+BENCHMARK_TEMPLATE(BM_ESKFPredictLayout, ESKFLayout9);
+
+template <typename S>
+void BM_ESKFObserveSE3(benchmark::State& state) {
+    ESKF<S> eskf = MakeFilter<S>();
+    const SE3 pose(SO3::exp(Vec3d(0.01, -0.02, 0.03)), Vec3d(0.1, 0.2, 0.3));
+    const Eigen::Matrix<S, 18, 18> cov = Eigen::Matrix<S, 18, 18>::Identity() * S(1e-2);
+
+    for (auto _ : state) {
+        // keep the covariance from collapsing so every iteration does the same work
+        eskf.SetCov(cov);
+        benchmark::DoNotOptimize(eskf.ObserveSE3(pose, 0.1, 1.0 * math::kDEG2RAD));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_ESKFObserveSE3, double);
+BENCHMARK_TEMPLATE(BM_ESKFObserveSE3, float);
+
+template <typename S>
+void BM_ESKFObserveWheelSpeed(benchmark::State& state) {
+    ESKF<S> eskf = MakeFilter<S>();
+    const Odom odom(0, 100, 102);
+    const Eigen::Matrix<S, 18, 18> cov = Eigen::Matrix<S, 18, 18>::Identity() * S(1e-2);
+
+    for (auto _ : state) {
+        eskf.SetCov(cov);
+        benchmark::DoNotOptimize(eskf.ObserveWheelSpeed(odom));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_ESKFObserveWheelSpeed, double);
+BENCHMARK_TEMPLATE(BM_ESKFObserveWheelSpeed, float);
+
+/// Iterated GNSS update off the current state, range(0) = iteration cap
+void BM_IESKFObserveSE3(benchmark::State& state) {
+    ESKFOptions options;
+    options.max_iterations_ = state.range(0);
+    IESKF ieskf(options);
+    ieskf.SetInitialConditions(options, Vec3d(1e-3, 2e-3, -1e-3), Vec3d(0.01, 0.02, 0.03), Vec3d(0, 0, -9.8));
+    const NavStated start = ieskf.GetNominalState();
+    const SE3 pose(SO3::exp(Vec3d(0.01, -0.02, 0.03)), Vec3d(0.1, 0.2, 0.3));
+    const Mat18d cov = Mat18d::Identity() * 1e-2;
+
+    for (auto _ : state) {
+        ieskf.SetX(start, Vec3d(0, 0, -9.8));
+        ieskf.SetCov(cov);
+        benchmark::DoNotOptimize(ieskf.ObserveSE3(pose, 0.1, 1.0 * math::kDEG2RAD));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IESKFObserveSE3)->Arg(1)->Arg(4);
+
+/// One ESKFBank::Predict of range(0) filters, items are filter-samples to compare with BM_ESKFPredict
+template <typename S>
+void BM_ESKFBankPredict(benchmark::State& state) {
+    std::vector<ESKFOptions> options(state.range(0));
+    ESKFBank<S> bank(options);
+    bank.SetInitialConditions(Vec3d(1e-3, 2e-3, -1e-3), Vec3d(0.01, 0.02, 0.03), Vec3d(0, 0, -9.8));
+    const auto& samples = SyntheticIMU();
+
+    size_t i = 0;
+    double t = 0;
+    for (auto _ : state) {
+        IMU imu = samples[i++ % samples.size()];
+        t += kImuDt;
+        imu.timestamp_ = t;
+        benchmark::DoNotOptimize(bank.Predict(imu));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_ESKFBankPredict, double)->Arg(8)->Arg(64);
+BENCHMARK_TEMPLATE(BM_ESKFBankPredict, float)->Arg(16)->Arg(64);
+
+void BM_IMUIntegrationAddIMU(benchmark::State& state) {
+    IMUIntegration integ(Vec3d(0, 0, -9.8), Vec3d::Zero(), Vec3d::Zero());
+    const auto& samples = SyntheticIMU();
+
+    size_t i = 0;
+    double t = 0;
+    for (auto _ : state) {
+        IMU imu = samples[i++ % samples.size()];
+        t += kImuDt;
+        imu.timestamp_ = t;
+        integ.AddIMU(imu);
+        benchmark::DoNotOptimize(integ.GetP());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IMUIntegrationAddIMU);
+
+/// The same readings through AddIMUs in batches of range(0)
+void BM_IMUIntegrationAddIMUs(benchmark::State& state) {
+    IMUIntegration integ(Vec3d(0, 0, -9.8), Vec3d::Zero(), Vec3d::Zero());
+    const size_t n = state.range(0);
+    std::vector<IMU> batch(SyntheticIMU().begin(), SyntheticIMU().begin() + n);
+
+    double t = 0;
+    for (auto _ : state) {
+        for (auto& imu : batch) {
+            t += kImuDt;
+            imu.timestamp_ = t;
+        }
+        integ.AddIMUs(batch.data(), batch.size());
+        benchmark::DoNotOptimize(integ.GetP());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_IMUIntegrationAddIMUs)->Arg(64)->Arg(1024);
+
+/// One TryInit over a full initialization window (AddIMU calls it once the window is longer than init_time_seconds_)
+void BM_StaticIMUInitTryInit(benchmark::State& state) {
+    StaticIMUInit::Options options;
+    const auto& samples = StaticIMU();
+    // fill the window up to just below init_time_seconds_, the timed sample crosses it
+    const int n = int(options.init_time_seconds_ / kImuDt) - 1;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        StaticIMUInit init(options);
+        init.AddOdom(Odom(0, 0, 0));
+        for (int i = 0; i < n; ++i) {
+            IMU imu = samples[i % samples.size()];
+            imu.timestamp_ = i * kImuDt;
+            init.AddIMU(imu);
+        }
+        IMU last = samples[n % samples.size()];
+        last.timestamp_ = options.init_time_seconds_ + kImuDt;
+        state.ResumeTiming();
+
+        init.AddIMU(last);
+        benchmark::DoNotOptimize(init.InitSuccess());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StaticIMUInitTryInit)->Unit(benchmark::kMicrosecond);
+
+void BM_ConvertGps2UTM(benchmark::State& state) {
+    const auto& readings = GnssReadings();
+    const Vec2d antenna_pos(-0.17, -0.20);
+    const double antenna_angle = 12.06;
+
+    size_t i = 0;
+    for (auto _ : state) {
+        GNSS gnss = readings[i++ % readings.size()];
+        benchmark::DoNotOptimize(ConvertGps2UTM(gnss, antenna_pos, antenna_angle));
+        benchmark::DoNotOptimize(gnss.utm_pose_);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ConvertGps2UTM);
+
+void BM_LatLon2UTM(benchmark::State& state) {
+    const auto& readings = GnssReadings();
+
+    size_t i = 0;
+    UTMCoordinate utm;
+    for (auto _ : state) {
+        const Vec3d& lla = readings[i++ % readings.size()].lat_lon_alt_;
+        benchmark::DoNotOptimize(LatLon2UTM(lla.head<2>(), utm));
+        benchmark::DoNotOptimize(utm);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LatLon2UTM);
+
+/// UtmProjector batch API over contiguous lat/lon arrays
+void BM_UtmProjectorBatch(benchmark::State& state) {
+    const auto& readings = GnssReadings();
+    std::vector<double> lat, lon;
+    for (const auto& gnss : readings) {
+        lat.emplace_back(gnss.lat_lon_alt_[0]);
+        lon.emplace_back(gnss.lat_lon_alt_[1]);
+    }
+    std::vector<double> easting(lat.size()), northing(lat.size());
+
+    const UtmProjector projector;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            projector.Project(lat.data(), lon.data(), lat.size(), easting.data(), northing.data()));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * lat.size());
+}
+BENCHMARK(BM_UtmProjectorBatch);
+
+/// Rotation increments of 100 Hz gyro readings, the last 64 being large rotations, one array per component
+template <typename S>
+const std::vector<std::vector<S>>& SO3Increments() {
+    static const std::vector<std::vector<S>> w = [] {
+        std::vector<std::vector<S>> result(3);
+        const auto& samples = SyntheticIMU();
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const Vec3d v = samples[i].gyro_ * (i + 64 >= samples.size() ? 20.0 : kImuDt);
+            for (int j = 0; j < 3; ++j) {
+                result[j].push_back(S(v[j]));
+            }
+        }
+        return result;
+    }();
+    return w;
+}
+
+/// Sophus::SO3::exp one increment at a time, the reference of SO3ExpBatch
+template <typename S>
+void BM_SO3Exp(benchmark::State& state) {
+    const auto& w = SO3Increments<S>();
+    const size_t n = w[0].size();
+    std::vector<S> q(4 * n);
+    for (auto _ : state) {
+        for (size_t i = 0; i < n; ++i) {
+            const Eigen::Quaternion<S> c =
+                Sophus::SO3<S>::exp(Eigen::Matrix<S, 3, 1>(w[0][i], w[1][i], w[2][i])).unit_quaternion();
+            q[4 * i] = c.w();
+            q[4 * i + 1] = c.x();
+            q[4 * i + 2] = c.y();
+            q[4 * i + 3] = c.z();
+        }
+        benchmark::DoNotOptimize(q.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK_TEMPLATE(BM_SO3Exp, double);
+BENCHMARK_TEMPLATE(BM_SO3Exp, float);
+
+/// math::SO3ExpBatch, max_err is the largest quaternion difference to Sophus::SO3::exp
+template <typename S>
+void BM_SO3ExpBatch(benchmark::State& state) {
+    const auto& w = SO3Increments<S>();
+    const size_t n = w[0].size();
+    std::vector<S> qw(n), qx(n), qy(n), qz(n);
+    for (auto _ : state) {
+        math::SO3ExpBatch(n, w[0].data(), w[1].data(), w[2].data(), qw.data(), qx.data(), qy.data(), qz.data());
+        benchmark::DoNotOptimize(qw.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+
+    double max_err = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const Eigen::Quaternion<S> q =
+            Sophus::SO3<S>::exp(Eigen::Matrix<S, 3, 1>(w[0][i], w[1][i], w[2][i])).unit_quaternion();
+        const Eigen::Matrix<S, 4, 1> d(q.w() - qw[i], q.x() - qx[i], q.y() - qy[i], q.z() - qz[i]);
+        max_err = std::max(max_err, double(d.norm()));
+    }
+    state.counters["max_err"] = max_err;
+}
+BENCHMARK_TEMPLATE(BM_SO3ExpBatch, double);
+BENCHMARK_TEMPLATE(BM_SO3ExpBatch, float);
+
+/// Sophus::SO3::log one rotation at a time, the reference of SO3LogBatch
+template <typename S>
+void BM_SO3Log(benchmark::State& state) {
+    const auto& w = SO3Increments<S>();
+    const size_t n = w[0].size();
+    std::vector<Sophus::SO3<S>> rotations;
+    for (size_t i = 0; i < n; ++i) {
+        rotations.push_back(Sophus::SO3<S>::exp(Eigen::Matrix<S, 3, 1>(w[0][i], w[1][i], w[2][i])));
+    }
+    std::vector<S> v(3 * n);
+    for (auto _ : state) {
+        for (size_t i = 0; i < n; ++i) {
+            const Eigen::Matrix<S, 3, 1> r = rotations[i].log();
+            v[3 * i] = r[0];
+            v[3 * i + 1] = r[1];
+            v[3 * i + 2] = r[2];
+        }
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK_TEMPLATE(BM_SO3Log, double);
+BENCHMARK_TEMPLATE(BM_SO3Log, float);
+
+/// math::SO3LogBatch, max_err is the largest rotation vector difference to Sophus::SO3::log
+template <typename S>
+void BM_SO3LogBatch(benchmark::State& state) {
+    const auto& w = SO3Increments<S>();
+    const size_t n = w[0].size();
+    std::vector<S> qw(n), qx(n), qy(n), qz(n), vx(n), vy(n), vz(n);
+    math::SO3ExpBatch(n, w[0].data(), w[1].data(), w[2].data(), qw.data(), qx.data(), qy.data(), qz.data());
+    for (auto _ : state) {
+        math::SO3LogBatch(n, qw.data(), qx.data(), qy.data(), qz.data(), vx.data(), vy.data(), vz.data());
+        benchmark::DoNotOptimize(vx.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+
+    double max_err = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const Eigen::Matrix<S, 3, 1> r =
+            Sophus::SO3<S>(Eigen::Quaternion<S>(qw[i], qx[i], qy[i], qz[i]).normalized()).log();
+        max_err = std::max(max_err, double((r - Eigen::Matrix<S, 3, 1>(vx[i], vy[i], vz[i])).norm()));
+    }
+    state.counters["max_err"] = max_err;
+}
+BENCHMARK_TEMPLATE(BM_SO3LogBatch, double);
+BENCHMARK_TEMPLATE(BM_SO3LogBatch, float);
+
+/// Interpolation in a time-sorted container of range(0) poses, 10 Hz
+void BM_PoseInterp(benchmark::State& state) {
+    using TimedPose = std::pair<double, SE3>;
+    const int n = state.range(0);
+    std::vector<TimedPose> poses;
+    for (int i = 0; i < n; ++i) {
+        poses.emplace_back(i * 0.1, SE3(SO3::exp(Vec3d(0, 0, 0.01 * i)), Vec3d(i, 0.5 * i, 0)));
+    }
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> ud(0.0, (n - 1) * 0.1);
+    std::vector<double> queries(1024);
+    for (auto& q : queries) {
+        q = ud(rng);
+    }
+
+    size_t i = 0;
+    SE3 result;
+    TimedPose best_match;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(math::PoseInterp<TimedPose>(
+            queries[i++ % queries.size()], poses, [](const TimedPose& p) { return p.first; },
+            [](const TimedPose& p) { return p.second; }, result, best_match));
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PoseInterp)->Arg(16)->Arg(256)->Arg(4096);
+
+/// Same queries against a PoseHistory of range(0) poses, bisection per query
+void BM_PoseHistoryInterp(benchmark::State& state) {
+    const int n = state.range(0);
+    PoseHistory history(n);
+    for (int i = 0; i < n; ++i) {
+        history.Push(i * 0.1, SE3(SO3::exp(Vec3d(0, 0, 0.01 * i)), Vec3d(i, 0.5 * i, 0)));
+    }
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> ud(0.0, (n - 1) * 0.1);
+    std::vector<double> queries(1024);
+    for (auto& q : queries) {
+        q = ud(rng);
+    }
+
+    size_t i = 0;
+    SE3 result;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(history.Interp(queries[i++ % queries.size()], result));
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PoseHistoryInterp)->Arg(16)->Arg(256)->Arg(4096);
+
+/// Batch of increasing query times at 100 Hz against 10 Hz poses, the cursor walk of InterpBatch
+void BM_PoseHistoryInterpBatch(benchmark::State& state) {
+    const int n = state.range(0);
+    PoseHistory history(n);
+    for (int i = 0; i < n; ++i) {
+        history.Push(i * 0.1, SE3(SO3::exp(Vec3d(0, 0, 0.01 * i)), Vec3d(i, 0.5 * i, 0)));
+    }
+
+    std::vector<double> queries;
+    for (double t = 0; t < (n - 1) * 0.1; t += 0.01) {
+        queries.emplace_back(t);
+    }
+    std::vector<SE3> results(queries.size());
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(history.InterpBatch(queries.data(), queries.size(), results.data()));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_PoseHistoryInterpBatch)->Arg(256)->Arg(4096);
+
+/// Parsing throughput of the benchmark log, items are records, bytes the file size
+void BM_TxtIOGo(benchmark::State& state) {
+    const std::string path = bench::BenchLogPath();
+    std::error_code ec;
+    const auto file_size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        state.SkipWithError("benchmark log is missing, set IMU_GPS_BENCH_LOG");
+        return;
+    }
+
+    size_t records = 0;
+    for (auto _ : state) {
+        records = 0;
+        TxtIO(path)
+            .SetIMUProcessFunc([&](const IMU&) { ++records; })
+            .SetOdomProcessFunc([&](const Odom&) { ++records; })
+            .SetGNSSProcessFunc([&](const GNSS&) { ++records; })
+            .Go();
+    }
+    state.SetItemsProcessed(state.iterations() * records);
+    state.SetBytesProcessed(state.iterations() * file_size);
+}
+BENCHMARK(BM_TxtIOGo)->Unit(benchmark::kMillisecond);
+
+/// BM_TxtIOGo with a visitor instead of the std::function callbacks, the difference is the per-record dispatch cost
+void BM_TxtIOGoVisitor(benchmark::State& state) {
+    const std::string path = bench::BenchLogPath();
+    std::error_code ec;
+    const auto file_size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        state.SkipWithError("benchmark log is missing, set IMU_GPS_BENCH_LOG");
+        return;
+    }
+
+    size_t records = 0;
+    for (auto _ : state) {
+        records = 0;
+        TxtIO(path).Go([&](const auto&) { ++records; });
+    }
+    state.SetItemsProcessed(state.iterations() * records);
+    state.SetBytesProcessed(state.iterations() * file_size);
+}
+BENCHMARK(BM_TxtIOGoVisitor)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,66 @@
+#ifndef IMU_GPS_BENCH_LOG_H
+#define IMU_GPS_BENCH_LOG_H
+
+#include "common/gnss.h"
+#include "common/imu.h"
+#include "common/io_utils.h"
+#include "common/odom.h"
+#include "gins_replay.h"
+
+#include <cstdlib>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace imu_gps::bench {
+
+/// One reading of a log, kept in log order
+using LogEvent = std::variant<IMU, Odom, GNSS>;
+
+/// Path of the log used by the replay benchmarks: $IMU_GPS_BENCH_LOG or ../data/10.txt
+inline std::string BenchLogPath() {
+    const char* path = std::getenv("IMU_GPS_BENCH_LOG");
+    return path ? path : "../data/10.txt";
+}
+
+/// Read the whole benchmark log into memory once, so that parsing is not part of the measurement
+inline const std::vector<LogEvent>& BenchLog() {
+    static const std::vector<LogEvent> events = [] {
+        std::vector<LogEvent> result;
+        TxtIO(BenchLogPath()).Go([&](const auto& reading) { result.emplace_back(reading); });
+        return result;
+    }();
+    return events;
+}
+
+/**
+ * Run the GINS flow of run_eskf_gins over the benchmark log
+ * @param states if not null, receives every published state
+ */
+template <typename Filter = ESKFD>
+GinsReplayStats ReplayBenchLog(const GinsReplayOptions& options, std::vector<NavStated>* states = nullptr) {
+    GinsReplay<Filter> replay(options);
+    if (states) {
+        replay.SetStateCallback([states](const NavStated& state) { states->emplace_back(state); });
+    }
+
+    for (const auto& event : BenchLog()) {
+        std::visit(
+            [&replay](const auto& reading) {
+                using T = std::decay_t<decltype(reading)>;
+                if constexpr (std::is_same_v<T, IMU>) {
+                    replay.AddIMU(reading);
+                } else if constexpr (std::is_same_v<T, Odom>) {
+                    replay.AddOdom(reading);
+                } else {
+                    replay.AddGNSS(reading);
+                }
+            },
+            event);
+    }
+    return replay.GetStats();
+}
+
+}  // namespace imu_gps::bench
+
+#endif  // IMU_GPS_BENCH_LOG_H
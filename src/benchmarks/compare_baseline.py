@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""Compare a google benchmark JSON result against a stored baseline.
+
+Usage: compare_baseline.py baseline.json current.json [--threshold 0.10]
+
+Benchmarks are matched by name and compared on items_per_second (samples/sec), or on real_time when a benchmark
+reports no throughput. Exits with 1 if any benchmark is slower than the baseline by more than the threshold.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    results = {}
+    for b in data.get("benchmarks", []):
+        # skip the mean/median/stddev rows of repeated runs, compare the plain iterations
+        if b.get("run_type", "iteration") != "iteration" or b.get("error_occurred"):
+            continue
+        results[b["name"]] = b
+    return results
+
+
+def speed(b):
+    """Higher is better: items per second, or the inverse of the real time"""
+    if "items_per_second" in b:
+        return b["items_per_second"], "items/s"
+    return 1.0 / b["real_time"], "1/" + b.get("time_unit", "ns")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.10, help="allowed relative slowdown (default 0.10)")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+
+    regressions = 0
+    print("%-48s %14s %14s %8s" % ("benchmark", "baseline", "current", "change"))
+    for name, b in current.items():
+        if name not in baseline:
+            print("%-48s %14s %14s %8s" % (name, "-", "new", ""))
+            continue
+        old, unit = speed(baseline[name])
+        new, _ = speed(b)
+        change = new / old - 1.0
+        flag = ""
+        if change < -args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-48s %14.4g %14.4g %+7.1f%%%s" % (name, old, new, change * 100, flag))
+    for name in baseline:
+        if name not in current:
+            print("%-48s %14s %14s %8s" % (name, "", "missing", ""))
+
+    if regressions:
+        print("%d benchmark(s) slower than the baseline by more than %.0f%%" % (regressions, args.threshold * 100))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
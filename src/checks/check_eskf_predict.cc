@@ -0,0 +1,79 @@
+//
+// ESKFOptions::block_predict_: PredictCovBlockwise against the dense F * P * F^T + Q of ESKF::Predict.
+//
+// For every state layout, and for float, two filters propagate the same synthetic IMU sequence from the same dense
+// covariance, one of them block-wise. Fails if the relative Frobenius difference of P exceeds the tolerance at any step.
+//
+
+#include "benchmarks/bench_fixtures.h"
+#include "eskf.hpp"
+
+#include <glog/logging.h>
+#include <algorithm>
+#include <random>
+
+namespace {
+
+using namespace imu_gps;
+
+constexpr int kNumSteps = 2000;  // 20 s at 100 Hz
+
+/// Random positive definite covariance, every block takes part from the first step
+template <typename CovT>
+CovT RandomCov() {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> ud(-1, 1);
+    Eigen::Matrix<double, CovT::RowsAtCompileTime, CovT::ColsAtCompileTime> A;
+    for (int i = 0; i < A.size(); ++i) {
+        A(i) = ud(rng);
+    }
+    return (A * A.transpose() * 1e-3 + decltype(A)::Identity() * 1e-4).template cast<typename CovT::Scalar>();
+}
+
+template <typename S, typename L>
+bool CheckBlockPredict(const char* name, double tolerance) {
+    ESKFOptions dense_options, block_options;
+    dense_options.block_predict_ = false;
+    block_options.block_predict_ = true;
+    ESKF<S, L> dense = bench::MakeFilter<S, L>(dense_options);
+    ESKF<S, L> block = bench::MakeFilter<S, L>(block_options);
+
+    const auto cov = RandomCov<typename ESKF<S, L>::CovT>();
+    dense.SetCov(cov);
+    block.SetCov(cov);
+
+    const auto& samples = bench::SyntheticIMU();
+    double max_err = 0;
+    int max_step = 0;
+    for (int i = 1; i <= kNumSteps; ++i) {
+        IMU imu = samples[i % samples.size()];
+        imu.timestamp_ = i * dense_options.imu_dt_;
+        dense.Predict(imu);
+        block.Predict(imu);
+
+        const auto expected = dense.GetCov().template cast<double>().eval();
+        const double err = (block.GetCov().template cast<double>() - expected).norm() / expected.norm();
+        if (!(err <= max_err)) {  // NaN is kept as well
+            max_err = err;
+            max_step = i;
+        }
+    }
+
+    const bool ok = max_err <= tolerance;
+    (ok ? LOG(INFO) : LOG(ERROR)) << name << ": max relative error " << max_err << " at step " << max_step << " of "
+                                  << kNumSteps << ", tolerance " << tolerance;
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_stderrthreshold = google::INFO;
+
+    bool ok = CheckBlockPredict<double, ESKFLayout18>("ESKFD", 1e-10);
+    ok &= CheckBlockPredict<double, ESKFLayout15>("ESKF15D", 1e-10);
+    ok &= CheckBlockPredict<double, ESKFLayout9>("ESKF9D", 1e-10);
+    ok &= CheckBlockPredict<float, ESKFLayout18>("ESKFF", 2e-5);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+#ifndef IMU_GPS_BATCH_POOL_H
+#define IMU_GPS_BATCH_POOL_H
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace imu_gps {
+
+/**
+ * Free list of batch buffers shared by the stages of a pipeline.
+ *
+ * A stage takes an empty batch with Acquire(), fills it and hands it downstream, and the last stage gives it back with
+ * Release(). Released batches keep their capacity, so once as many batches as a pipeline holds in flight (bounded by
+ * its queue depths) have been created, the readings travel without any heap allocation.
+ * The counters tell how many batches were ever allocated, a steady run stops increasing them after warm-up.
+ *
+ * Acquire() and Release() take a lock, they are called once per batch.
+ */
+template <typename T>
+class BatchPool {
+   public:
+    /// Counters of the pool
+    struct Stats {
+        size_t num_allocated_ = 0;  // Batches created, each with one allocation of batch_size elements
+        size_t num_reused_ = 0;     // Acquire() calls served from the free list
+    };
+
+    explicit BatchPool(size_t batch_size) : batch_size_(batch_size > 0 ? batch_size : 1) {}
+
+    BatchPool(const BatchPool&) = delete;
+    BatchPool& operator=(const BatchPool&) = delete;
+
+    /// An empty batch with room for batch_size elements
+    std::vector<T> Acquire() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!free_.empty()) {
+            std::vector<T> batch = std::move(free_.back());
+            free_.pop_back();
+            ++stats_.num_reused_;
+            return batch;
+        }
+
+        ++stats_.num_allocated_;
+        std::vector<T> batch;
+        batch.reserve(batch_size_);
+        return batch;
+    }
+
+    /// Return a batch to the pool, its elements are destroyed and its storage kept
+    void Release(std::vector<T>&& batch) {
+        if (batch.capacity() == 0) {
+            return;  // moved-from, nothing to keep
+        }
+        batch.clear();
+        std::lock_guard<std::mutex> lock(mtx_);
+        free_.emplace_back(std::move(batch));
+    }
+
+    Stats GetStats() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return stats_;
+    }
+
+    size_t BatchSize() const { return batch_size_; }
+
+   private:
+    const size_t batch_size_;
+    std::vector<std::vector<T>> free_;
+    Stats stats_;
+    mutable std::mutex mtx_;
+};
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_BATCH_POOL_H
@@ -0,0 +1,113 @@
+#include "common/bin_log.h"
+
+#include <glog/logging.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace imu_gps::binlog {
+
+bool IsBinLog(const char* data, size_t size) {
+    return size >= sizeof(FileHeader) && std::memcmp(data, kMagic, sizeof(kMagic)) == 0;
+}
+
+bool BinLogWriter::Open(const std::string& file_path) {
+    Close();
+
+    fp_ = std::fopen(file_path.c_str(), "wb");
+    if (fp_ == nullptr) {
+        LOG(ERROR) << "Failed to open file: " << file_path;
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic_, kMagic, sizeof(kMagic));
+    std::fwrite(&header, sizeof(header), 1, fp_);
+
+    offset_ = sizeof(header);
+    num_records_ = 0;
+    index_.clear();
+    block_min_time_.clear();
+    max_time_ = std::numeric_limits<double>::lowest();
+    return true;
+}
+
+void BinLogWriter::Write(const IMU& imu) {
+    IMURecord r;
+    r.timestamp_ = imu.timestamp_;
+    std::copy_n(imu.gyro_.data(), 3, r.gyro_);
+    std::copy_n(imu.acce_.data(), 3, r.acce_);
+    AddRecord(&r, sizeof(r), r.timestamp_);
+}
+
+void BinLogWriter::Write(const Odom& odom) {
+    OdomRecord r;
+    r.timestamp_ = odom.timestamp_;
+    r.left_pulse_ = odom.left_pulse_;
+    r.right_pulse_ = odom.right_pulse_;
+    AddRecord(&r, sizeof(r), r.timestamp_);
+}
+
+void BinLogWriter::Write(const GNSS& gnss) {
+    GNSSRecord r;
+    r.unix_time_ = gnss.unix_time_;
+    std::copy_n(gnss.lat_lon_alt_.data(), 3, r.lat_lon_alt_);
+    r.heading_ = gnss.heading_;
+    r.status_ = static_cast<int8_t>(gnss.status_);
+    r.heading_valid_ = gnss.heading_valid_ ? 1 : 0;
+    AddRecord(&r, sizeof(r), r.unix_time_);
+}
+
+void BinLogWriter::AddRecord(const void* record, size_t size, double timestamp) {
+    if (fp_ == nullptr) {
+        return;
+    }
+
+    if (num_records_ % kIndexBlockSize == 0) {
+        index_.push_back({offset_, 0, 0});
+        block_min_time_.push_back(std::numeric_limits<double>::max());
+    }
+
+    max_time_ = std::max(max_time_, timestamp);
+    index_.back().max_time_ = max_time_;
+    block_min_time_.back() = std::min(block_min_time_.back(), timestamp);
+
+    std::fwrite(record, size, 1, fp_);
+    offset_ += size;
+    ++num_records_;
+}
+
+bool BinLogWriter::Close() {
+    if (fp_ == nullptr) {
+        return false;
+    }
+
+    // Suffix minimum of the block minimum times
+    double suffix_min = std::numeric_limits<double>::max();
+    for (int i = int(index_.size()) - 1; i >= 0; --i) {
+        suffix_min = std::min(suffix_min, block_min_time_[i]);
+        index_[i].suffix_min_ = suffix_min;
+    }
+
+    FileFooter footer;
+    footer.index_offset_ = offset_;
+    footer.index_count_ = index_.size();
+    footer.num_records_ = num_records_;
+    std::memcpy(footer.magic_, kMagic, sizeof(kMagic));
+
+    if (!index_.empty()) {
+        std::fwrite(index_.data(), sizeof(IndexEntry), index_.size(), fp_);
+    }
+    std::fwrite(&footer, sizeof(footer), 1, fp_);
+
+    bool ok = std::ferror(fp_) == 0;
+    std::fclose(fp_);
+    fp_ = nullptr;
+
+    if (!ok) {
+        LOG(ERROR) << "Error while writing the binary log.";
+    }
+    return ok;
+}
+
+}  // namespace imu_gps::binlog
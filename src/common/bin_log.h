@@ -0,0 +1,136 @@
+#ifndef IMU_GPS_BIN_LOG_H
+#define IMU_GPS_BIN_LOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "common/gnss.h"
+#include "common/imu.h"
+#include "common/odom.h"
+
+/**
+ * Binary sensor log container.
+ *
+ * Layout (little endian, no padding):
+ *   FileHeader
+ *   records ...            fixed-size IMURecord / OdomRecord / GNSSRecord, in the original log order
+ *   IndexEntry[index_count] one entry per block of kIndexBlockSize records
+ *   FileFooter
+ *
+ * Each index entry stores the running maximum timestamp up to the end of its block and the minimum timestamp from
+ * its block to the end of the file. Both are monotonic even if the sensors are slightly out of order in the log, so
+ * a time window [start, end] can be located by binary search: blocks whose running max is below start are skipped,
+ * and reading stops at the first block whose suffix min is above end.
+ */
+namespace imu_gps::binlog {
+
+constexpr char kMagic[8] = {'I', 'G', 'B', 'L', 'O', 'G', '\r', '\n'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kIndexBlockSize = 512;  // Number of records covered by one index entry
+
+enum class RecordType : uint8_t {
+    IMU = 1,
+    ODOM = 2,
+    GNSS = 3,
+};
+
+#pragma pack(push, 1)
+struct FileHeader {
+    char magic_[8];
+    uint32_t version_ = kVersion;
+    uint32_t reserved_ = 0;
+};
+
+struct IMURecord {
+    RecordType type_ = RecordType::IMU;
+    double timestamp_;
+    double gyro_[3];
+    double acce_[3];
+};
+
+struct OdomRecord {
+    RecordType type_ = RecordType::ODOM;
+    double timestamp_;
+    double left_pulse_;
+    double right_pulse_;
+};
+
+struct GNSSRecord {
+    RecordType type_ = RecordType::GNSS;
+    double unix_time_;
+    double lat_lon_alt_[3];
+    double heading_;
+    int8_t status_;
+    uint8_t heading_valid_;
+};
+
+struct IndexEntry {
+    uint64_t offset_;      // File offset of the first record in this block
+    double max_time_;      // Max timestamp of all records up to the end of this block
+    double suffix_min_;    // Min timestamp of all records from this block to the end of the file
+};
+
+struct FileFooter {
+    uint64_t index_offset_;
+    uint64_t index_count_;
+    uint64_t num_records_;
+    char magic_[8];
+};
+#pragma pack(pop)
+
+/// Size of a record given its type tag, 0 if the tag is unknown
+inline size_t RecordSize(uint8_t type) {
+    switch (RecordType(type)) {
+        case RecordType::IMU:
+            return sizeof(IMURecord);
+        case RecordType::ODOM:
+            return sizeof(OdomRecord);
+        case RecordType::GNSS:
+            return sizeof(GNSSRecord);
+    }
+    return 0;
+}
+
+/// Check whether a memory block starts with a binary log header
+bool IsBinLog(const char* data, size_t size);
+
+/**
+ * Writes IMU/Odom/GNSS readings into the binary container.
+ * Records are kept in the order they are written, the index and footer are appended by Close().
+ */
+class BinLogWriter {
+   public:
+    BinLogWriter() = default;
+    ~BinLogWriter() { Close(); }
+
+    BinLogWriter(const BinLogWriter&) = delete;
+    BinLogWriter& operator=(const BinLogWriter&) = delete;
+
+    bool Open(const std::string& file_path);
+
+    void Write(const IMU& imu);
+    void Write(const Odom& odom);
+    void Write(const GNSS& gnss);
+
+    /// Write the index and footer and close the file
+    bool Close();
+
+    size_t NumRecords() const { return num_records_; }
+
+   private:
+    void AddRecord(const void* record, size_t size, double timestamp);
+
+    FILE* fp_ = nullptr;
+    uint64_t offset_ = 0;
+    size_t num_records_ = 0;
+
+    std::vector<IndexEntry> index_;
+    std::vector<double> block_min_time_;
+    double max_time_ = 0;
+};
+
+}  // namespace imu_gps::binlog
+
+#endif  // IMU_GPS_BIN_LOG_H
@@ -0,0 +1,99 @@
+#ifndef IMU_GPS_BOUNDED_QUEUE_H
+#define IMU_GPS_BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace imu_gps {
+
+/**
+ * Bounded blocking FIFO between pipeline stages.
+ *
+ * Push() waits while the queue is full, which is what gives a pipeline its back-pressure: a fast producer is held
+ * back to the pace of its consumer instead of buffering without limit. Pop() waits while the queue is empty. After
+ * Close() pushes fail and Pop() returns the remaining values, then false.
+ * Every call takes a lock, so pass batches rather than single readings on hot paths.
+ * The values live in a ring of capacity slots allocated up front, so pushing and popping never allocate.
+ */
+template <typename T>
+class BoundedQueue {
+   public:
+    explicit BoundedQueue(size_t capacity = 16) : capacity_(capacity > 0 ? capacity : 1), slots_(capacity_) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /// Append a value, blocking while the queue is full. Returns false if the queue is closed.
+    bool Push(T value) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (size_ >= capacity_ && !closed_) {
+            ++num_full_waits_;
+            not_full_.wait(lock, [this] { return size_ < capacity_ || closed_; });
+        }
+        if (closed_) {
+            return false;
+        }
+        slots_[(head_ + size_) % capacity_] = std::move(value);
+        ++size_;
+        lock.unlock();
+        not_empty_.notify_one();
+        return true;
+    }
+
+    /// Take the oldest value, blocking while the queue is empty. Returns false once closed and drained.
+    bool Pop(T& value) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        not_empty_.wait(lock, [this] { return size_ > 0 || closed_; });
+        if (size_ == 0) {
+            return false;
+        }
+        value = std::move(slots_[head_]);
+        head_ = (head_ + 1) % capacity_;
+        --size_;
+        lock.unlock();
+        not_full_.notify_one();
+        return true;
+    }
+
+    /// No more values will be pushed, wakes up all waiting threads
+    void Close() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            closed_ = true;
+        }
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+    /// Number of times Push() had to wait for room
+    size_t NumFullWaits() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return num_full_waits_;
+    }
+
+    size_t Capacity() const { return capacity_; }
+
+    /// Number of values waiting to be popped
+    size_t Size() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return size_;
+    }
+
+   private:
+    const size_t capacity_;
+    std::vector<T> slots_;
+    size_t head_ = 0;  // Oldest value
+    size_t size_ = 0;
+    bool closed_ = false;
+    size_t num_full_waits_ = 0;
+
+    mutable std::mutex mtx_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_BOUNDED_QUEUE_H
@@ -2,5 +2,5 @@
 
 namespace imu_gps::global {
 
-bool FLAG_EXIT = false;
+std::atomic<bool> FLAG_EXIT{false};
 }
\ No newline at end of file
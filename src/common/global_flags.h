@@ -1,9 +1,11 @@
 #ifndef IMU_GPS_GLOBAL_FLAGS_H
 #define IMU_GPS_GLOBAL_FLAGS_H
 
+#include <atomic>
+
 namespace imu_gps::global {
 
-extern bool FLAG_EXIT;  // Flag to exit the program
+extern std::atomic<bool> FLAG_EXIT;  // Flag to exit the program, may be set from any thread or a signal handler
 
 }
 
@@ -51,6 +51,4 @@ struct GNSS {
 
 }  // namespace imu_gps
 
-using GNSSPtr = std::shared_ptr<imu_gps::GNSS>;
-
 #endif  // IMU_GPS_GNSS_H
@@ -17,6 +17,4 @@ struct IMU {
 };
 }  // namespace imu_gps
 
-using IMUPtr = std::shared_ptr<imu_gps::IMU>;
-
 #endif  // MAPPING_IMU_H
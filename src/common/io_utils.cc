@@ -1,55 +1,111 @@
 #include "common/io_utils.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <glog/logging.h>
+#include <algorithm>
+#include <vector>
 
 namespace imu_gps {
 
-/**
- * Reads the data text file provided by this book and calls the callback functions.
- * The data text file mainly provides IMU/Odom/GNSS readings.
- */
-void TxtIO::Go() {
-    if (!fin) {
+TxtIO::MappedLog::MappedLog(const TxtIO &io) {
+    int fd = ::open(io.file_path_.c_str(), O_RDONLY);
+    if (fd < 0) {
         LOG(ERROR) << "Unable to find the file";
         return;
     }
 
-    while (!fin.eof()) {
-        std::string line;
-        std::getline(fin, line);
-        if (line.empty()) {
-            continue;
+    struct stat st {};
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            data_ = static_cast<const char *>(addr);
+            size_ = st.st_size;
+            ::madvise(addr, size_, MADV_SEQUENTIAL);
         }
+    }
+    ::close(fd);  // the mapping stays valid after closing the descriptor
 
-        if (line[0] == '#') {
-            // Lines starting with # are comments
-            continue;
-        }
+    begin_ = data_;
+    end_ = data_ + size_;
+    binary_ = binlog::IsBinLog(data_, size_);
+    if (!binary_) {
+        valid_ = true;
+        return;
+    }
+
+    binlog::FileHeader header;
+    std::memcpy(&header, data_, sizeof(header));
+    if (header.version_ != binlog::kVersion) {
+        LOG(ERROR) << "Unsupported binary log version: " << header.version_;
+        return;
+    }
+
+    binlog::FileFooter footer;
+    if (size_ < sizeof(header) + sizeof(footer)) {
+        LOG(ERROR) << "Binary log is truncated.";
+        return;
+    }
+    std::memcpy(&footer, data_ + size_ - sizeof(footer), sizeof(footer));
+    if (std::memcmp(footer.magic_, binlog::kMagic, sizeof(binlog::kMagic)) != 0 ||
+        footer.index_offset_ + footer.index_count_ * sizeof(binlog::IndexEntry) + sizeof(footer) != size_) {
+        LOG(ERROR) << "Binary log footer is corrupted, was the file closed properly?";
+        return;
+    }
 
-        // load data from line
-        std::stringstream ss;
-        ss << line;
-        std::string data_type;
-        ss >> data_type;
-
-        if (data_type == "IMU" && imu_proc_) {
-            double time, gx, gy, gz, ax, ay, az;
-            ss >> time >> gx >> gy >> gz >> ax >> ay >> az;
-            imu_proc_(IMU(time, Vec3d(gx, gy, gz), Vec3d(ax, ay, az)));
-        } else if (data_type == "ODOM" && odom_proc_) {
-            double time, wl, wr;
-            ss >> time >> wl >> wr;
-            odom_proc_(Odom(time, wl, wr));
-        } else if (data_type == "GNSS" && gnss_proc_) {
-            double time, lat, lon, alt, heading;
-            bool heading_valid;
-            ss >> time >> lat >> lon >> alt >> heading >> heading_valid;
-            gnss_proc_(
-                GNSS(time, 4, Vec3d(lat, lon, alt), heading, heading_valid));
+    // Locate the time window in the index
+    std::vector<binlog::IndexEntry> index(footer.index_count_);
+    if (!index.empty()) {
+        std::memcpy(index.data(), data_ + footer.index_offset_, index.size() * sizeof(binlog::IndexEntry));
+    }
+
+    // first block that may contain records at or after start_time_
+    auto first_block = std::partition_point(index.begin(), index.end(), [&io](const binlog::IndexEntry &e) {
+        return e.max_time_ < io.start_time_;
+    });
+    // first block after which no records are before end_time_
+    auto last_block = std::partition_point(first_block, index.end(), [&io](const binlog::IndexEntry &e) {
+        return e.suffix_min_ <= io.end_time_;
+    });
+
+    begin_ = first_block == index.end() ? data_ + footer.index_offset_ : data_ + first_block->offset_;
+    end_ = last_block == index.end() ? data_ + footer.index_offset_ : data_ + last_block->offset_;
+    valid_ = true;
+}
+
+TxtIO::MappedLog::~MappedLog() {
+    if (data_ != nullptr) {
+        ::munmap(const_cast<char *>(data_), size_);
+    }
+}
+
+void TxtIO::LogDone(const MappedLog &log, size_t result) {
+    if (log.Binary()) {
+        // result is the number of bytes consumed
+        if (log.Begin() + result < log.End() && !global::FLAG_EXIT.load(std::memory_order_relaxed)) {
+            LOG(ERROR) << "Corrupted record at offset " << (log.Begin() + result - log.Data());
         }
+    } else if (result > 0) {
+        // result is the number of malformed lines
+        LOG(WARNING) << "skipped " << result << " malformed lines.";
     }
 
     LOG(INFO) << "done.";
 }
 
+/**
+ * Reads the data text file provided by this book and calls the callback functions.
+ * The data text file mainly provides IMU/Odom/GNSS readings.
+ */
+void TxtIO::Go() { Go(CallbackHandler{this}); }
+
+size_t TxtIO::ParseText(const char *begin, const char *end) { return ParseText(begin, end, CallbackHandler{this}); }
+
+size_t TxtIO::ParseBinaryRecords(const char *begin, const char *end) {
+    return ParseBinaryRecords(begin, end, CallbackHandler{this});
+}
+
 }  // namespace imu_gps
@@ -1,11 +1,16 @@
 #ifndef IMU_GPS_IO_UTILS_H
 #define IMU_GPS_IO_UTILS_H
 
+#include <charconv>
+#include <cstring>
 #include <fstream>
 #include <functional>
+#include <limits>
+#include <type_traits>
 #include <utility>
 #include <map>
 
+#include "common/bin_log.h"
 #include "common/global_flags.h"
 #include "common/gnss.h"
 #include "common/imu.h"
@@ -19,10 +24,17 @@ namespace imu_gps {
 /**
  * Reads the data text file provided by this book and calls the callback function.
  * The data text file mainly provides IMU/Odom/GNSS readings.
+ *
+ * The file is memory-mapped and tokenized in place, so no per-line strings or streams are allocated.
+ * Binary logs written by binlog::BinLogWriter (see tools/txt2bin) are detected by their header and read directly.
+ *
+ * Readings are delivered either to the std::function callbacks (Set*ProcessFunc + Go()), or to a handler passed to
+ * Go(handler): a visitor over IMU, Odom and GNSS as for std::visit, whose calls are resolved and inlined at compile
+ * time. Record types the handler has no overload for are skipped without parsing their fields.
  */
 class TxtIO {
 public:
-    TxtIO(const std::string &file_path) : fin(file_path) {}
+    TxtIO(const std::string &file_path) : file_path_(file_path) {}
 
     /// Define callback functions
     using IMUProcessFuncType = std::function<void(const IMU &)>;
@@ -44,16 +56,277 @@ public:
         return *this;
     }
 
+    /**
+     * Only dispatch records whose timestamps are within [start_time, end_time].
+     * Binary logs use their time index to seek to the window directly, text logs are filtered while parsing.
+     */
+    TxtIO &SetTimeRange(double start_time, double end_time) {
+        start_time_ = start_time;
+        end_time_ = end_time;
+        return *this;
+    }
+
     // Traverse the file content and call the callback functions
     void Go();
 
+    /// Traverse the file content and call handler(reading), the callback functions are not used
+    template <typename Handler>
+    void Go(Handler &&handler);
+
+    /**
+     * Parse the text records in [begin, end) (complete lines, the last one may lack its '\n') and call the callbacks.
+     * Used by Go() and by live sources that receive the same grammar in chunks.
+     * @return number of malformed lines
+     */
+    size_t ParseText(const char *begin, const char *end);
+
+    template <typename Handler>
+    size_t ParseText(const char *begin, const char *end, Handler &&handler);
+
+    /**
+     * Dispatch the binlog::*Record records in [begin, end). Stops at an unknown type tag or an incomplete record.
+     * @return number of bytes consumed
+     */
+    size_t ParseBinaryRecords(const char *begin, const char *end);
+
+    template <typename Handler>
+    size_t ParseBinaryRecords(const char *begin, const char *end, Handler &&handler);
+
 private:
-    std::ifstream fin;
+    /// Read-only mapping of the log and the range of it to dispatch, unmapped on destruction
+    class MappedLog {
+       public:
+        /// Map the file, detect the format and, for binary logs, locate the time range in the index
+        explicit MappedLog(const TxtIO &io);
+        ~MappedLog();
+
+        MappedLog(const MappedLog &) = delete;
+        MappedLog &operator=(const MappedLog &) = delete;
+
+        bool Valid() const { return valid_; }
+        bool Binary() const { return binary_; }
+        const char *Data() const { return data_; }
+        const char *Begin() const { return begin_; }
+        const char *End() const { return end_; }
+
+       private:
+        bool valid_ = false;
+        bool binary_ = false;
+        const char *data_ = nullptr;
+        size_t size_ = 0;
+        const char *begin_ = nullptr;
+        const char *end_ = nullptr;
+    };
+
+    /// Handler of the callback functions, record types without a callback are skipped
+    struct CallbackHandler {
+        const TxtIO *io_;
+        void operator()(const IMU &imu) const { io_->imu_proc_(imu); }
+        void operator()(const Odom &odom) const { io_->odom_proc_(odom); }
+        void operator()(const GNSS &gnss) const { io_->gnss_proc_(gnss); }
+        bool Wants(const IMU *) const { return bool(io_->imu_proc_); }
+        bool Wants(const Odom *) const { return bool(io_->odom_proc_); }
+        bool Wants(const GNSS *) const { return bool(io_->gnss_proc_); }
+    };
+
+    /// Whether records of type T are dispatched to the handler
+    template <typename T, typename Handler>
+    static bool Wants(const Handler &handler) {
+        if constexpr (!std::is_invocable_v<Handler &, const T &>) {
+            return false;
+        } else if constexpr (requires { handler.Wants(static_cast<const T *>(nullptr)); }) {
+            return handler.Wants(static_cast<const T *>(nullptr));
+        } else {
+            return true;
+        }
+    }
+
+    static bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    /// Skip blanks and parse the next number in [p, end), advancing p past it
+    template <typename T>
+    static bool NextNumber(const char *&p, const char *end, T &value) {
+        while (p < end && IsSpace(*p)) {
+            ++p;
+        }
+        auto [ptr, ec] = std::from_chars(p, end, value);
+        if (ec != std::errc()) {
+            return false;
+        }
+        p = ptr;
+        return true;
+    }
+
+    /// Parse one line [begin, end) and dispatch it, returns false if the record is malformed
+    template <typename Handler>
+    bool ParseLine(const char *begin, const char *end, Handler &handler);
+
+    /// Log the outcome of Go() on a mapped log
+    static void LogDone(const MappedLog &log, size_t result);
+
+    bool InTimeRange(double t) const { return t >= start_time_ && t <= end_time_; }
+
+    std::string file_path_;
+    double start_time_ = std::numeric_limits<double>::lowest();
+    double end_time_ = std::numeric_limits<double>::max();
     IMUProcessFuncType imu_proc_;
     OdomProcessFuncType odom_proc_;
     GNSSProcessFuncType gnss_proc_;
 };
 
+template <typename Handler>
+void TxtIO::Go(Handler &&handler) {
+    MappedLog log(*this);
+    if (!log.Valid()) {
+        return;
+    }
+
+    if (log.Binary()) {
+        LogDone(log, ParseBinaryRecords(log.Begin(), log.End(), handler));
+    } else {
+        LogDone(log, ParseText(log.Begin(), log.End(), handler));
+    }
+}
+
+template <typename Handler>
+size_t TxtIO::ParseText(const char *begin, const char *end, Handler &&handler) {
+    size_t num_malformed = 0;
+    const char *p = begin;
+    while (p < end && !global::FLAG_EXIT.load(std::memory_order_relaxed)) {
+        const char *eol = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if (eol == nullptr) {
+            eol = end;
+        }
+
+        if (!ParseLine(p, eol, handler)) {
+            ++num_malformed;
+        }
+        p = eol + 1;
+    }
+    return num_malformed;
+}
+
+template <typename Handler>
+bool TxtIO::ParseLine(const char *begin, const char *end, Handler &handler) {
+    const char *p = begin;
+    while (p < end && IsSpace(*p)) {
+        ++p;
+    }
+
+    if (p == end || *p == '#') {
+        // Empty lines and lines starting with # (comments) are skipped
+        return true;
+    }
+
+    // The record type is identified by its length and first letter
+    const char *type_begin = p;
+    while (p < end && !IsSpace(*p)) {
+        ++p;
+    }
+    const size_t type_len = p - type_begin;
+
+    if (type_len == 3 && type_begin[0] == 'I') {  // IMU
+        if constexpr (std::is_invocable_v<Handler &, const IMU &>) {
+            if (!Wants<IMU>(handler)) {
+                return true;
+            }
+            double time, gx, gy, gz, ax, ay, az;
+            if (!(NextNumber(p, end, time) && NextNumber(p, end, gx) && NextNumber(p, end, gy) &&
+                  NextNumber(p, end, gz) && NextNumber(p, end, ax) && NextNumber(p, end, ay) &&
+                  NextNumber(p, end, az))) {
+                return false;
+            }
+            if (!InTimeRange(time)) {
+                return true;
+            }
+            handler(IMU(time, Vec3d(gx, gy, gz), Vec3d(ax, ay, az)));
+        }
+    } else if (type_len == 4 && type_begin[0] == 'O') {  // ODOM
+        if constexpr (std::is_invocable_v<Handler &, const Odom &>) {
+            if (!Wants<Odom>(handler)) {
+                return true;
+            }
+            double time, wl, wr;
+            if (!(NextNumber(p, end, time) && NextNumber(p, end, wl) && NextNumber(p, end, wr))) {
+                return false;
+            }
+            if (!InTimeRange(time)) {
+                return true;
+            }
+            handler(Odom(time, wl, wr));
+        }
+    } else if (type_len == 4 && type_begin[0] == 'G') {  // GNSS
+        if constexpr (std::is_invocable_v<Handler &, const GNSS &>) {
+            if (!Wants<GNSS>(handler)) {
+                return true;
+            }
+            double time, lat, lon, alt, heading;
+            int heading_valid;
+            if (!(NextNumber(p, end, time) && NextNumber(p, end, lat) && NextNumber(p, end, lon) &&
+                  NextNumber(p, end, alt) && NextNumber(p, end, heading) && NextNumber(p, end, heading_valid))) {
+                return false;
+            }
+            if (!InTimeRange(time)) {
+                return true;
+            }
+            handler(GNSS(time, 4, Vec3d(lat, lon, alt), heading, heading_valid != 0));
+        }
+    }
+
+    return true;
+}
+
+template <typename Handler>
+size_t TxtIO::ParseBinaryRecords(const char *begin, const char *end, Handler &&handler) {
+    const char *p = begin;
+    while (p < end && !global::FLAG_EXIT.load(std::memory_order_relaxed)) {
+        const uint8_t type = static_cast<uint8_t>(*p);
+        const size_t rec_size = binlog::RecordSize(type);
+        if (rec_size == 0 || p + rec_size > end) {
+            break;
+        }
+
+        switch (binlog::RecordType(type)) {
+            case binlog::RecordType::IMU: {
+                if constexpr (std::is_invocable_v<Handler &, const IMU &>) {
+                    binlog::IMURecord r;
+                    std::memcpy(&r, p, sizeof(r));
+                    if (Wants<IMU>(handler) && InTimeRange(r.timestamp_)) {
+                        handler(IMU(r.timestamp_, Vec3d(r.gyro_[0], r.gyro_[1], r.gyro_[2]),
+                                    Vec3d(r.acce_[0], r.acce_[1], r.acce_[2])));
+                    }
+                }
+                break;
+            }
+            case binlog::RecordType::ODOM: {
+                if constexpr (std::is_invocable_v<Handler &, const Odom &>) {
+                    binlog::OdomRecord r;
+                    std::memcpy(&r, p, sizeof(r));
+                    if (Wants<Odom>(handler) && InTimeRange(r.timestamp_)) {
+                        handler(Odom(r.timestamp_, r.left_pulse_, r.right_pulse_));
+                    }
+                }
+                break;
+            }
+            case binlog::RecordType::GNSS: {
+                if constexpr (std::is_invocable_v<Handler &, const GNSS &>) {
+                    binlog::GNSSRecord r;
+                    std::memcpy(&r, p, sizeof(r));
+                    if (Wants<GNSS>(handler) && InTimeRange(r.unix_time_)) {
+                        handler(GNSS(r.unix_time_, r.status_,
+                                     Vec3d(r.lat_lon_alt_[0], r.lat_lon_alt_[1], r.lat_lon_alt_[2]), r.heading_,
+                                     r.heading_valid_ != 0));
+                    }
+                }
+                break;
+            }
+        }
+        p += rec_size;
+    }
+
+    return p - begin;
+}
+
 }  // namespace imu_gps
 
 #endif  // IMU_GPS_IO_UTILS_H
@@ -0,0 +1,275 @@
+#include "common/live_io.h"
+#include "common/bin_log.h"
+#include "common/global_flags.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <glog/logging.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace imu_gps {
+
+namespace {
+
+constexpr char kUdpPrefix[] = "udp://";
+
+/// Binary records start with their type tag, text records with a letter, blank or '#'
+inline bool IsBinaryRecord(char c) { return binlog::RecordSize(static_cast<uint8_t>(c)) != 0; }
+
+speed_t BaudConstant(int baud_rate) {
+    switch (baud_rate) {
+        case 9600:
+            return B9600;
+        case 19200:
+            return B19200;
+        case 38400:
+            return B38400;
+        case 57600:
+            return B57600;
+        case 115200:
+            return B115200;
+        case 230400:
+            return B230400;
+        case 460800:
+            return B460800;
+        case 921600:
+            return B921600;
+        default:
+            return 0;
+    }
+}
+
+}  // namespace
+
+LiveIO::LiveIO(const std::string& source, Options options) : source_(source), options_(options), parser_("") {}
+
+LiveIO::~LiveIO() {
+    if (owns_fd_ && fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool LiveIO::Open() {
+    if (fd_ >= 0) {
+        return true;
+    }
+
+    if (source_.compare(0, sizeof(kUdpPrefix) - 1, kUdpPrefix) == 0) {
+        const std::string host_port = source_.substr(sizeof(kUdpPrefix) - 1);
+        const size_t colon = host_port.rfind(':');
+        if (colon == std::string::npos) {
+            LOG(ERROR) << "Expected udp://ADDRESS:PORT, got " << source_;
+            return false;
+        }
+        return OpenUdp(host_port.substr(0, colon), std::atoi(host_port.c_str() + colon + 1));
+    }
+    return OpenStream(source_);
+}
+
+bool LiveIO::OpenUdp(const std::string& address, int port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (::inet_pton(AF_INET, address.empty() ? "0.0.0.0" : address.c_str(), &addr.sin_addr) != 1) {
+        LOG(ERROR) << "Invalid address: " << address;
+        return false;
+    }
+
+    int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG(ERROR) << "Failed to create socket: " << std::strerror(errno);
+        return false;
+    }
+    const int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &options_.socket_buffer_, sizeof(options_.socket_buffer_));
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        LOG(ERROR) << "Failed to bind " << address << ":" << port << ": " << std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    // one slot per datagram of a recvmmsg() batch
+    const size_t batch = std::max<size_t>(options_.batch_size_, 1);
+    buffer_.resize(batch * options_.datagram_size_);
+    iovecs_.resize(batch);
+    msgs_.resize(batch);
+    for (size_t i = 0; i < batch; ++i) {
+        iovecs_[i].iov_base = buffer_.data() + i * options_.datagram_size_;
+        iovecs_[i].iov_len = options_.datagram_size_;
+        msgs_[i] = {};
+        msgs_[i].msg_hdr.msg_iov = &iovecs_[i];
+        msgs_[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    fd_ = fd;
+    owns_fd_ = true;
+    udp_ = true;
+    LOG(INFO) << "Listening on udp " << address << ":" << port;
+    return true;
+}
+
+bool LiveIO::OpenStream(const std::string& path) {
+    if (path == "-") {
+        fd_ = STDIN_FILENO;
+        owns_fd_ = false;
+    } else {
+        fd_ = ::open(path.c_str(), O_RDONLY | O_NOCTTY | O_CLOEXEC);
+        if (fd_ < 0) {
+            LOG(ERROR) << "Failed to open " << path << ": " << std::strerror(errno);
+            return false;
+        }
+        owns_fd_ = true;
+    }
+
+    if (::isatty(fd_) && fd_ != STDIN_FILENO) {
+        // serial port: raw 8N1 at the configured speed
+        termios tio{};
+        if (::tcgetattr(fd_, &tio) == 0) {
+            ::cfmakeraw(&tio);
+            const speed_t speed = BaudConstant(options_.baud_rate_);
+            if (speed != 0) {
+                ::cfsetispeed(&tio, speed);
+                ::cfsetospeed(&tio, speed);
+            } else {
+                LOG(WARNING) << "Unsupported baud rate " << options_.baud_rate_ << ", keeping the port speed";
+            }
+            tio.c_cflag |= CLOCAL | CREAD;
+            ::tcsetattr(fd_, TCSANOW, &tio);
+        }
+    }
+
+    buffer_.resize(std::max<size_t>(options_.stream_buffer_, 1024));
+    stream_fill_ = 0;
+    udp_ = false;
+    return true;
+}
+
+bool LiveIO::Running() const {
+    return !stop_.load(std::memory_order_relaxed) && !global::FLAG_EXIT.load(std::memory_order_relaxed);
+}
+
+void LiveIO::Go() {
+    if (!Open()) {
+        return;
+    }
+
+    if (udp_) {
+        GoUdp();
+    } else {
+        GoStream();
+    }
+
+    LOG(INFO) << "live source done: " << stats_.num_bytes_ << " bytes in " << stats_.num_syscalls_ << " reads, "
+              << stats_.num_datagrams_ << " datagrams, " << stats_.num_truncated_ << " truncated, "
+              << stats_.num_malformed_ << " malformed";
+}
+
+void LiveIO::GoUdp() {
+    pollfd pfd{fd_, POLLIN, 0};
+    while (Running()) {
+        const int n = ::recvmmsg(fd_, msgs_.data(), msgs_.size(), MSG_DONTWAIT, nullptr);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                ::poll(&pfd, 1, options_.poll_timeout_ms_);
+                continue;
+            }
+            LOG(ERROR) << "recvmmsg failed: " << std::strerror(errno);
+            return;
+        }
+
+        ++stats_.num_syscalls_;
+        for (int i = 0; i < n; ++i) {
+            ++stats_.num_datagrams_;
+            stats_.num_bytes_ += msgs_[i].msg_len;
+            if (msgs_[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                ++stats_.num_truncated_;
+                continue;
+            }
+            const char* data = static_cast<const char*>(iovecs_[i].iov_base);
+            Dispatch(data, data + msgs_[i].msg_len);
+        }
+    }
+}
+
+void LiveIO::Dispatch(const char* begin, const char* end) {
+    if (begin == end) {
+        return;
+    }
+    if (IsBinaryRecord(*begin)) {
+        if (begin + parser_.ParseBinaryRecords(begin, end) != end) {
+            ++stats_.num_malformed_;
+        }
+    } else {
+        stats_.num_malformed_ += parser_.ParseText(begin, end);
+    }
+}
+
+void LiveIO::GoStream() {
+    pollfd pfd{fd_, POLLIN, 0};
+    char* data = buffer_.data();
+    while (Running()) {
+        const int ready = ::poll(&pfd, 1, options_.poll_timeout_ms_);
+        if (ready <= 0) {
+            continue;
+        }
+
+        const ssize_t n = ::read(fd_, data + stream_fill_, buffer_.size() - stream_fill_);
+        if (n == 0) {
+            break;  // end of stream
+        }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                continue;
+            }
+            LOG(ERROR) << "read failed: " << std::strerror(errno);
+            break;
+        }
+        ++stats_.num_syscalls_;
+        stats_.num_bytes_ += n;
+
+        // dispatch the complete records, keep an incomplete tail for the next read
+        const char* p = data;
+        const char* end = data + stream_fill_ + n;
+        while (p < end) {
+            if (IsBinaryRecord(*p)) {
+                const size_t consumed = parser_.ParseBinaryRecords(p, end);
+                p += consumed;
+                if (p < end && !IsBinaryRecord(*p)) {
+                    continue;  // switch to text
+                }
+                break;  // incomplete record
+            }
+
+            const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (eol == nullptr) {
+                break;  // incomplete line
+            }
+            stats_.num_malformed_ += parser_.ParseText(p, eol + 1);
+            p = eol + 1;
+        }
+
+        stream_fill_ = end - p;
+        if (stream_fill_ == buffer_.size()) {
+            // a single record larger than the buffer, cannot be framed
+            ++stats_.num_malformed_;
+            stream_fill_ = 0;
+        } else if (stream_fill_ > 0 && p != data) {
+            std::memmove(data, p, stream_fill_);
+        }
+    }
+
+    // the last line may lack its '\n', a truncated binary record counts as malformed
+    Dispatch(data, data + stream_fill_);
+    stream_fill_ = 0;
+}
+
+}  // namespace imu_gps
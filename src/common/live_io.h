@@ -0,0 +1,110 @@
+#ifndef IMU_GPS_LIVE_IO_H
+#define IMU_GPS_LIVE_IO_H
+
+#include "common/io_utils.h"
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace imu_gps {
+
+/**
+ * Live IMU/Odom/GNSS source with the callback API of TxtIO.
+ *
+ * Two transports are supported:
+ *   udp://ADDRESS:PORT   datagrams, each holding one or more text lines or whole binlog records
+ *   a device path        serial port (switched to raw mode at baud_rate_), FIFO or "-" for stdin, read as a byte stream
+ * Text and binary (binlog::*Record, see tools/txt2bin) payloads are told apart by their first byte.
+ *
+ * All receive buffers are allocated in Open(). UDP drains up to batch_size_ datagrams per recvmmsg() call and
+ * dispatches them right away, so the callbacks run at sensor rate with no buffering beyond the socket's own.
+ * Go() blocks in poll() between bursts and returns when Stop() is called, global::FLAG_EXIT is set or the stream ends.
+ */
+class LiveIO {
+   public:
+    struct Options {
+        Options() {}
+        size_t batch_size_ = 64;          // Datagrams received per recvmmsg() call
+        size_t datagram_size_ = 65536;    // Receive buffer per datagram, larger datagrams are truncated and skipped
+        size_t stream_buffer_ = 1 << 16;  // Receive buffer of a stream source
+        int socket_buffer_ = 1 << 22;     // SO_RCVBUF of a UDP socket, bytes
+        int baud_rate_ = 921600;          // Serial port speed
+        int poll_timeout_ms_ = 100;       // Wake-up interval to check for Stop()/FLAG_EXIT
+    };
+
+    /// Receive counters
+    struct Stats {
+        size_t num_syscalls_ = 0;   // recvmmsg()/read() calls that returned data
+        size_t num_datagrams_ = 0;  // UDP datagrams received
+        size_t num_bytes_ = 0;
+        size_t num_truncated_ = 0;  // Datagrams larger than datagram_size_, skipped
+        size_t num_malformed_ = 0;  // Malformed text lines or corrupted binary records
+    };
+
+    /// @param source udp://ADDRESS:PORT, a device or FIFO path, or "-" for stdin
+    explicit LiveIO(const std::string& source, Options options = Options());
+    ~LiveIO();
+
+    LiveIO(const LiveIO&) = delete;
+    LiveIO& operator=(const LiveIO&) = delete;
+
+    LiveIO& SetIMUProcessFunc(TxtIO::IMUProcessFuncType imu_proc) {
+        parser_.SetIMUProcessFunc(std::move(imu_proc));
+        return *this;
+    }
+
+    LiveIO& SetOdomProcessFunc(TxtIO::OdomProcessFuncType odom_proc) {
+        parser_.SetOdomProcessFunc(std::move(odom_proc));
+        return *this;
+    }
+
+    LiveIO& SetGNSSProcessFunc(TxtIO::GNSSProcessFuncType gnss_proc) {
+        parser_.SetGNSSProcessFunc(std::move(gnss_proc));
+        return *this;
+    }
+
+    /// Open the source and allocate the buffers, called by Go() if needed
+    bool Open();
+
+    /// Receive and dispatch until Stop(), FLAG_EXIT or the end of a stream
+    void Go();
+
+    /// Make Go() return, may be called from any thread
+    void Stop() { stop_.store(true, std::memory_order_relaxed); }
+
+    const Stats& GetStats() const { return stats_; }
+
+   private:
+    bool OpenUdp(const std::string& address, int port);
+    bool OpenStream(const std::string& path);
+
+    void GoUdp();
+    void GoStream();
+
+    /// Dispatch one datagram, which holds complete records
+    void Dispatch(const char* begin, const char* end);
+
+    bool Running() const;
+
+    std::string source_;
+    Options options_;
+    TxtIO parser_;
+    bool udp_ = false;
+    bool owns_fd_ = false;
+    int fd_ = -1;
+    std::atomic<bool> stop_{false};
+    Stats stats_;
+
+    std::vector<char> buffer_;  // batch_size_ datagrams, or the stream buffer
+    std::vector<mmsghdr> msgs_;
+    std::vector<iovec> iovecs_;
+    size_t stream_fill_ = 0;  // Bytes of an incomplete record kept at the front of a stream buffer
+};
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_LIVE_IO_H
@@ -4,10 +4,12 @@
 #include <glog/logging.h>
 #include <boost/array.hpp>
 #include <boost/math/tools/precision.hpp>
+#include <algorithm>
 #include <iomanip>
 #include <limits>
 #include <map>
 #include <numeric>
+#include <type_traits>
 #include <opencv2/core.hpp>
 
 /// Common mathematical functions
@@ -306,6 +308,124 @@ Eigen::Matrix<T, 3, 1> Log(const Eigen::Matrix<T, 3, 3>& R) {
     return (std::abs(theta) < 0.001) ? (0.5 * K) : (0.5 * theta / std::sin(theta) * K);
 }
 
+/**
+ * Batched SO3 kernels over contiguous arrays, structure-of-arrays layout (one array per component).
+ *
+ * They are branch-free and written on Eigen arrays, so the loops are vectorized for the ISA the code is built for
+ * (SSE/AVX2/AVX-512 or NEON) and fall back to scalar code elsewhere. Chunks of kSO3BatchChunk elements keep the
+ * temporaries on the stack. A chunk of small rotations only, the usual case of IMU increments, is evaluated with
+ * polynomials, as Eigen has no vectorized sin/cos/atan for double. The results match Sophus SO3::exp / SO3::log to
+ * rounding.
+ */
+constexpr int kSO3BatchChunk = 64;
+
+/// q_i = Exp(w_i) as unit quaternions, with the small-angle expansion of Sophus below 1e-10 rad (float: 1e-5)
+template <typename T>
+void SO3ExpBatch(size_t n, const T* wx, const T* wy, const T* wz, T* qw, T* qx, T* qy, T* qz) {
+    using ArrayT = Eigen::Array<T, Eigen::Dynamic, 1, 0, kSO3BatchChunk, 1>;
+    using ConstMap = Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>>;
+    using Map = Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>>;
+    const T eps = std::is_same_v<T, float> ? T(1e-5) : T(1e-10);
+
+    for (size_t i = 0; i < n; i += kSO3BatchChunk) {
+        const Eigen::Index m = Eigen::Index(std::min<size_t>(kSO3BatchChunk, n - i));
+        const ConstMap x(wx + i, m), y(wy + i, m), z(wz + i, m);
+
+        const ArrayT theta2 = x * x + y * y + z * z;
+        ArrayT c, s;  // cos(theta / 2) and sin(theta / 2) / theta
+        if (theta2.maxCoeff() < T(0.25)) {
+            // Taylor series in h = theta / 2 < 0.25, truncated below 1e-16
+            const ArrayT h2 = T(0.25) * theta2;
+            // cos(h) and sin(h) / h, Horner from the highest order
+            static constexpr T kCos[] = {T(1), T(-1) / 2, T(1) / 24, T(-1) / 720, T(1) / 40320, T(-1) / 3628800};
+            static constexpr T kSinc[] = {T(1), T(-1) / 6, T(1) / 120, T(-1) / 5040, T(1) / 362880, T(-1) / 39916800};
+            c.setConstant(m, kCos[5]);
+            s.setConstant(m, kSinc[5]);
+            for (int k = 4; k >= 0; --k) {
+                c = c * h2 + kCos[k];
+                s = s * h2 + kSinc[k];
+            }
+            s *= T(0.5);
+        } else {
+            const ArrayT theta = theta2.sqrt();
+            const auto small = theta < eps;
+            // the division is discarded where theta is small
+            c = small.select(T(1) - theta2 / T(8), (T(0.5) * theta).cos());
+            s = small.select(T(0.5) - theta2 / T(48), (T(0.5) * theta).sin() / theta);
+        }
+        Map(qw + i, m) = c;
+        Map(qx + i, m) = s * x;
+        Map(qy + i, m) = s * y;
+        Map(qz + i, m) = s * z;
+    }
+}
+
+/**
+ * w_i = Log(q_i) of unit quaternions, the rotation vector of angle in [-pi, pi] as Sophus returns it, with its
+ * near-identity and half-turn thresholds of 1e-10 (float: 1e-5). A half turn is off by up to 2 |w| in angle.
+ */
+template <typename T>
+void SO3LogBatch(size_t n, const T* qw, const T* qx, const T* qy, const T* qz, T* wx, T* wy, T* wz) {
+    using ArrayT = Eigen::Array<T, Eigen::Dynamic, 1, 0, kSO3BatchChunk, 1>;
+    using ConstMap = Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>>;
+    using Map = Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>>;
+    const T eps = std::is_same_v<T, float> ? T(1e-5) : T(1e-10);
+
+    for (size_t i = 0; i < n; i += kSO3BatchChunk) {
+        const Eigen::Index m = Eigen::Index(std::min<size_t>(kSO3BatchChunk, n - i));
+        const ConstMap w(qw + i, m), x(qx + i, m), y(qy + i, m), z(qz + i, m);
+
+        // f = 2 atan(|v| / w) / |v|
+        const ArrayT n2 = x * x + y * y + z * z;
+        const ArrayT w2 = w * w;
+        ArrayT f;
+        if ((n2 - T(0.0025) * w2).maxCoeff() < T(0)) {
+            // Taylor series of atan(r) / r in r = |v| / w, |r| < 0.05, truncated below 1e-16
+            const ArrayT r2 = n2 / w2;
+            f.setConstant(m, T(1) / 13);
+            for (int k = 5; k >= 0; --k) {
+                f = f * r2 + T(k % 2 == 0 ? 1 : -1) / T(2 * k + 1);
+            }
+            f *= T(2) / w;
+        } else {
+            // Taylor expansion near the identity, +-pi / |v| at w = 0
+            const ArrayT norm = n2.sqrt();
+            const ArrayT series = T(2) / w - T(2) / T(3) * n2 / (w2 * w);
+            const ArrayT half_turn = (w >= T(0)).select(ArrayT::Constant(m, T(M_PI)), ArrayT::Constant(m, T(-M_PI)));
+            const ArrayT general = T(2) * (norm / w).atan() / norm;
+            f = (n2 < eps * eps).select(series, (w.abs() < eps).select(half_turn / norm, general));
+        }
+        Map(wx + i, m) = f * x;
+        Map(wy + i, m) = f * y;
+        Map(wz + i, m) = f * z;
+    }
+}
+
+/// Right Jacobian of SO3, Exp(phi + d) ~= Exp(phi) * Exp(Jr(phi) * d)
+template <typename T>
+Eigen::Matrix<T, 3, 3> SO3JacobianRight(const Eigen::Matrix<T, 3, 1>& phi) {
+    const T theta = phi.norm();
+    const Eigen::Matrix<T, 3, 3> K = SKEW_SYM_MATRIX(phi);
+    if (theta < 1e-5) {
+        return Eigen::Matrix<T, 3, 3>::Identity() - T(0.5) * K;
+    }
+    const T theta2 = theta * theta;
+    return Eigen::Matrix<T, 3, 3>::Identity() - (T(1) - std::cos(theta)) / theta2 * K +
+           (theta - std::sin(theta)) / (theta2 * theta) * K * K;
+}
+
+/// Inverse of SO3JacobianRight
+template <typename T>
+Eigen::Matrix<T, 3, 3> SO3JacobianRightInv(const Eigen::Matrix<T, 3, 1>& phi) {
+    const T theta = phi.norm();
+    const Eigen::Matrix<T, 3, 3> K = SKEW_SYM_MATRIX(phi);
+    if (theta < 1e-5) {
+        return Eigen::Matrix<T, 3, 3>::Identity() + T(0.5) * K;
+    }
+    return Eigen::Matrix<T, 3, 3>::Identity() + T(0.5) * K +
+           (T(1) / (theta * theta) - (T(1) + std::cos(theta)) / (T(2) * theta * std::sin(theta))) * K * K;
+}
+
 template <typename T>
 Eigen::Matrix<T, 3, 1> RotMtoEuler(const Eigen::Matrix<T, 3, 3>& rot) {
     T sy = sqrt(rot(0, 0) * rot(0, 0) + rot(1, 0) * rot(1, 0));
@@ -424,6 +544,15 @@ inline void HistoryMeanAndVar(size_t hist_n, float hist_mean, float hist_var2, s
                (hist_n + curr_n);
 }
 
+/**
+ * Interpolate between two poses, slerp on the rotation and lerp on the translation
+ * @param s 0 returns pose_first, 1 returns pose_next
+ */
+inline SE3 InterpolateSE3(const SE3& pose_first, const SE3& pose_next, double s) {
+    return {pose_first.unit_quaternion().slerp(s, pose_next.unit_quaternion()),
+            pose_first.translation() * (1 - s) + pose_next.translation() * s};
+}
+
 /**
  * Pose interpolation algorithm
  * @tparam T    Data type
@@ -437,7 +566,8 @@ inline void HistoryMeanAndVar(size_t hist_n, float hist_mean, float hist_var2, s
  * @param best_match_iter The closest match found
  *
  * NOTE: Query time must be between the minimum and maximum times of data (with a tolerance of 0.5s)
- * The data map is sorted by time
+ * The data map is sorted by time. The bracketing pair is found by bisection, O(log n) for random access
+ * containers; for many queries against one trajectory prefer PoseHistory (common/pose_history.h).
  * @return
  */
 template <typename T, typename C, typename FT, typename FP>
@@ -458,34 +588,37 @@ inline bool PoseInterp(double query_time, C&& data, FT&& take_time_func, FP&& ta
         }
         return false;
     }
+    if (query_time < take_time_func(*data.begin()) - time_th) {
+        return false;
+    }
 
-    auto match_iter = data.begin();
-    for (auto iter = data.begin(); iter != data.end(); ++iter) {
-        auto next_iter = iter;
-        next_iter++;
-
-        if (take_time_func(*iter) < query_time && take_time_func(*next_iter) >= query_time) {
-            match_iter = iter;
-            break;
-        }
+    // the last element before query_time, or the first one if there is none
+    auto match_iter = std::partition_point(data.begin(), data.end(), [&](const auto& d) {
+        return take_time_func(d) < query_time;
+    });
+    if (match_iter != data.begin()) {
+        --match_iter;
     }
 
     auto match_iter_n = match_iter;
     match_iter_n++;
+    if (match_iter_n == data.end()) {
+        // single element
+        best_match = *match_iter;
+        result = take_pose_func(*match_iter);
+        return true;
+    }
 
     double dt = take_time_func(*match_iter_n) - take_time_func(*match_iter);
     double s = (query_time - take_time_func(*match_iter)) / dt;  // s=0 when it's the first frame, s=1 for the next
-    // Fix the bug where dt is 0
-    if (fabs(dt) < 1e-6) {
+    // Fix the bug where dt is 0, and hold the first pose before the start of data
+    if (fabs(dt) < 1e-6 || s < 0) {
         best_match = *match_iter;
         result = take_pose_func(*match_iter);
         return true;
     }
 
-    SE3 pose_first = take_pose_func(*match_iter);
-    SE3 pose_next = take_pose_func(*match_iter_n);
-    result = {pose_first.unit_quaternion().slerp(s, pose_next.unit_quaternion()),
-              pose_first.translation() * (1 - s) + pose_next.translation() * s};
+    result = InterpolateSE3(take_pose_func(*match_iter), take_pose_func(*match_iter_n), s);
     best_match = s < 0.5 ? *match_iter : *match_iter_n;
     return true;
 }
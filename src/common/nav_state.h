@@ -29,7 +29,14 @@ struct NavState {
         : timestamp_(time), R_(pose.so3()), p_(pose.translation()), v_(vel) {}
 
     /// Convert to Sophus
-    Sophus::SE3<T> GetSE3() const { return SE3(R_, p_); }
+    Sophus::SE3<T> GetSE3() const { return Sophus::SE3<T>(R_, p_); }
+
+    /// Convert to another scalar type
+    template <typename O>
+    NavState<O> cast() const {
+        return NavState<O>(timestamp_, R_.template cast<O>(), p_.template cast<O>(), v_.template cast<O>(),
+                           bg_.template cast<O>(), ba_.template cast<O>());
+    }
 
     friend std::ostream& operator<<(std::ostream& os, const NavState<T>& s) {
         os << "p: " << s.p_.transpose() << ", v: " << s.v_.transpose()
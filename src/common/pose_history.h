@@ -0,0 +1,213 @@
+#ifndef IMU_GPS_POSE_HISTORY_H
+#define IMU_GPS_POSE_HISTORY_H
+
+#include "common/eigen_types.h"
+#include "common/math_utils.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace imu_gps {
+
+/**
+ * Time-indexed trajectory for aligning other sensors against the filter output.
+ *
+ * Poses are appended in time order into a fixed-capacity ring (the oldest pose is dropped when it is full), with the
+ * timestamps in their own contiguous array. A single Interp() bisects the timestamps, O(log n). A Cursor remembers
+ * where the previous query landed, so a run of increasing query times costs amortized O(1) each; if a query jumps
+ * far from the cursor it falls back to bisection. InterpBatch() walks sorted query times with a cursor.
+ *
+ * Interpolation follows math::PoseInterp: slerp/lerp between the bracketing pair, the pose before the query if the
+ * pair is closer than 1e-6s, and the first/last pose for queries up to time_th outside the covered range.
+ */
+class PoseHistory {
+   public:
+    /// Position of the last lookup, valid across Push() and dropping of old poses
+    struct Cursor {
+        uint64_t seq_ = 0;  // Sequence number of the lower pose of the last bracket
+    };
+
+    explicit PoseHistory(size_t capacity = 1 << 16) {
+        size_t n = 2;
+        while (n < capacity) {
+            n <<= 1;
+        }
+        times_.resize(n);
+        poses_.resize(n);
+        mask_ = n - 1;
+    }
+
+    /// Append a pose, returns false (and drops it) if it is older than the newest one
+    bool Push(double timestamp, const SE3& pose) {
+        if (size_ > 0 && timestamp < times_[Slot(size_ - 1)]) {
+            return false;
+        }
+        if (size_ > mask_) {
+            head_ = (head_ + 1) & mask_;
+            ++first_seq_;
+            --size_;
+        }
+        const size_t slot = Slot(size_);
+        times_[slot] = timestamp;
+        poses_[slot] = pose;
+        ++size_;
+        return true;
+    }
+
+    void Clear() {
+        first_seq_ += size_;
+        head_ = 0;
+        size_ = 0;
+    }
+
+    size_t Size() const { return size_; }
+    bool Empty() const { return size_ == 0; }
+    size_t Capacity() const { return mask_ + 1; }
+
+    /// Time of the i-th oldest pose
+    double Time(size_t i) const { return times_[Slot(i)]; }
+    const SE3& Pose(size_t i) const { return poses_[Slot(i)]; }
+
+    double FrontTime() const { return Time(0); }
+    double BackTime() const { return Time(size_ - 1); }
+
+    /// Interpolated pose at query_time by bisection
+    bool Interp(double query_time, SE3& result, float time_th = 0.5) const {
+        Cursor cursor;
+        return Interp(query_time, result, cursor, time_th);
+    }
+
+    /// Interpolated pose at query_time, searching from and updating the cursor
+    bool Interp(double query_time, SE3& result, Cursor& cursor, float time_th = 0.5) const {
+        if (size_ == 0) {
+            return false;
+        }
+
+        if (query_time > BackTime()) {
+            if (query_time < BackTime() + time_th) {
+                result = Pose(size_ - 1);
+                cursor.seq_ = first_seq_ + size_ - 1;
+                return true;
+            }
+            return false;
+        }
+        if (query_time < FrontTime() - time_th) {
+            return false;
+        }
+
+        const size_t i = Bracket(query_time, cursor);
+        cursor.seq_ = first_seq_ + i;
+        if (i + 1 == size_) {
+            result = Pose(i);
+            return true;
+        }
+
+        const double t0 = Time(i);
+        const double dt = Time(i + 1) - t0;
+        if (std::fabs(dt) < 1e-6 || query_time <= t0) {
+            result = Pose(i);
+            return true;
+        }
+        result = math::InterpolateSE3(Pose(i), Pose(i + 1), (query_time - t0) / dt);
+        return true;
+    }
+
+    /**
+     * Interpolate n poses at once, best with increasing query times
+     * @param query_times   n query times
+     * @param results       n output poses, untouched where the query fails
+     * @param valid         optional n flags, 1 where the query succeeded
+     * @return number of successful queries
+     */
+    size_t InterpBatch(const double* query_times, size_t n, SE3* results, uint8_t* valid = nullptr,
+                       float time_th = 0.5) const {
+        Cursor cursor;
+        size_t num_valid = 0;
+        for (size_t k = 0; k < n; ++k) {
+            const bool ok = Interp(query_times[k], results[k], cursor, time_th);
+            if (valid) {
+                valid[k] = ok;
+            }
+            num_valid += ok;
+        }
+        return num_valid;
+    }
+
+    size_t InterpBatch(const std::vector<double>& query_times, std::vector<SE3>& results,
+                       std::vector<uint8_t>* valid = nullptr, float time_th = 0.5) const {
+        results.resize(query_times.size());
+        if (valid) {
+            valid->resize(query_times.size());
+        }
+        return InterpBatch(query_times.data(), query_times.size(), results.data(), valid ? valid->data() : nullptr,
+                           time_th);
+    }
+
+   private:
+    /// Number of steps walked from the cursor before giving up and bisecting
+    static constexpr size_t kMaxWalk = 8;
+
+    size_t Slot(size_t i) const { return (head_ + i) & mask_; }
+
+    /**
+     * Index of the last pose before query_time, or 0 if there is none. Requires size_ > 0 and
+     * query_time <= BackTime(), so the returned pose is the last one only if size_ == 1.
+     */
+    size_t Bracket(double query_time, const Cursor& cursor) const {
+        // start from the cursor if it still points into the ring
+        if (cursor.seq_ >= first_seq_ && cursor.seq_ < first_seq_ + size_) {
+            size_t i = cursor.seq_ - first_seq_;
+            if (Time(i) < query_time) {
+                // forward: stop at the last pose before query_time
+                for (size_t step = 0; step < kMaxWalk; ++step) {
+                    if (i + 1 >= size_ || Time(i + 1) >= query_time) {
+                        return i;
+                    }
+                    ++i;
+                }
+                return Bisect(query_time, i, size_);
+            }
+            // backward
+            for (size_t step = 0; step < kMaxWalk && i > 0; ++step) {
+                --i;
+                if (Time(i) < query_time) {
+                    return i;
+                }
+            }
+            if (i == 0) {
+                return 0;
+            }
+            return Bisect(query_time, 0, i);
+        }
+        return Bisect(query_time, 0, size_);
+    }
+
+    /// Index of the last pose in [lo, hi) before query_time, lo if there is none
+    size_t Bisect(double query_time, size_t lo, size_t hi) const {
+        // first index in [lo, hi) with time >= query_time
+        size_t first = lo, count = hi - lo;
+        while (count > 0) {
+            const size_t half = count / 2;
+            if (Time(first + half) < query_time) {
+                first += half + 1;
+                count -= half + 1;
+            } else {
+                count = half;
+            }
+        }
+        return first > lo ? first - 1 : lo;
+    }
+
+    std::vector<double> times_;
+    std::vector<SE3> poses_;
+    size_t mask_ = 0;
+    size_t head_ = 0;         // Slot of the oldest pose
+    size_t size_ = 0;         // Number of poses
+    uint64_t first_seq_ = 0;  // Sequence number of the oldest pose
+};
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_POSE_HISTORY_H
@@ -0,0 +1,54 @@
+#ifndef IMU_GPS_REPLAY_PACER_H
+#define IMU_GPS_REPLAY_PACER_H
+
+#include <chrono>
+#include <thread>
+
+namespace imu_gps {
+
+/**
+ * Paces an offline replay against the sensor timestamps.
+ *
+ * The first call of WaitUntil() anchors the sensor clock to the wall clock, later calls sleep until the wall clock
+ * catches up with the scaled sensor time. This keeps the replay speed independent of how long the processing takes
+ * and of whether a UI is attached.
+ * speed = 1 replays in real time, speed = N replays N times faster, speed <= 0 does not wait at all.
+ */
+class ReplayPacer {
+   public:
+    explicit ReplayPacer(double speed = 0.0) : speed_(speed) {}
+
+    /// Block until the wall clock reaches the replay moment of the given sensor time
+    void WaitUntil(double sensor_time) {
+        if (speed_ <= 0) {
+            return;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (!started_) {
+            started_ = true;
+            wall_start_ = now;
+            sensor_start_ = sensor_time;
+            return;
+        }
+
+        auto target = wall_start_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                        std::chrono::duration<double>((sensor_time - sensor_start_) / speed_));
+        if (target > now) {
+            std::this_thread::sleep_until(target);
+        }
+    }
+
+    /// Whether the pacer waits at all
+    bool Paced() const { return speed_ > 0; }
+
+   private:
+    double speed_ = 0.0;
+    bool started_ = false;
+    double sensor_start_ = 0.0;
+    std::chrono::steady_clock::time_point wall_start_;
+};
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_REPLAY_PACER_H
@@ -0,0 +1,79 @@
+#include "common/sensor_sync.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace imu_gps {
+
+SensorSynchronizer::SensorSynchronizer(Options options) : options_(options) {
+    heap_.reserve(options_.max_buffered_ + 1);
+}
+
+void SensorSynchronizer::Add(double t, Reading reading) {
+    const size_t sensor = reading.index();
+    ++stats_.num_received_[sensor];
+
+    if (t < released_time_) {
+        ++stats_.num_late_[sensor];
+        stats_.max_late_ = std::max(stats_.max_late_, released_time_ - t);
+        return;
+    }
+
+    if (t < newest_time_) {
+        ++stats_.num_reordered_;
+    } else {
+        newest_time_ = t;
+    }
+
+    heap_.push_back({t, next_seq_++, std::move(reading)});
+    std::push_heap(heap_.begin(), heap_.end(), Later);
+    stats_.max_buffered_ = std::max(stats_.max_buffered_, heap_.size());
+
+    while (heap_.size() > options_.max_buffered_) {
+        ++stats_.num_forced_;
+        ReleaseTop();
+    }
+    ReleaseUntil(newest_time_ - options_.latency_window_);
+}
+
+void SensorSynchronizer::ReleaseUntil(double t) {
+    while (!heap_.empty() && heap_.front().time_ <= t) {
+        ReleaseTop();
+    }
+}
+
+void SensorSynchronizer::ReleaseTop() {
+    std::pop_heap(heap_.begin(), heap_.end(), Later);
+    Entry entry = std::move(heap_.back());
+    heap_.pop_back();
+
+    released_time_ = entry.time_;
+
+    if (const IMU* imu = std::get_if<IMU>(&entry.reading_)) {
+        ++stats_.num_released_[0];
+        if (imu_proc_) {
+            imu_proc_(*imu);
+        }
+    } else if (const Odom* odom = std::get_if<Odom>(&entry.reading_)) {
+        ++stats_.num_released_[1];
+        if (odom_proc_) {
+            odom_proc_(*odom);
+        }
+    } else {
+        ++stats_.num_released_[2];
+        if (gnss_proc_) {
+            gnss_proc_(std::get<GNSS>(entry.reading_));
+        }
+    }
+}
+
+std::string SensorSynchronizer::StatsString() const {
+    std::ostringstream ss;
+    ss << "sync: released imu/odom/gnss " << stats_.num_released_[0] << "/" << stats_.num_released_[1] << "/"
+       << stats_.num_released_[2] << ", late dropped " << stats_.num_late_[0] << "/" << stats_.num_late_[1] << "/"
+       << stats_.num_late_[2] << " (max " << stats_.max_late_ << " s), reordered " << stats_.num_reordered_
+       << ", forced " << stats_.num_forced_ << ", max buffered " << stats_.max_buffered_;
+    return ss.str();
+}
+
+}  // namespace imu_gps
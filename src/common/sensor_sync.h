@@ -0,0 +1,119 @@
+#ifndef IMU_GPS_SENSOR_SYNC_H
+#define IMU_GPS_SENSOR_SYNC_H
+
+#include "common/gnss.h"
+#include "common/imu.h"
+#include "common/odom.h"
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace imu_gps {
+
+/**
+ * Reorders IMU/Odom/GNSS readings that arrive with jitter into strict time order.
+ *
+ * Readings are kept in a min-heap on their timestamp (GNSS uses unix_time_). A reading is released once the newest
+ * timestamp seen is more than latency_window_ ahead of it, so any disorder smaller than the window is repaired and
+ * every reading is delayed by at most the window. Readings older than the last released one can no longer be placed
+ * in order; they are dropped and counted as late. Readings with equal timestamps are released in arrival order.
+ *
+ * The callbacks see non-decreasing timestamps across all three sensors, which is what ESKF asserts.
+ * Usage mirrors TxtIO: set the callbacks, feed readings with Add*, and call Flush() at the end of the stream.
+ */
+class SensorSynchronizer {
+   public:
+    struct Options {
+        Options() {}
+        double latency_window_ = 0.1;  // Sensor time a reading is held back to wait for earlier ones, seconds
+        size_t max_buffered_ = 4096;   // Readings held at most, the oldest is released early beyond that
+    };
+
+    /// Counters by sensor, index 0 IMU, 1 Odom, 2 GNSS
+    struct Stats {
+        size_t num_received_[3] = {0, 0, 0};
+        size_t num_released_[3] = {0, 0, 0};
+        size_t num_late_[3] = {0, 0, 0};  // Dropped because they arrived after a later reading was released
+        size_t num_reordered_ = 0;        // Readings that arrived older than the newest buffered one
+        size_t num_forced_ = 0;           // Readings released early because max_buffered_ was reached
+        size_t max_buffered_ = 0;         // Largest number of readings held at once
+        double max_late_ = 0;             // Largest lateness of a dropped reading, seconds
+
+        size_t NumLate() const { return num_late_[0] + num_late_[1] + num_late_[2]; }
+    };
+
+    using IMUProcessFuncType = std::function<void(const IMU&)>;
+    using OdomProcessFuncType = std::function<void(const Odom&)>;
+    using GNSSProcessFuncType = std::function<void(const GNSS&)>;
+
+    explicit SensorSynchronizer(Options options = Options());
+
+    SensorSynchronizer& SetIMUProcessFunc(IMUProcessFuncType imu_proc) {
+        imu_proc_ = std::move(imu_proc);
+        return *this;
+    }
+
+    SensorSynchronizer& SetOdomProcessFunc(OdomProcessFuncType odom_proc) {
+        odom_proc_ = std::move(odom_proc);
+        return *this;
+    }
+
+    SensorSynchronizer& SetGNSSProcessFunc(GNSSProcessFuncType gnss_proc) {
+        gnss_proc_ = std::move(gnss_proc);
+        return *this;
+    }
+
+    void AddIMU(const IMU& imu) { Add(imu.timestamp_, imu); }
+    void AddOdom(const Odom& odom) { Add(odom.timestamp_, odom); }
+    void AddGNSS(const GNSS& gnss) { Add(gnss.unix_time_, gnss); }
+
+    /// Release every buffered reading with a timestamp up to t, e.g. driven by a clock when a sensor goes quiet
+    void ReleaseUntil(double t);
+
+    /// Release everything, call at the end of a stream
+    void Flush() { ReleaseUntil(std::numeric_limits<double>::max()); }
+
+    size_t NumBuffered() const { return heap_.size(); }
+    const Stats& GetStats() const { return stats_; }
+
+    /// One line summary of the statistics for logging
+    std::string StatsString() const;
+
+   private:
+    using Reading = std::variant<IMU, Odom, GNSS>;
+
+    struct Entry {
+        double time_ = 0;
+        uint64_t seq_ = 0;  // Arrival order, breaks ties between equal timestamps
+        Reading reading_;
+    };
+
+    /// Heap order: the earliest (time, seq) on top
+    static bool Later(const Entry& a, const Entry& b) {
+        return a.time_ > b.time_ || (a.time_ == b.time_ && a.seq_ > b.seq_);
+    }
+
+    void Add(double t, Reading reading);
+
+    /// Pop the earliest reading and hand it to its callback
+    void ReleaseTop();
+
+    Options options_;
+    std::vector<Entry> heap_;
+    uint64_t next_seq_ = 0;
+    double newest_time_ = std::numeric_limits<double>::lowest();    // Newest timestamp received
+    double released_time_ = std::numeric_limits<double>::lowest();  // Timestamp of the last released reading
+    Stats stats_;
+
+    IMUProcessFuncType imu_proc_;
+    OdomProcessFuncType odom_proc_;
+    GNSSProcessFuncType gnss_proc_;
+};
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_SENSOR_SYNC_H
@@ -0,0 +1,80 @@
+#ifndef IMU_GPS_SPSC_RING_H
+#define IMU_GPS_SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace imu_gps {
+
+/**
+ * Bounded lock-free single-producer/single-consumer ring buffer.
+ *
+ * Exactly one thread may call TryPush() and exactly one (other) thread may call TryPop(). Neither call ever blocks:
+ * TryPush() returns false when the ring is full and TryPop() returns false when it is empty. The capacity is rounded
+ * up to a power of two. Head and tail live on separate cache lines so the two threads do not false-share.
+ */
+template <typename T>
+class SpscRing {
+   public:
+    explicit SpscRing(size_t capacity = 1024) {
+        size_t n = 2;
+        while (n < capacity) {
+            n <<= 1;
+        }
+        slots_.resize(n);
+        mask_ = n - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /// Producer side, copies the value into the ring. Returns false if the ring is full.
+    bool TryPush(const T& value) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ > mask_) {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer side, moves the oldest value out of the ring. Returns false if the ring is empty.
+    bool TryPop(T& value) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) {
+                return false;
+            }
+        }
+        value = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Approximate number of queued values, exact only when called from one of the two sides while the other is idle
+    size_t Size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+
+    size_t Capacity() const { return mask_ + 1; }
+
+   private:
+    static constexpr size_t kCacheLine = 64;
+
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+
+    alignas(kCacheLine) std::atomic<size_t> head_{0};  // Next slot to pop, written by the consumer
+    size_t tail_cache_ = 0;                            // Consumer's copy of tail_
+
+    alignas(kCacheLine) std::atomic<size_t> tail_{0};  // Next slot to push, written by the producer
+    size_t head_cache_ = 0;                            // Producer's copy of head_
+};
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_SPSC_RING_H
@@ -1,20 +1,133 @@
 #include "timer.h"
 
 #include <glog/logging.h>
+#include <algorithm>
 #include <fstream>
-#include <numeric>
 
 namespace imu_gps::common {
 
-std::map<std::string, Timer::TimerRecord> Timer::records_;
+std::map<std::string, int> Timer::ids_;
+std::vector<std::string> Timer::names_;
+std::vector<std::unique_ptr<Timer::ThreadBuckets>> Timer::threads_;
+std::mutex Timer::mtx_;
+
+void Timer::Histogram::Reset() {
+    for (auto& b : buckets_) {
+        b.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_ns_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+}
+
+void Timer::Histogram::MergeInto(std::vector<uint64_t>& buckets, uint64_t& count, uint64_t& sum_ns,
+                                 uint64_t& max_ns) const {
+    for (int i = 0; i < kNumBuckets; ++i) {
+        buckets[i] += buckets_[i].load(std::memory_order_relaxed);
+    }
+    count += count_.load(std::memory_order_relaxed);
+    sum_ns += sum_ns_.load(std::memory_order_relaxed);
+    max_ns = std::max(max_ns, max_ns_.load(std::memory_order_relaxed));
+}
+
+double Timer::Histogram::BucketValue(int idx) {
+    if (idx < 2 * kSubCount) {
+        return idx;
+    }
+    const int e = idx / kSubCount + kSubBits - 1;
+    const int m = idx % kSubCount;
+    const double width = double(uint64_t(1) << (e - kSubBits));
+    return (kSubCount + m) * width + 0.5 * width;
+}
+
+int Timer::Register(const std::string& func_name) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = ids_.find(func_name);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    if (int(names_.size()) >= kMaxTimers) {
+        LOG(ERROR) << "Too many timers, " << func_name << " is not recorded";
+        return -1;
+    }
+    const int id = names_.size();
+    names_.emplace_back(func_name);
+    ids_.emplace(func_name, id);
+    return id;
+}
+
+Timer::ThreadBuckets* Timer::RegisterThread() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    threads_.emplace_back(std::make_unique<ThreadBuckets>());
+    return threads_.back().get();
+}
+
+Timer::Histogram& Timer::CreateHistogram(ThreadBuckets& tb, int id) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    tb.owned_.emplace_back(std::make_unique<Histogram>());
+    Histogram* h = tb.owned_.back().get();
+    tb.hist_[id].store(h, std::memory_order_release);
+    return *h;
+}
+
+Timer::Summary Timer::Merge(int id) {
+    // called with mtx_ held
+    std::vector<uint64_t> buckets(Histogram::kNumBuckets, 0);
+    uint64_t count = 0, sum_ns = 0, max_ns = 0;
+    for (const auto& tb : threads_) {
+        const Histogram* h = tb->hist_[id].load(std::memory_order_acquire);
+        if (h) {
+            h->MergeInto(buckets, count, sum_ns, max_ns);
+        }
+    }
+
+    Summary s;
+    s.func_name_ = names_[id];
+    s.count_ = count;
+    if (count == 0) {
+        return s;
+    }
+
+    constexpr double ns2ms = 1e-6;
+    s.mean_ms_ = double(sum_ns) / double(count) * ns2ms;
+    s.max_ms_ = double(max_ns) * ns2ms;
+
+    // the value of the bucket holding the q-th sample, capped by the exact max
+    auto quantile = [&](double q) {
+        const uint64_t rank = std::max<uint64_t>(1, uint64_t(q * double(count) + 0.5));
+        uint64_t seen = 0;
+        for (int i = 0; i < Histogram::kNumBuckets; ++i) {
+            seen += buckets[i];
+            if (seen >= rank) {
+                return std::min(Histogram::BucketValue(i), double(max_ns)) * ns2ms;
+            }
+        }
+        return s.max_ms_;
+    };
+    s.p50_ms_ = quantile(0.5);
+    s.p99_ms_ = quantile(0.99);
+    s.p999_ms_ = quantile(0.999);
+    return s;
+}
+
+std::vector<Timer::Summary> Timer::GetSummaries() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::vector<Summary> summaries;
+    for (int id = 0; id < int(names_.size()); ++id) {
+        Summary s = Merge(id);
+        if (s.count_ > 0) {
+            summaries.emplace_back(std::move(s));
+        }
+    }
+    return summaries;
+}
 
 void Timer::PrintAll() {
     LOG(INFO) << ">>> ===== Printing run time =====";
-    for (const auto& r : records_) {
-        LOG(INFO) << "> [ " << r.first << " ] average time usage: "
-                  << std::accumulate(r.second.time_usage_in_ms_.begin(), r.second.time_usage_in_ms_.end(), 0.0) /
-                         double(r.second.time_usage_in_ms_.size())
-                  << " ms , called times: " << r.second.time_usage_in_ms_.size();
+    for (const auto& s : GetSummaries()) {
+        LOG(INFO) << "> [ " << s.func_name_ << " ] average time usage: " << s.mean_ms_ << " ms , called times: "
+                  << s.count_ << ", p50 " << s.p50_ms_ << " ms, p99 " << s.p99_ms_ << " ms, p999 " << s.p999_ms_
+                  << " ms, max " << s.max_ms_ << " ms";
     }
     LOG(INFO) << ">>> ===== Printing run time end =====";
 }
@@ -28,36 +141,30 @@ void Timer::DumpIntoFile(const std::string& file_name) {
         LOG(INFO) << "Dump Time Records into file: " << file_name;
     }
 
-    size_t max_length = 0;
-    for (const auto& iter : records_) {
-        ofs << iter.first << ", ";
-        if (iter.second.time_usage_in_ms_.size() > max_length) {
-            max_length = iter.second.time_usage_in_ms_.size();
-        }
-    }
-    ofs << std::endl;
-
-    for (size_t i = 0; i < max_length; ++i) {
-        for (const auto& iter : records_) {
-            if (i < iter.second.time_usage_in_ms_.size()) {
-                ofs << iter.second.time_usage_in_ms_[i] << ",";
-            } else {
-                ofs << ",";
-            }
-        }
-        ofs << std::endl;
+    ofs << "name,count,mean_ms,p50_ms,p99_ms,p999_ms,max_ms\n";
+    for (const auto& s : GetSummaries()) {
+        ofs << s.func_name_ << "," << s.count_ << "," << s.mean_ms_ << "," << s.p50_ms_ << "," << s.p99_ms_ << ","
+            << s.p999_ms_ << "," << s.max_ms_ << "\n";
     }
     ofs.close();
 }
 
 double Timer::GetMeanTime(const std::string& func_name) {
-    if (records_.find(func_name) == records_.end()) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = ids_.find(func_name);
+    if (it == ids_.end()) {
         return 0.0;
     }
+    return Merge(it->second).mean_ms_;
+}
 
-    auto r = records_[func_name];
-    return std::accumulate(r.time_usage_in_ms_.begin(), r.time_usage_in_ms_.end(), 0.0) /
-           double(r.time_usage_in_ms_.size());
+void Timer::Clear() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (const auto& tb : threads_) {
+        for (const auto& h : tb->owned_) {
+            h->Reset();
+        }
+    }
 }
 
-}  // namespace imu_gps::utils
\ No newline at end of file
+}  // namespace imu_gps::utils
@@ -1,63 +1,177 @@
 #ifndef FUSION_TIMER_H
 #define FUSION_TIMER_H
 
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 namespace imu_gps::common {
 
 /// Time statistics utility
+///
+/// Every timer is identified by an integer id obtained once from Register(), e.g.
+///     static const int kPredictTimer = Timer::Register("Predict");
+///     { Timer::Scope t(kPredictTimer); filter.Predict(imu); }
+/// Recording goes into a fixed-size log-linear histogram (~3% resolution, HDR style) owned by the calling thread, so
+/// the hot path takes no lock, does no string lookup and allocates nothing after the first sample of a thread.
+/// The histograms of all threads are merged when reporting, including threads that have already finished.
 /// NOTE: There seems to be an issue when using Timer within gtest
 class Timer {
    public:
-    struct TimerRecord {
-        TimerRecord() = default;
-        TimerRecord(const std::string& name, double time_usage) {
-            func_name_ = name;
-            time_usage_in_ms_.emplace_back(time_usage);
-        }
+    /// Maximum number of distinct timers
+    static constexpr int kMaxTimers = 128;
+
+    /// Merged statistics of one timer, all times in milliseconds
+    struct Summary {
         std::string func_name_;
-        std::vector<double> time_usage_in_ms_;
+        uint64_t count_ = 0;
+        double mean_ms_ = 0;
+        double p50_ms_ = 0;
+        double p99_ms_ = 0;
+        double p999_ms_ = 0;
+        double max_ms_ = 0;
     };
 
+    /// Fixed-memory latency histogram in nanoseconds, written by a single thread, readable from any thread
+    class Histogram {
+       public:
+        static constexpr int kSubBits = 5;                    // 32 linear sub-buckets per power of two
+        static constexpr int kSubCount = 1 << kSubBits;
+        static constexpr int kNumBuckets = (64 - kSubBits + 1) * kSubCount;
+
+        void Record(uint64_t ns) {
+            Add(buckets_[BucketIndex(ns)], 1);
+            Add(count_, 1);
+            Add(sum_ns_, ns);
+            if (ns > max_ns_.load(std::memory_order_relaxed)) {
+                max_ns_.store(ns, std::memory_order_relaxed);
+            }
+        }
+
+        void Reset();
+
+        /// Add this histogram into the counters of a plain merge buffer
+        void MergeInto(std::vector<uint64_t>& buckets, uint64_t& count, uint64_t& sum_ns, uint64_t& max_ns) const;
+
+        static int BucketIndex(uint64_t ns) {
+            if (ns < 2 * kSubCount) {
+                return int(ns);
+            }
+            const int e = 63 - __builtin_clzll(ns);  // >= kSubBits + 1
+            return (e - kSubBits + 1) * kSubCount + int((ns >> (e - kSubBits)) & (kSubCount - 1));
+        }
+
+        /// Middle of the value range covered by a bucket
+        static double BucketValue(int idx);
+
+       private:
+        /// Single writer, so a relaxed load/store pair is enough and avoids a locked instruction
+        static void Add(std::atomic<uint64_t>& c, uint64_t v) {
+            c.store(c.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+        }
+
+        std::array<std::atomic<uint64_t>, kNumBuckets> buckets_{};
+        std::atomic<uint64_t> count_{0};
+        std::atomic<uint64_t> sum_ns_{0};
+        std::atomic<uint64_t> max_ns_{0};
+    };
+
+    /// RAII timer, records the time between construction and destruction
+    class Scope {
+       public:
+        explicit Scope(int id) : id_(id), t1_(std::chrono::steady_clock::now()) {}
+        ~Scope() { Record(id_, std::chrono::steady_clock::now() - t1_); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+       private:
+        int id_;
+        std::chrono::steady_clock::time_point t1_;
+    };
+
+    /**
+     * Get the id of a timer, registering it on the first call with this name.
+     * Ids stay valid for the whole program, also across Clear(). Returns -1 if kMaxTimers is exceeded.
+     */
+    static int Register(const std::string& func_name);
+
+    /// Record one duration for a registered timer
+    static void Record(int id, std::chrono::steady_clock::duration d) {
+        if (id < 0 || id >= kMaxTimers) {
+            return;
+        }
+        LocalHistogram(id).Record(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()));
+    }
+
     /**
      * Evaluate and record the time taken by a function
      * @tparam F
      * @param func The function to be evaluated
+     * @param id Timer id from Register()
+     */
+    template <class F>
+    static void Evaluate(F&& func, int id) {
+        Scope t(id);
+        std::forward<F>(func)();
+    }
+
+    /**
+     * Evaluate and record the time taken by a function
+     * Convenience form that looks the name up on every call, prefer the id form on hot paths.
+     * @tparam F
+     * @param func The function to be evaluated
      * @param func_name The name of the function being evaluated
      */
     template <class F>
     static void Evaluate(F&& func, const std::string& func_name) {
-        auto t1 = std::chrono::steady_clock::now();
-        std::forward<F>(func)();
-        auto t2 = std::chrono::steady_clock::now();
-        auto time_used = std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count() * 1000;
-
-        // Record the time taken
-        if (records_.find(func_name) != records_.end()) {
-            records_[func_name].time_usage_in_ms_.emplace_back(time_used);
-        } else {
-            records_.insert({func_name, TimerRecord(func_name, time_used)});
-        }
+        Evaluate(std::forward<F>(func), Register(func_name));
     }
 
-    /// Print the recorded times for all functions
+    /// Print count, mean, p50/p99/p999 and max of all timers
     static void PrintAll();
 
-    /// Write the recorded times to a file for further analysis (e.g., graphing)
+    /// Write the statistics of all timers to a csv file for further analysis (e.g., graphing)
     static void DumpIntoFile(const std::string& file_name);
 
+    /// Merged statistics of all timers that have samples, in registration order
+    static std::vector<Summary> GetSummaries();
+
     /// Get the average execution time of a specific function
     static double GetMeanTime(const std::string& func_name);
 
-    /// Clear all recorded times
-    static void Clear() { records_.clear(); }
+    /// Clear all recorded times, the registered ids stay valid
+    static void Clear();
 
    private:
-    static std::map<std::string, TimerRecord> records_;
+    /// Histograms of one thread, kept alive after the thread exits so its samples are still reported
+    struct ThreadBuckets {
+        std::array<std::atomic<Histogram*>, kMaxTimers> hist_{};
+        std::vector<std::unique_ptr<Histogram>> owned_;
+    };
+
+    static Histogram& LocalHistogram(int id) {
+        thread_local ThreadBuckets* local = RegisterThread();
+        Histogram* h = local->hist_[id].load(std::memory_order_relaxed);
+        return h ? *h : CreateHistogram(*local, id);
+    }
+
+    static ThreadBuckets* RegisterThread();
+    static Histogram& CreateHistogram(ThreadBuckets& tb, int id);
+
+    static Summary Merge(int id);
+
+    static std::map<std::string, int> ids_;
+    static std::vector<std::string> names_;
+    static std::vector<std::unique_ptr<ThreadBuckets>> threads_;
+    static std::mutex mtx_;
 };
 
 }  // namespace imu_gps::utils
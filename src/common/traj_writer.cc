@@ -0,0 +1,139 @@
+#include "common/traj_writer.h"
+
+#include <glog/logging.h>
+#include <charconv>
+#include <cstring>
+
+namespace imu_gps {
+
+namespace {
+
+/// Same as printing with iostream setprecision(precision) in the default float format
+inline void AppendNumber(std::string& buf, double v, int precision) {
+    char tmp[32];
+    auto [ptr, ec] = std::to_chars(tmp, tmp + sizeof(tmp), v, std::chars_format::general, precision);
+    buf.append(tmp, ptr - tmp);
+    buf.push_back(' ');
+}
+
+}  // namespace
+
+TrajectoryWriter::TrajectoryWriter(const std::string& file_path, Format format, size_t buffer_size)
+    : format_(format), buffer_size_(buffer_size) {
+    fp_ = std::fopen(file_path.c_str(), format_ == Format::BINARY ? "wb" : "w");
+    if (fp_ == nullptr) {
+        LOG(ERROR) << "Failed to open file: " << file_path;
+        return;
+    }
+
+    // Buffering is done here, the FILE buffer would only add another copy
+    std::setvbuf(fp_, nullptr, _IONBF, 0);
+
+    front_.reserve(buffer_size_ + 256);
+    back_.reserve(buffer_size_ + 256);
+    thread_ = std::thread([this]() { WriterLoop(); });
+}
+
+TrajectoryWriter::~TrajectoryWriter() { Close(); }
+
+void TrajectoryWriter::Write(double timestamp, const double* values, size_t num_values) {
+    if (fp_ == nullptr) {
+        return;
+    }
+
+    if (format_ == Format::TEXT) {
+        AppendNumber(front_, timestamp, 18);
+        for (size_t i = 0; i < num_values; ++i) {
+            AppendNumber(front_, values[i], 9);
+        }
+        front_.push_back('\n');
+    } else {
+        if (num_fields_ == 0) {
+            BinaryHeader header;
+            header.num_fields_ = num_fields_ = uint32_t(num_values + 1);
+            front_.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        }
+        DCHECK_EQ(num_fields_, num_values + 1) << "all records of a binary trajectory need the same size";
+        front_.append(reinterpret_cast<const char*>(&timestamp), sizeof(double));
+        front_.append(reinterpret_cast<const char*>(values), num_values * sizeof(double));
+    }
+
+    if (front_.size() >= buffer_size_) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        SwapBuffers(lock);
+    }
+}
+
+void TrajectoryWriter::Write(const NavStated& state) {
+    const Quatd& q = state.R_.unit_quaternion();
+    const double values[] = {state.p_[0],  state.p_[1],  state.p_[2],  q.w(),        q.x(),
+                             q.y(),        q.z(),        state.v_[0],  state.v_[1],  state.v_[2],
+                             state.bg_[0], state.bg_[1], state.bg_[2], state.ba_[0], state.ba_[1],
+                             state.ba_[2]};
+    Write(state.timestamp_, values, sizeof(values) / sizeof(double));
+}
+
+void TrajectoryWriter::Write(double timestamp, const SE3& pose) {
+    const Quatd& q = pose.unit_quaternion();
+    const Vec3d& p = pose.translation();
+    Write(timestamp, {p[0], p[1], p[2], q.w(), q.x(), q.y(), q.z()});
+}
+
+void TrajectoryWriter::SwapBuffers(std::unique_lock<std::mutex>& lock) {
+    cv_.wait(lock, [this]() { return !back_pending_; });
+    std::swap(front_, back_);
+    back_pending_ = true;
+    cv_.notify_all();
+}
+
+void TrajectoryWriter::Flush() {
+    if (fp_ == nullptr) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (!front_.empty()) {
+        SwapBuffers(lock);
+    }
+    cv_.wait(lock, [this]() { return !back_pending_; });
+}
+
+void TrajectoryWriter::Close() {
+    if (fp_ == nullptr) {
+        return;
+    }
+
+    Flush();
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        exit_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+
+    std::fclose(fp_);
+    fp_ = nullptr;
+}
+
+void TrajectoryWriter::WriterLoop() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (true) {
+        cv_.wait(lock, [this]() { return back_pending_ || exit_; });
+        if (!back_pending_) {
+            break;
+        }
+
+        // back_ is owned by this thread until back_pending_ is cleared
+        lock.unlock();
+        if (std::fwrite(back_.data(), 1, back_.size(), fp_) != back_.size()) {
+            LOG(ERROR) << "Failed to write trajectory data.";
+        }
+        back_.clear();
+        lock.lock();
+
+        back_pending_ = false;
+        cv_.notify_all();
+    }
+}
+
+}  // namespace imu_gps
@@ -0,0 +1,94 @@
+#ifndef IMU_GPS_TRAJ_WRITER_H
+#define IMU_GPS_TRAJ_WRITER_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "common/eigen_types.h"
+#include "common/nav_state.h"
+
+namespace imu_gps {
+
+/**
+ * Buffered trajectory sink.
+ *
+ * Records are formatted into an in-memory buffer on the caller's thread and handed to a background thread that
+ * writes them to disk, so the caller never waits for a syscall unless both buffers are full.
+ *
+ * Text format: one line per record, "timestamp v0 v1 ... \n", with 18 significant digits for the timestamp and 9 for
+ * the values (the same output as iostream setprecision(18)/setprecision(9)).
+ * Binary format: a BinaryHeader followed by records of num_fields_ little-endian doubles (timestamp first).
+ */
+class TrajectoryWriter {
+   public:
+    enum class Format {
+        TEXT,
+        BINARY,
+    };
+
+#pragma pack(push, 1)
+    struct BinaryHeader {
+        char magic_[8] = {'I', 'G', 'T', 'R', 'A', 'J', '\r', '\n'};
+        uint32_t version_ = 1;
+        uint32_t num_fields_ = 0;  // Number of doubles per record, including the timestamp
+    };
+#pragma pack(pop)
+
+    /**
+     * @param file_path Output file
+     * @param format Text or binary output
+     * @param buffer_size Size of each of the two buffers in bytes
+     */
+    explicit TrajectoryWriter(const std::string& file_path, Format format = Format::TEXT,
+                              size_t buffer_size = 1 << 20);
+    ~TrajectoryWriter();
+
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+    bool IsOpen() const { return fp_ != nullptr; }
+
+    /// Append a record made of a timestamp and a list of values
+    void Write(double timestamp, std::initializer_list<double> values) { Write(timestamp, values.begin(), values.size()); }
+    void Write(double timestamp, const double* values, size_t num_values);
+
+    /// Append a navigation state as "t p q(wxyz) v bg ba"
+    void Write(const NavStated& state);
+
+    /// Append a pose as "t p q(wxyz)"
+    void Write(double timestamp, const SE3& pose);
+
+    /// Block until everything written so far is on disk
+    void Flush();
+
+    /// Flush and close the file, also called by the destructor
+    void Close();
+
+   private:
+    /// Hand the front buffer to the background thread, waits if it is still busy with the previous one
+    void SwapBuffers(std::unique_lock<std::mutex>& lock);
+
+    void WriterLoop();
+
+    FILE* fp_ = nullptr;
+    Format format_ = Format::TEXT;
+    size_t buffer_size_ = 0;
+    uint32_t num_fields_ = 0;
+
+    std::string front_;  // Filled by the caller
+    std::string back_;   // Being written by the background thread
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool back_pending_ = false;
+    bool exit_ = false;
+    std::thread thread_;
+};
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_TRAJ_WRITER_H
@@ -10,10 +10,32 @@
 #include "common/odom.h"
 
 #include <glog/logging.h>
+#include <array>
 #include <iomanip>
 
 namespace imu_gps {
 
+/**
+ * Composition of the ESKF error state. p, v and theta are always estimated and come first, the optional bg, ba and
+ * grav blocks follow in that order. A block that is not estimated keeps its initial value and drops out of the
+ * covariance, so all matrices shrink to kDim at compile time.
+ */
+template <bool kWithBiasGyro, bool kWithBiasAcce, bool kWithGravity>
+struct ESKFStateLayout {
+    static constexpr int kP = 0;
+    static constexpr int kV = 3;
+    static constexpr int kTheta = 6;
+    // Offsets of the optional blocks, -1 if not estimated
+    static constexpr int kBg = kWithBiasGyro ? 9 : -1;
+    static constexpr int kBa = kWithBiasAcce ? 9 + 3 * kWithBiasGyro : -1;
+    static constexpr int kGrav = kWithGravity ? 9 + 3 * (kWithBiasGyro + kWithBiasAcce) : -1;
+    static constexpr int kDim = 9 + 3 * (kWithBiasGyro + kWithBiasAcce + kWithGravity);
+};
+
+using ESKFLayout18 = ESKFStateLayout<true, true, true>;     // p, v, R, bg, ba, grav, as in the book
+using ESKFLayout15 = ESKFStateLayout<true, true, false>;    // known gravity
+using ESKFLayout9 = ESKFStateLayout<false, false, false>;   // integration only, fixed biases and gravity
+
 /**
  * Error-state Kalman Filter introduced in Chapter 3 of the book.
  * The filter can be specified to observe GNSS readings, which
@@ -21,20 +43,32 @@ namespace imu_gps {
  * This book uses an 18-dimensional ESKF, and the scalar type
  *  can be specified by S, with the default being double.
  * Variable order: p, v, R, bg, ba, grav, corresponding to the book.
+ *
+ * Readings, poses and options stay double at the interface and are
+ *  converted once on entry, all state and covariance arithmetic is
+ *  done in S. Timestamps are always kept in double. With S = float the
+ *  positions must be given relative to a local origin (as GinsReplay
+ *  does with the first GNSS position), raw UTM coordinates do not fit
+ *  into a float mantissa.
  * @tparam S Precision of the state variables, can be float or double
+ * @tparam L Error-state layout, see ESKFStateLayout
  */
-template <typename S = double>
+template <typename S = double, typename L = ESKFLayout18>
 class ESKF {
    public:
     /// Type definitions
+    using Layout = L;
+    static constexpr int kDim = L::kDim;  // Error-state dimension
+
     using SO3 = Sophus::SO3<S>;
     using VecT = Eigen::Matrix<S, 3, 1>;
-    using Vec18T = Eigen::Matrix<S, 18, 1>;
+    using Vec6T = Eigen::Matrix<S, 6, 1>;
+    using StateVecT = Eigen::Matrix<S, kDim, 1>;
     using Mat3T = Eigen::Matrix<S, 3, 3>;
-    using MotionNoiseT = Eigen::Matrix<S, 18, 18>;
+    using MotionNoiseT = Eigen::Matrix<S, kDim, kDim>;
     using OdomNoiseT = Eigen::Matrix<S, 3, 3>;
     using GnssNoiseT = Eigen::Matrix<S, 6, 6>;
-    using Mat18T = Eigen::Matrix<S, 18, 18>;
+    using CovT = Eigen::Matrix<S, kDim, kDim>;
     using NavStateT =
         NavState<S>;  // Type for the overall nominal state variables
 
@@ -52,15 +86,27 @@ class ESKF {
      * @param init_ba Initial accelerometer bias
      * @param gravity Gravity
      */
-    void SetInitialConditions(Options options, const VecT& init_bg,
-                              const VecT& init_ba,
-                              const VecT& gravity = VecT(0, 0, -9.8)) {
+    void SetInitialConditions(Options options, const Vec3d& init_bg,
+                              const Vec3d& init_ba,
+                              const Vec3d& gravity = Vec3d(0, 0, -9.8)) {
+        BuildNoise(options);
+        options_ = options;
+        bg_ = init_bg.template cast<S>();
+        ba_ = init_ba.template cast<S>();
+        g_ = gravity.template cast<S>();
+        cov_ = CovT::Identity() * 1e-4;
+        ResetPreintegration();
+    }
+
+    /**
+     * Replace the options of a running filter, e.g. reloaded from a config file.
+     * The noise matrices are rebuilt, the state and covariance are kept.
+     * Pending pre-integrated samples are applied with the previous noise first.
+     */
+    void SetOptions(const Options& options) {
+        FlushCov();
         BuildNoise(options);
         options_ = options;
-        bg_ = init_bg;
-        ba_ = init_ba;
-        g_ = gravity;
-        cov_ = Mat18T::Identity() * 1e-4;
     }
 
     /// Propagate using IMU measurements
@@ -69,7 +115,11 @@ class ESKF {
     /// Observe wheel speed measurements
     bool ObserveWheelSpeed(const Odom& odom);
 
-    /// Observe GPS measurements
+    /**
+     * Observe GPS measurements, with the noise scaled by the fix quality (ESKFOptions::GnssNoiseScale) and gated
+     * by gnss_gate_chi2_. Fixes without a valid heading only observe the position, gated by GnssGateChi2(3).
+     * @return false if the fix was rejected by the gate
+     */
     bool ObserveGps(const GNSS& gnss);
 
     /**
@@ -77,10 +127,14 @@ class ESKF {
      * @param pose Observed pose
      * @param trans_noise Translation noise
      * @param ang_noise Angle noise
-     * @return
+     * @param gate_chi2 If > 0, reject the observation if its squared Mahalanobis innovation is above it
+     * @return false if rejected by the gate, the state and covariance are then unchanged
      */
     bool ObserveSE3(const SE3& pose, double trans_noise = 0.1,
-                    double ang_noise = 1.0 * math::kDEG2RAD);
+                    double ang_noise = 1.0 * math::kDEG2RAD, double gate_chi2 = 0);
+
+    /// Observe a position only, e.g. a GNSS fix without heading, noise as in ObserveSE3, gate on the 3-DoF innovation
+    bool ObservePosition(const Vec3d& pos, double trans_noise = 0.1, double gate_chi2 = 0);
 
     /// Get full state
     NavStateT GetNominalState() const {
@@ -88,64 +142,144 @@ class ESKF {
     }
 
     /// Get SE3 state
-    SE3 GetNominalSE3() const { return SE3(R_, p_); }
+    SE3 GetNominalSE3() const { return SE3(R_.template cast<double>(), p_.template cast<double>()); }
 
     /// Set state X
     void SetX(const NavStated& x, const Vec3d& grav) {
         current_time_ = x.timestamp_;
-        R_ = x.R_;
-        p_ = x.p_;
-        v_ = x.v_;
-        bg_ = x.bg_;
-        ba_ = x.ba_;
-        g_ = grav;
+        R_ = x.R_.template cast<S>();
+        p_ = x.p_.template cast<S>();
+        v_ = x.v_.template cast<S>();
+        bg_ = x.bg_.template cast<S>();
+        ba_ = x.ba_.template cast<S>();
+        g_ = grav.template cast<S>();
     }
 
     /// Set covariance
-    void SetCov(const Mat18T& cov) { cov_ = cov; }
+    void SetCov(const CovT& cov) {
+        cov_ = cov;
+        ResetPreintegration();
+    }
+
+    /// Get covariance, pending pre-integrated samples are applied first
+    const CovT& GetCov() {
+        FlushCov();
+        return cov_;
+    }
+
+    /**
+     * Apply the transition and noise accumulated since the last covariance
+     * propagation (see ESKFOptions::cov_predict_interval_). Called before
+     * every observation, does nothing when no samples are pending.
+     */
+    void FlushCov();
 
     /// Get gravity
-    Vec3d GetGravity() const { return g_; }
+    Vec3d GetGravity() const { return g_.template cast<double>(); }
+
+    /**
+     * Resume from a saved state, the first GNSS reading is taken as received.
+     * Exact when saved after an observation, where no pre-integrated samples are pending.
+     */
+    void Restore(const NavStated& x, const Vec3d& grav, const CovT& cov) {
+        SetX(x, grav);
+        SetCov(cov);
+        first_gnss_ = false;
+    }
 
    private:
     void BuildNoise(const Options& options) {
-        double ev = options.acce_var_;
-        double et = options.gyro_var_;
-        double eg = options.bias_gyro_var_;
-        double ea = options.bias_acce_var_;
-
-        double ev2 = ev;  // * ev;
-        double et2 = et;  // * et;
-        double eg2 = eg;  // * eg;
-        double ea2 = ea;  // * ea;
-
-        // Set process noise
-        Q_.diagonal() << 0, 0, 0, ev2, ev2, ev2, et2, et2, et2, eg2, eg2, eg2,
-            ea2, ea2, ea2, 0, 0, 0;
+        S ev = S(options.acce_var_);
+        S et = S(options.gyro_var_);
+        S eg = S(options.bias_gyro_var_);
+        S ea = S(options.bias_acce_var_);
+
+        S ev2 = ev;  // * ev;
+        S et2 = et;  // * et;
+        S eg2 = eg;  // * eg;
+        S ea2 = ea;  // * ea;
+
+        // Set process noise, zero for p and grav
+        Q_.setZero();
+        Q_.diagonal().template segment<3>(L::kV).setConstant(ev2);
+        Q_.diagonal().template segment<3>(L::kTheta).setConstant(et2);
+        if constexpr (L::kBg >= 0) {
+            Q_.diagonal().template segment<3>(L::kBg).setConstant(eg2);
+        }
+        if constexpr (L::kBa >= 0) {
+            Q_.diagonal().template segment<3>(L::kBa).setConstant(ea2);
+        }
 
         // Set measurement (odometry) noise
-        double o2 = options_.odom_var_ * options_.odom_var_;
+        S o2 = S(options.odom_var_ * options.odom_var_);
         odom_noise_.diagonal() << o2, o2, o2;
 
         // Set measurement (GNSS) noise
-        double gp2 = options.gnss_pos_noise_ * options.gnss_pos_noise_;
-        double gh2 = options.gnss_height_noise_ * options.gnss_height_noise_;
-        double ga2 = options.gnss_ang_noise_ * options.gnss_ang_noise_;
+        S gp2 = S(options.gnss_pos_noise_ * options.gnss_pos_noise_);
+        S gh2 = S(options.gnss_height_noise_ * options.gnss_height_noise_);
+        S ga2 = S(options.gnss_ang_noise_ * options.gnss_ang_noise_);
         gnss_noise_.diagonal() << gp2, gp2, gh2, ga2, ga2, ga2;
     }
 
+    /**
+     * Covariance prediction P = F * P * F^T + Q using only the non-trivial
+     * 3x3 blocks of F (see Predict). The rows and columns of bg, ba and grav
+     * (those in the layout) are identity in F, so only the p, v, theta rows are recomputed, and
+     * only their upper block triangle since P stays symmetric.
+     */
+    void PredictCovBlockwise(S dt, const Mat3T& A, const Mat3T& B, const Mat3T& E);
+
+    /**
+     * Multi-rate mode: left-multiply the accumulated transition Phi by the
+     * F of one sample instead of propagating P. Same block structure as in
+     * PredictCovBlockwise, the bg, ba and grav rows of Phi stay identity.
+     * The theta rows are only non-zero in the theta and bg columns.
+     */
+    void AccumulateTransition(S dt, const Mat3T& A, const Mat3T& B, const Mat3T& E);
+
+    void ResetPreintegration() {
+        phi_.setZero();
+        phi_.template block<9, 9>(0, 0).setIdentity();
+        num_preint_ = 0;
+    }
+
+    /**
+     * Kalman update for an observation whose Jacobian H only selects 3x3
+     * identity blocks of the state, e.g. H = [I 0 0 ...] for position. The
+     * products with H are replaced by extracting those rows and columns of
+     * P, the gain comes from an LDLT solve of the innovation covariance, and
+     * P is updated in the Joseph form, which keeps it symmetric and positive
+     * semi-definite. Sets dx_ and cov_, UpdateAndReset is left to the caller.
+     * The gate only needs the N x N innovation covariance, so a rejected observation costs one small LDLT.
+     * @tparam N observation dimension, 3 per selected block
+     * @param blocks offsets of the selected state blocks, in observation order
+     * @param innov innovation (observation minus prediction)
+     * @param V observation noise
+     * @param gate_chi2 if > 0, reject the observation if innov^T (H P H^T + V)^-1 innov is above it
+     * @return false if rejected, dx_ and cov_ are then unchanged
+     */
+    template <int N>
+    bool UpdateSelected(const std::array<int, N / 3>& blocks, const Eigen::Matrix<S, N, 1>& innov,
+                        const Eigen::Matrix<S, N, N>& V, S gate_chi2 = S(0));
+
     /// Update nominal state variables and reset the error state.
     void UpdateAndReset() {
-        p_ += dx_.template block<3, 1>(0, 0);
-        v_ += dx_.template block<3, 1>(3, 0);
-        R_ = R_ * SO3::exp(dx_.template block<3, 1>(6, 0));
-        if (options_.update_bias_gyro_) {
-            bg_ += dx_.template block<3, 1>(9, 0);
+        p_ += dx_.template block<3, 1>(L::kP, 0);
+        v_ += dx_.template block<3, 1>(L::kV, 0);
+        R_ = R_ * SO3::exp(dx_.template block<3, 1>(L::kTheta, 0));
+        if constexpr (L::kBg >= 0) {
+            if (options_.update_bias_gyro_) {
+                bg_ += dx_.template block<3, 1>(L::kBg, 0);
+            }
+        }
+        if constexpr (L::kBa >= 0) {
+            if (options_.update_bias_acce_) {
+                ba_ += dx_.template block<3, 1>(L::kBa, 0);
+            }
         }
-        if (options_.update_bias_acce_) {
-            ba_ += dx_.template block<3, 1>(12, 0);
+        if constexpr (L::kGrav >= 0) {
+            g_ += dx_.template block<3, 1>(L::kGrav, 0);
         }
-        g_ += dx_.template block<3, 1>(15, 0);
 
         ProjectCov();
 
@@ -153,11 +287,16 @@ class ESKF {
     }
 
     /// Projection of P matrix, referring to equation (3.63)
+    /// J is the identity except for its theta block G, so P = J * P * J^T
+    /// only rescales the theta rows and columns.
     void ProjectCov() {
-        Mat18T J = Mat18T::Identity();
-        J.template block<3, 3>(6, 6) =
-            Mat3T::Identity() - 0.5 * SO3::hat(dx_.template block<3, 1>(6, 0));
-        cov_ = J * cov_ * J.transpose();
+        constexpr int th = L::kTheta;
+        const Mat3T G = Mat3T::Identity() - S(0.5) * SO3::hat(dx_.template block<3, 1>(th, 0));
+        // operator* evaluates into a temporary, the blocks are read and written in place
+        cov_.template block<3, kDim>(th, 0) = G * cov_.template block<3, kDim>(th, 0);
+        cov_.template block<kDim, 3>(0, th) = cov_.template block<kDim, 3>(0, th) * G.transpose();
+        const Mat3T d = cov_.template block<3, 3>(th, th);
+        cov_.template block<3, 3>(th, th) = S(0.5) * (d + d.transpose());
     }
 
    private:
@@ -169,13 +308,18 @@ class ESKF {
     SO3 R_;
     VecT bg_ = VecT::Zero();
     VecT ba_ = VecT::Zero();
-    VecT g_{0, 0, -9.8};
+    VecT g_{S(0), S(0), S(-9.8)};
 
     /// Error state
-    Vec18T dx_ = Vec18T::Zero();
+    StateVecT dx_ = StateVecT::Zero();
 
     /// Covariance matrix
-    Mat18T cov_ = Mat18T::Identity();
+    CovT cov_ = CovT::Identity();
+
+    /// Pre-integrated transition (p, v, theta rows) and the number of
+    /// samples it covers, used when cov_predict_interval_ > 1
+    Eigen::Matrix<S, 9, kDim> phi_ = Eigen::Matrix<S, 9, kDim>::Identity();
+    int num_preint_ = 0;
 
     /// Noise matrix
     MotionNoiseT Q_ = MotionNoiseT::Zero();
@@ -189,61 +333,72 @@ class ESKF {
 
 using ESKFD = ESKF<double>;
 using ESKFF = ESKF<float>;
+using ESKF15D = ESKF<double, ESKFLayout15>;
+using ESKF9D = ESKF<double, ESKFLayout9>;
 
-template <typename S>
-bool ESKF<S>::Predict(const IMU& imu) {
+template <typename S, typename L>
+bool ESKF<S, L>::Predict(const IMU& imu) {
     assert(imu.timestamp_ >= current_time_);
 
-    double dt = imu.timestamp_ - current_time_;
+    // The interval is taken in double, absolute timestamps do not fit into a float
+    const double dt_d = imu.timestamp_ - current_time_;
 
     // The time interval is incorrect, possibly the first IMU data with no
     // historical information.
-    if (dt > (5 * options_.imu_dt_) || dt < 0) {
-        LOG(INFO) << "skip this imu because dt_ = " << dt;
+    if (dt_d > (5 * options_.imu_dt_) || dt_d < 0) {
+        LOG(INFO) << "skip this imu because dt_ = " << dt_d;
         current_time_ = imu.timestamp_;
         return false;
     }
 
+    const S dt = S(dt_d);
+
     // Propagation of the nominal state
+    const VecT acce = imu.acce_.template cast<S>() - ba_;
+    const SO3 dR = SO3::exp((imu.gyro_.template cast<S>() - bg_) * dt);
     {
-        p_ = p_ + (v_ * dt) + (0.5 * (R_ * (imu.acce_ - ba_) + g_) * dt * dt);
-        v_ = v_ + (R_ * (imu.acce_ - ba_) * dt) + (g_ * dt);
-        R_ = R_ * SO3::exp((imu.gyro_ - bg_) * dt);
+        const VecT acce_world = R_ * acce;
+        p_ = p_ + (v_ * dt) + (S(0.5) * (acce_world + g_) * dt * dt);
+        v_ = v_ + (acce_world * dt) + (g_ * dt);
+        R_ = R_ * dR;
         // , and the remaining state dimensions remain unchanged
     }
 
     // Propagation of the error state
-    // - Compute the motion process Jacobian matrix F, as described in
-    // (3.47)
-    // - F is actually a sparse matrix, and it can be multiplied in a
-    // non-matrix
-    //   form. However, for the sake of teaching convenience, we use the
-    //   matrix form here.
-    Mat18T F = Mat18T::Identity();
-    {
-        // Position (p) with respect to velocity (v)
-        F.template block<3, 3>(0, 3) = Mat3T::Identity() * dt;
-
-        // Velocity (v) with respect to rotation (theta)
-        F.template block<3, 3>(3, 6) =
-            -R_.matrix() * SO3::hat(imu.acce_ - ba_) * dt;
-
-        // Velocity (v) with respect to accelerometer bias (ba)
-        F.template block<3, 3>(3, 12) = -R_.matrix() * dt;
-
-        // Velocity (v) with respect to gravity (g)
-        F.template block<3, 3>(3, 15) = Mat3T::Identity() * dt;
-
-        // Rotation (theta) with respect to rotation (theta)
-        F.template block<3, 3>(6, 6) =
-            SO3::exp(-(imu.gyro_ - bg_) * dt).matrix();
-
-        // Rotation (theta) with respect to gyroscope bias (bg)
-        F.template block<3, 3>(6, 9) = -Mat3T::Identity() * dt;
-    }
+    // - The motion process Jacobian matrix F, as described in (3.47), is
+    //   the identity except for the following 3x3 blocks:
+    //     F(p, v) = I * dt,     F(v, theta) = A,  F(v, ba) = B,
+    //     F(v, g) = I * dt,     F(theta, theta) = E,   F(theta, bg) = -I * dt
+    //   (the ba, g and bg blocks only if the layout estimates them)
+    const Mat3T B = -R_.matrix() * dt;  // Velocity (v) with respect to accelerometer bias (ba)
+    const Mat3T A = B * SO3::hat(acce);   // Velocity (v) with respect to rotation (theta)
+    const Mat3T E = dR.matrix().transpose();  // Rotation (theta) with respect to rotation (theta), Exp(-w dt)
+
+    if (options_.cov_predict_interval_ > 1) {
+        AccumulateTransition(dt, A, B, E);
+        if (num_preint_ >= options_.cov_predict_interval_) {
+            FlushCov();
+        }
+    } else if (options_.block_predict_) {
+        // dx_ is zero after every reset, so F * dx_ is skipped here
+        PredictCovBlockwise(dt, A, B, E);
+    } else {
+        // - F is actually a sparse matrix, the dense form is kept for
+        //   teaching convenience and as a reference for the block-wise path.
+        CovT F = CovT::Identity();
+        F.template block<3, 3>(L::kP, L::kV) = Mat3T::Identity() * dt;
+        F.template block<3, 3>(L::kV, L::kTheta) = A;
+        F.template block<3, 3>(L::kTheta, L::kTheta) = E;
+        if constexpr (L::kBa >= 0) {
+            F.template block<3, 3>(L::kV, L::kBa) = B;
+        }
+        if constexpr (L::kGrav >= 0) {
+            F.template block<3, 3>(L::kV, L::kGrav) = Mat3T::Identity() * dt;
+        }
+        if constexpr (L::kBg >= 0) {
+            F.template block<3, 3>(L::kTheta, L::kBg) = -Mat3T::Identity() * dt;
+        }
 
-    // mean and cov prediction
-    {
         // This line is not necessary to calculate as dx_ should be zero
         // after resetting. Therefore, this step can be skipped. However, F
         // needs to participate in the covariance calculation, so it is
@@ -258,19 +413,184 @@ bool ESKF<S>::Predict(const IMU& imu) {
     return true;
 }
 
-template <typename S>
-bool ESKF<S>::ObserveWheelSpeed(const Odom& odom) {
+template <typename S, typename L>
+void ESKF<S, L>::PredictCovBlockwise(S dt, const Mat3T& A, const Mat3T& B, const Mat3T& E) {
+    // Block offsets of the state variables, negative if not in the layout
+    constexpr int p = L::kP, v = L::kV, th = L::kTheta, bg = L::kBg, ba = L::kBa, g = L::kGrav;
+    auto row = [this](int i) { return cov_.template block<3, kDim>(i, 0); };
+
+    // M = F * P, only the p, v, theta rows differ from P
+    Eigen::Matrix<S, 9, kDim> M;
+    M.template block<3, kDim>(p, 0) = row(p) + dt * row(v);
+    // (lazyProduct: 3x3 times 3xN is too small for the blocked GEMM kernel)
+    M.template block<3, kDim>(v, 0) = row(v) + A.lazyProduct(row(th));
+    if constexpr (ba >= 0) {
+        M.template block<3, kDim>(v, 0) += B.lazyProduct(row(ba));
+    }
+    if constexpr (g >= 0) {
+        M.template block<3, kDim>(v, 0) += dt * row(g);
+    }
+    M.template block<3, kDim>(th, 0) = E.lazyProduct(row(th));
+    if constexpr (bg >= 0) {
+        M.template block<3, kDim>(th, 0) -= dt * row(bg);
+    }
+
+    // P = M * F^T, the columns of bg, ba and grav are those of M
+    auto mcol = [&M](int r, int c) { return M.template block<3, 3>(r, c); };
+    for (int r : {p, v, th}) {
+        // upper block triangle: (p, p), (p, v), (p, theta), (v, v), (v, theta), (theta, theta)
+        if (r == p) {
+            cov_.template block<3, 3>(r, p) = mcol(r, p) + dt * mcol(r, v);
+        }
+        if (r <= v) {
+            Mat3T pv = mcol(r, v) + mcol(r, th) * A.transpose();
+            if constexpr (ba >= 0) {
+                pv += mcol(r, ba) * B.transpose();
+            }
+            if constexpr (g >= 0) {
+                pv += dt * mcol(r, g);
+            }
+            cov_.template block<3, 3>(r, v) = pv;
+        }
+        Mat3T pth = mcol(r, th) * E.transpose();
+        if constexpr (bg >= 0) {
+            pth -= dt * mcol(r, bg);
+        }
+        cov_.template block<3, 3>(r, th) = pth;
+    }
+
+    // mirror the lower triangle, the diagonal blocks are symmetrized in place
+    for (int r : {p, v, th}) {
+        Mat3T d = cov_.template block<3, 3>(r, r);
+        cov_.template block<3, 3>(r, r) = S(0.5) * (d + d.transpose());
+    }
+    cov_.template block<3, 3>(v, p) = cov_.template block<3, 3>(p, v).transpose();
+    cov_.template block<3, 3>(th, p) = cov_.template block<3, 3>(p, th).transpose();
+    cov_.template block<3, 3>(th, v) = cov_.template block<3, 3>(v, th).transpose();
+    if constexpr (kDim > 9) {
+        cov_.template block<9, kDim - 9>(0, 9) = M.template block<9, kDim - 9>(0, 9);
+        cov_.template block<kDim - 9, 9>(9, 0) = cov_.template block<9, kDim - 9>(0, 9).transpose();
+    }
+
+    // Q is diagonal
+    cov_.diagonal() += Q_.diagonal();
+}
+
+template <typename S, typename L>
+void ESKF<S, L>::AccumulateTransition(S dt, const Mat3T& A, const Mat3T& B, const Mat3T& E) {
+    constexpr int p = L::kP, v = L::kV, th = L::kTheta, bg = L::kBg, ba = L::kBa, g = L::kGrav;
+    constexpr int tw = bg >= 0 ? 6 : 3;  // theta and bg columns, bg follows theta
+
+    // Phi = F * Phi, the theta rows of Phi are only non-zero in (theta, bg),
+    // the v rows pick up the identity ba and grav rows through B and dt
+    phi_.template block<3, kDim>(p, 0) += dt * phi_.template block<3, kDim>(v, 0);
+    phi_.template block<3, tw>(v, th) += A * phi_.template block<3, tw>(th, th);
+    if constexpr (ba >= 0) {
+        phi_.template block<3, 3>(v, ba) += B;
+    }
+    if constexpr (g >= 0) {
+        phi_.template block<3, 3>(v, g).diagonal().array() += dt;
+    }
+    phi_.template block<3, tw>(th, th) = E * phi_.template block<3, tw>(th, th).eval();
+    if constexpr (bg >= 0) {
+        phi_.template block<3, 3>(th, bg).diagonal().array() -= dt;
+    }
+
+    ++num_preint_;
+}
+
+template <typename S, typename L>
+void ESKF<S, L>::FlushCov() {
+    if (num_preint_ == 0) {
+        return;
+    }
+
+    // The discrete noise of the interval, sum_k Phi(k, N) * Q * Phi(k, N)^T,
+    // is approximated with the trapezoidal rule between Phi(0, N) = Phi and
+    // Phi(N, N) = I, which folds into P = Phi * (P + Qn/2) * Phi^T + Qn/2.
+    // Q is already discrete per sample, so Qn = N * Q.
+    const StateVecT half_qn = S(0.5 * num_preint_) * Q_.diagonal();
+    cov_.diagonal() += half_qn;
+
+    // Phi is identity below the theta rows, so only the p, v, theta rows
+    // and columns of P change. The v rows of Phi are zero in the p columns
+    // and the theta rows are only non-zero in the theta and bg columns.
+    constexpr int p = L::kP, v = L::kV, th = L::kTheta;
+    constexpr int tw = L::kBg >= 0 ? 6 : 3;  // non-zero columns of the theta rows
+    // lazyProduct keeps these small products coefficient-based instead of
+    // going through the blocked GEMM kernel
+    Eigen::Matrix<S, 9, kDim> M;  // M = Phi * P
+    M.template block<3, kDim>(p, 0) = phi_.template block<3, kDim>(p, 0).lazyProduct(cov_);
+    M.template block<3, kDim>(v, 0) =
+        phi_.template block<3, kDim - 3>(v, v).lazyProduct(cov_.template block<kDim - 3, kDim>(v, 0));
+    M.template block<3, kDim>(th, 0) =
+        phi_.template block<3, tw>(th, th).lazyProduct(cov_.template block<tw, kDim>(th, 0));
+
+    // P = M * Phi^T, upper block triangle only
+    Eigen::Matrix<S, 9, 9> top;
+    top.template block<3, 9>(p, 0) = M.template block<3, kDim>(p, 0).lazyProduct(phi_.transpose());
+    top.template block<3, 6>(v, v) =
+        M.template block<3, kDim - 3>(v, v).lazyProduct(phi_.template block<6, kDim - 3>(v, v).transpose());
+    top.template block<3, 3>(th, th) =
+        M.template block<3, tw>(th, th).lazyProduct(phi_.template block<3, tw>(th, th).transpose());
+    cov_.template block<9, 9>(0, 0) = top.template triangularView<Eigen::Upper>();
+    cov_.template block<9, 9>(0, 0).template triangularView<Eigen::StrictlyLower>() = top.transpose();
+    if constexpr (kDim > 9) {
+        cov_.template block<9, kDim - 9>(0, 9) = M.template block<9, kDim - 9>(0, 9);
+        cov_.template block<kDim - 9, 9>(9, 0) = M.template block<9, kDim - 9>(0, 9).transpose();
+    }
+
+    cov_.diagonal() += half_qn;
+
+    ResetPreintegration();
+}
+
+template <typename S, typename L>
+template <int N>
+bool ESKF<S, L>::UpdateSelected(const std::array<int, N / 3>& blocks, const Eigen::Matrix<S, N, 1>& innov,
+                             const Eigen::Matrix<S, N, N>& V, S gate_chi2) {
+    static_assert(N % 3 == 0, "observations select whole 3x3 blocks");
+    constexpr int nb = N / 3;
+
+    // H * P * H^T + V are the selected blocks of P
+    Eigen::Matrix<S, N, N> innov_cov = V;
+    for (int i = 0; i < nb; ++i) {
+        for (int j = 0; j < nb; ++j) {
+            innov_cov.template block<3, 3>(3 * i, 3 * j) += cov_.template block<3, 3>(blocks[i], blocks[j]);
+        }
+    }
+    const Eigen::LDLT<Eigen::Matrix<S, N, N>> ldlt(innov_cov);
+    if (gate_chi2 > S(0) && innov.dot(ldlt.solve(innov)) > gate_chi2) {
+        return false;
+    }
+
+    // P * H^T are the selected columns of P
+    Eigen::Matrix<S, kDim, N> PHt;
+    for (int j = 0; j < nb; ++j) {
+        PHt.template middleCols<3>(3 * j) = cov_.template middleCols<3>(blocks[j]);
+    }
+
+    // K = P * H^T * (H * P * H^T + V)^-1, solved as (H P H^T + V) K^T = H P
+    const Eigen::Matrix<S, kDim, N> K = ldlt.solve(PHt.transpose()).transpose();
+
+    dx_ = K * innov;
+
+    // Joseph form (I - K H) P (I - K H)^T + K V K^T, expanded with the
+    // selector structure of H: P - K (H P) - (P H^T) K^T + K (H P H^T + V) K^T
+    const CovT KHP = K.lazyProduct(PHt.transpose());
+    const CovT KSK = K.lazyProduct((K * innov_cov).transpose());
+    cov_ += KSK - KHP - KHP.transpose();
+    cov_ = S(0.5) * (cov_ + cov_.transpose()).eval();
+    return true;
+}
+
+template <typename S, typename L>
+bool ESKF<S, L>::ObserveWheelSpeed(const Odom& odom) {
     assert(odom.timestamp_ >= current_time_);
+    FlushCov();
     /// Odom correction and Jacobian
     /// Using a three-dimensional wheel speed observation,
-    ///  H is a 3x18 matrix with mostly zeros.
-    Eigen::Matrix<S, 3, 18> H = Eigen::Matrix<S, 3, 18>::Zero();
-    H.template block<3, 3>(0, 3) = Mat3T::Identity();
-
-    // 卡尔曼增益
-    Eigen::Matrix<S, 18, 3> K =
-        cov_ * H.transpose() *
-        (H * cov_ * H.transpose() + odom_noise_).inverse();
+    ///  H is a 3 x kDim matrix with mostly zeros: the identity at v.
 
     // velocity obs
     double velo_l = options_.wheel_radius_ * odom.left_pulse_ /
@@ -279,69 +599,84 @@ bool ESKF<S>::ObserveWheelSpeed(const Odom& odom) {
                     options_.circle_pulse_ * 2 * M_PI / options_.odom_span_;
     double average_vel = 0.5 * (velo_l + velo_r);
 
-    VecT vel_odom(average_vel, 0.0, 0.0);
+    VecT vel_odom(S(average_vel), S(0), S(0));
     VecT vel_world = R_ * vel_odom;
 
-    dx_ = K * (vel_world - v_);
-
-    // update cov
-    cov_ = (Mat18T::Identity() - K * H) * cov_;
+    // Kalman gain, dx and cov
+    UpdateSelected<3>({L::kV}, vel_world - v_, odom_noise_);
 
     UpdateAndReset();
 
     return true;
 }
 
-template <typename S>
-bool ESKF<S>::ObserveGps(const GNSS& gnss) {
+template <typename S, typename L>
+bool ESKF<S, L>::ObserveGps(const GNSS& gnss) {
     /// Correction of GNSS observations
     assert(gnss.unix_time_ >= current_time_);
 
     if (first_gnss_) {
-        R_ = gnss.utm_pose_.so3();
-        p_ = gnss.utm_pose_.translation();
+        R_ = gnss.utm_pose_.so3().template cast<S>();
+        p_ = gnss.utm_pose_.translation().template cast<S>();
         first_gnss_ = false;
         current_time_ = gnss.unix_time_;
         return true;
     }
 
-    assert(gnss.heading_valid_);
-    ObserveSE3(gnss.utm_pose_, options_.gnss_pos_noise_,
-               options_.gnss_ang_noise_);
+    const double scale = options_.GnssNoiseScale(gnss.status_);
+    const bool updated =
+        gnss.heading_valid_
+            ? ObserveSE3(gnss.utm_pose_, scale * options_.gnss_pos_noise_, scale * options_.gnss_ang_noise_,
+                         options_.gnss_gate_chi2_)
+            : ObservePosition(gnss.utm_pose_.translation(), scale * options_.gnss_pos_noise_,
+                              options_.GnssGateChi2(3));
     current_time_ = gnss.unix_time_;
 
-    LOG(INFO) << "GNSS-based measurement updated.";
+    LOG(INFO) << (updated ? "GNSS-based measurement updated." : "GNSS-based measurement rejected by the gate.");
 
-    return true;
+    return updated;
 }
 
-template <typename S>
-bool ESKF<S>::ObserveSE3(const SE3& pose, double trans_noise,
-                         double ang_noise) {
+template <typename S, typename L>
+bool ESKF<S, L>::ObserveSE3(const SE3& pose, double trans_noise,
+                         double ang_noise, double gate_chi2) {
+    FlushCov();
+
     /// Both rotation and translation are involved.
     /// In the observation state variables,
-    ///  p and R are of size 6x18, while the rest are zero.
-    Eigen::Matrix<S, 6, 18> H = Eigen::Matrix<S, 6, 18>::Zero();
-    H.template block<3, 3>(0, 0) = Mat3T::Identity();  // P部分
-    H.template block<3, 3>(3, 6) = Mat3T::Identity();  // R部分（3.66)
+    ///  H is 6 x kDim and selects p and R (3.66), the rest are zero.
 
-    // Kalman gain and update process
-    Vec6d noise_vec;
-    noise_vec << trans_noise, trans_noise, trans_noise, ang_noise, ang_noise,
-        ang_noise;
+    // Observation noise
+    const S tn = S(trans_noise), an = S(ang_noise);
+    Vec6T noise_vec;
+    noise_vec << tn, tn, tn, an, an, an;
 
-    Mat6d V = noise_vec.asDiagonal();
-    Eigen::Matrix<S, 18, 6> K =
-        cov_ * H.transpose() * (H * cov_ * H.transpose() + V).inverse();
+    Eigen::Matrix<S, 6, 6> V = noise_vec.asDiagonal();
 
     // Update x and cov
-    Vec6d innov = Vec6d::Zero();
-    innov.template head<3>() = (pose.translation() - p_);  // 平移部分
+    Vec6T innov = Vec6T::Zero();
+    innov.template head<3>() = (pose.translation().template cast<S>() - p_);  // 平移部分
     innov.template tail<3>() =
-        (R_.inverse() * pose.so3()).log();  // 旋转部分(3.67)
+        (R_.inverse() * pose.so3().template cast<S>()).log();  // 旋转部分(3.67)
 
-    dx_ = K * innov;
-    cov_ = (Mat18T::Identity() - K * H) * cov_;
+    if (!UpdateSelected<6>({L::kP, L::kTheta}, innov, V, S(gate_chi2))) {
+        return false;
+    }
+
+    UpdateAndReset();
+
+    return true;
+}
+
+template <typename S, typename L>
+bool ESKF<S, L>::ObservePosition(const Vec3d& pos, double trans_noise, double gate_chi2) {
+    FlushCov();
+
+    // H selects p, noise as the translation part of ObserveSE3
+    const Eigen::Matrix<S, 3, 3> V = Eigen::Matrix<S, 3, 3>::Identity() * S(trans_noise);
+    if (!UpdateSelected<3>({L::kP}, pos.template cast<S>() - p_, V, S(gate_chi2))) {
+        return false;
+    }
 
     UpdateAndReset();
 
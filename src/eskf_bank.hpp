@@ -0,0 +1,406 @@
+#ifndef IMU_GPS_ESKF_BANK_HPP
+#define IMU_GPS_ESKF_BANK_HPP
+
+#include "eskf.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace imu_gps {
+
+/**
+ * K ESKF instances with their own ESKFOptions, run in lockstep over one sensor stream.
+ *
+ * The nominal states and the 18x18 covariances are kept as a structure of arrays in tiles of kWidth instances
+ * ("lanes", one cache line of S): within a tile every state component and every covariance entry is a contiguous
+ * array over its lanes. Predict, the per-IMU-sample hot path, is written lane-innermost on fixed-size arrays, so the
+ * block-wise covariance propagation of ESKF (see ESKF::PredictCovBlockwise) runs as SIMD over the instances and a
+ * tile stays in L1. Observations are rarer and go through a scalar ESKF per lane, the lane is gathered into
+ * it, updated by the ESKF code itself and scattered back, so the update math is exactly that of ESKF.
+ *
+ * All lanes share the timestamps, so imu_dt_ of the first options decides which IMU samples are skipped. Predict
+ * always propagates the covariance every sample, cov_predict_interval_ and block_predict_ are ignored.
+ *
+ * @tparam S scalar type of the state and covariance, as in ESKF
+ */
+template <typename S = double>
+class ESKFBank {
+   public:
+    using Filter = ESKF<S>;
+    using NavStateT = NavState<S>;
+    using Mat18T = typename Filter::CovT;
+
+    explicit ESKFBank(const std::vector<ESKFOptions>& options);
+
+    /// Number of instances
+    size_t Size() const { return n_; }
+
+    /// Set the initial conditions of every lane, with its own noise options, see ESKF::SetInitialConditions
+    void SetInitialConditions(const Vec3d& init_bg, const Vec3d& init_ba, const Vec3d& gravity = Vec3d(0, 0, -9.8));
+
+    /// Predict every lane with one IMU reading
+    bool Predict(const IMU& imu);
+
+    /// GNSS observation on every lane
+    void ObserveGps(const GNSS& gnss);
+
+    /// Whether the last ObserveGps updated the lane, false if its gate rejected the fix
+    bool GnssUpdated(size_t lane) const { return gnss_updated_[lane] != 0; }
+
+    /// Odom observation on one lane
+    void ObserveWheelSpeed(size_t lane, const Odom& odom);
+
+    NavStateT GetNominalState(size_t lane) const;
+    SE3 GetNominalSE3(size_t lane) const;
+    Mat18T GetCov(size_t lane) const;
+
+   private:
+    static constexpr int kDim = 18;
+    static constexpr int kWidth = 64 / sizeof(S);  // Lanes per tile
+    // Nominal state components: p, v, q (w, x, y, z), bg, ba, grav
+    static constexpr int kP = 0, kV = 3, kQ = 6, kBg = 10, kBa = 13, kG = 16, kNumNominal = 19;
+
+    using Lanes = Eigen::Map<Eigen::Array<S, kWidth, 1>>;
+
+    /// Element e of a lane in an array of tiles with num_elems elements each
+    S& At(std::vector<S>& v, int num_elems, size_t lane, int e) {
+        return v[((lane / kWidth) * num_elems + e) * kWidth + lane % kWidth];
+    }
+    S At(const std::vector<S>& v, int num_elems, size_t lane, int e) const {
+        return v[((lane / kWidth) * num_elems + e) * kWidth + lane % kWidth];
+    }
+
+    /// Row-major rotation matrix of a unit quaternion
+    static void QuatToRotation(S w, S x, S y, S z, S* r) {
+        r[0] = S(1) - S(2) * (y * y + z * z);
+        r[1] = S(2) * (x * y - w * z);
+        r[2] = S(2) * (x * z + w * y);
+        r[3] = S(2) * (x * y + w * z);
+        r[4] = S(1) - S(2) * (x * x + z * z);
+        r[5] = S(2) * (y * z - w * x);
+        r[6] = S(2) * (x * z - w * y);
+        r[7] = S(2) * (y * z + w * x);
+        r[8] = S(1) - S(2) * (x * x + y * y);
+    }
+
+    /// State propagation per lane, fills A, B and E of the transition
+    void PredictNominal(S dt, const Vec3d& gyro, const Vec3d& acce);
+    void PredictLane(S dt, S ax, S ay, S az, S dw, S dx, S dy, S dz, S* x, S* a, S* b, S* e);
+
+    /// P = F * P * F^T + Q over all lanes, the block structure of ESKF::PredictCovBlockwise
+    void PredictCov(S dt);
+    void PredictCovTile(S dt, S* cov, const S* q, const S* a, const S* b, const S* e);
+
+    /// Copy a lane into its scalar filter, observe, and copy it back unless the observation was rejected
+    template <typename Observe>
+    bool UpdateLane(size_t lane, Observe&& observe);
+
+    size_t n_ = 0;
+    size_t num_tiles_ = 0;
+    double current_time_ = 0.0;
+    double imu_dt_ = 0.01;
+
+    // Per tile: kNumNominal, kDim * kDim (row-major) and kDim arrays of kWidth lanes
+    std::vector<S> x_;
+    std::vector<S> cov_;
+    std::vector<S> q_;  // Diagonal of the process noise
+
+    // Non-trivial 3x3 blocks of F, filled by PredictNominal, 9 arrays per tile
+    std::vector<S> a_, b_, e_;
+
+    std::vector<Filter> filters_;  // One per lane, holds its options and noise for the updates
+    std::vector<uint8_t> gnss_updated_;
+    std::vector<ESKFOptions> options_;
+};
+
+using ESKFBankD = ESKFBank<double>;
+using ESKFBankF = ESKFBank<float>;
+
+template <typename S>
+ESKFBank<S>::ESKFBank(const std::vector<ESKFOptions>& options)
+    : n_(options.size()), num_tiles_((options.size() + kWidth - 1) / kWidth), options_(options) {
+    if (!options_.empty()) {
+        imu_dt_ = options_[0].imu_dt_;
+    }
+    // the padding lanes of the last tile are propagated with zero noise and never read
+    x_.assign(num_tiles_ * kNumNominal * kWidth, S(0));
+    cov_.assign(num_tiles_ * kDim * kDim * kWidth, S(0));
+    q_.assign(num_tiles_ * kDim * kWidth, S(0));
+    a_.assign(num_tiles_ * 9 * kWidth, S(0));
+    b_.assign(num_tiles_ * 9 * kWidth, S(0));
+    e_.assign(num_tiles_ * 9 * kWidth, S(0));
+    gnss_updated_.assign(n_, 0);
+
+    filters_.reserve(n_);
+    for (size_t k = 0; k < n_; ++k) {
+        filters_.emplace_back(options_[k]);
+
+        // same process noise as ESKF::BuildNoise
+        const ESKFOptions& o = options_[k];
+        for (int i = 0; i < 3; ++i) {
+            At(q_, kDim, k, 3 + i) = S(o.acce_var_);
+            At(q_, kDim, k, 6 + i) = S(o.gyro_var_);
+            At(q_, kDim, k, 9 + i) = S(o.bias_gyro_var_);
+            At(q_, kDim, k, 12 + i) = S(o.bias_acce_var_);
+        }
+    }
+}
+
+template <typename S>
+void ESKFBank<S>::SetInitialConditions(const Vec3d& init_bg, const Vec3d& init_ba, const Vec3d& gravity) {
+    std::fill(x_.begin(), x_.end(), S(0));
+    std::fill(cov_.begin(), cov_.end(), S(0));
+    for (size_t k = 0; k < num_tiles_ * kWidth; ++k) {
+        At(x_, kNumNominal, k, kQ) = S(1);
+        for (int i = 0; i < 3; ++i) {
+            At(x_, kNumNominal, k, kBg + i) = S(init_bg[i]);
+            At(x_, kNumNominal, k, kBa + i) = S(init_ba[i]);
+            At(x_, kNumNominal, k, kG + i) = S(gravity[i]);
+        }
+        for (int i = 0; i < kDim; ++i) {
+            At(cov_, kDim * kDim, k, i * kDim + i) = S(1e-4);
+        }
+    }
+    for (size_t k = 0; k < n_; ++k) {
+        filters_[k].SetInitialConditions(options_[k], init_bg, init_ba, gravity);
+    }
+}
+
+template <typename S>
+bool ESKFBank<S>::Predict(const IMU& imu) {
+    const double dt_d = imu.timestamp_ - current_time_;
+    if (dt_d > (5 * imu_dt_) || dt_d < 0) {
+        current_time_ = imu.timestamp_;
+        return false;
+    }
+
+    const S dt = S(dt_d);
+    PredictNominal(dt, imu.gyro_, imu.acce_);
+    PredictCov(dt);
+
+    current_time_ = imu.timestamp_;
+    return true;
+}
+
+template <typename S>
+void ESKFBank<S>::PredictNominal(S dt, const Vec3d& gyro, const Vec3d& acce) {
+    const S gx = S(gyro[0]), gy = S(gyro[1]), gz = S(gyro[2]);
+    const S ax = S(acce[0]), ay = S(acce[1]), az = S(acce[2]);
+    // dR = Exp((gyro - bg) * dt) of the lanes of a tile, as quaternions
+    alignas(64) S w[3][kWidth];
+    alignas(64) S dq[4][kWidth];
+    for (size_t t = 0; t < num_tiles_; ++t) {
+        S* x = x_.data() + t * kNumNominal * kWidth;
+        S* a = a_.data() + t * 9 * kWidth;
+        S* b = b_.data() + t * 9 * kWidth;
+        S* e = e_.data() + t * 9 * kWidth;
+        Lanes{w[0]} = (gx - Lanes(x + kBg * kWidth)) * dt;
+        Lanes{w[1]} = (gy - Lanes(x + (kBg + 1) * kWidth)) * dt;
+        Lanes{w[2]} = (gz - Lanes(x + (kBg + 2) * kWidth)) * dt;
+        math::SO3ExpBatch<S>(kWidth, w[0], w[1], w[2], dq[0], dq[1], dq[2], dq[3]);
+        for (int l = 0; l < kWidth; ++l) {
+            PredictLane(dt, ax, ay, az, dq[0][l], dq[1][l], dq[2][l], dq[3][l], x + l, a + l, b + l, e + l);
+        }
+    }
+}
+
+template <typename S>
+void ESKFBank<S>::PredictLane(S dt, S ax, S ay, S az, S dw, S dx, S dy, S dz, S* x, S* a, S* b, S* e) {
+    // x, a, b and e point to the lane in its tile, consecutive elements are kWidth apart, dq = dR of the lane
+    auto X = [x](int i) -> S& { return x[i * kWidth]; };
+
+    // R before the update, for the world acceleration
+    const S qw = X(kQ), qx = X(kQ + 1), qy = X(kQ + 2), qz = X(kQ + 3);
+    S r[9];
+    QuatToRotation(qw, qx, qy, qz, r);
+
+    const S fx = ax - X(kBa), fy = ay - X(kBa + 1), fz = az - X(kBa + 2);
+    const S awx = r[0] * fx + r[1] * fy + r[2] * fz + X(kG);
+    const S awy = r[3] * fx + r[4] * fy + r[5] * fz + X(kG + 1);
+    const S awz = r[6] * fx + r[7] * fy + r[8] * fz + X(kG + 2);
+
+    X(kP) += X(kV) * dt + S(0.5) * awx * dt * dt;
+    X(kP + 1) += X(kV + 1) * dt + S(0.5) * awy * dt * dt;
+    X(kP + 2) += X(kV + 2) * dt + S(0.5) * awz * dt * dt;
+    X(kV) += awx * dt;
+    X(kV + 1) += awy * dt;
+    X(kV + 2) += awz * dt;
+
+    // q = q * dq, normalized like the Sophus product
+    S nw = qw * dw - qx * dx - qy * dy - qz * dz;
+    S nx = qw * dx + qx * dw + qy * dz - qz * dy;
+    S ny = qw * dy - qx * dz + qy * dw + qz * dx;
+    S nz = qw * dz + qx * dy - qy * dx + qz * dw;
+    const S inv_norm = S(1) / std::sqrt(nw * nw + nx * nx + ny * ny + nz * nz);
+    nw *= inv_norm;
+    nx *= inv_norm;
+    ny *= inv_norm;
+    nz *= inv_norm;
+    X(kQ) = nw;
+    X(kQ + 1) = nx;
+    X(kQ + 2) = ny;
+    X(kQ + 3) = nz;
+
+    // B = -R * dt with the updated R, A = B * hat(acce), E = dR^T
+    QuatToRotation(nw, nx, ny, nz, r);
+    for (int i = 0; i < 3; ++i) {
+        const S bi0 = -r[3 * i] * dt, bi1 = -r[3 * i + 1] * dt, bi2 = -r[3 * i + 2] * dt;
+        b[(3 * i) * kWidth] = bi0;
+        b[(3 * i + 1) * kWidth] = bi1;
+        b[(3 * i + 2) * kWidth] = bi2;
+        // row i of B * [f]x
+        a[(3 * i) * kWidth] = bi1 * fz - bi2 * fy;
+        a[(3 * i + 1) * kWidth] = bi2 * fx - bi0 * fz;
+        a[(3 * i + 2) * kWidth] = bi0 * fy - bi1 * fx;
+    }
+
+    QuatToRotation(dw, dx, dy, dz, r);
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            e[(3 * i + j) * kWidth] = r[3 * j + i];
+        }
+    }
+}
+
+template <typename S>
+void ESKFBank<S>::PredictCov(S dt) {
+    for (size_t t = 0; t < num_tiles_; ++t) {
+        PredictCovTile(dt, cov_.data() + t * kDim * kDim * kWidth, q_.data() + t * kDim * kWidth,
+                       a_.data() + t * 9 * kWidth, b_.data() + t * 9 * kWidth, e_.data() + t * 9 * kWidth);
+    }
+}
+
+template <typename S>
+void ESKFBank<S>::PredictCovTile(S dt, S* cov, const S* q, const S* a, const S* b, const S* e) {
+    // M = F * P of the p, v, theta rows, 9 x kDim arrays of the tile
+    S m[9 * kDim * kWidth];
+    auto P = [cov](int r, int c) { return Lanes(cov + (r * kDim + c) * kWidth); };
+    auto M = [&m](int r, int c) { return Lanes(m + (r * kDim + c) * kWidth); };
+    using ConstLanes = Eigen::Map<const Eigen::Array<S, kWidth, 1>>;
+    auto A = [a](int r, int c) { return ConstLanes(a + (3 * r + c) * kWidth); };
+    auto B = [b](int r, int c) { return ConstLanes(b + (3 * r + c) * kWidth); };
+    auto E = [e](int r, int c) { return ConstLanes(e + (3 * r + c) * kWidth); };
+
+    // Block offsets of the error state, as in ESKF
+    constexpr int p = 0, v = 3, th = 6, bg = 9, ba = 12, g = 15;
+
+    // M = F * P, only the p, v, theta rows differ from P
+    for (int c = 0; c < kDim; ++c) {
+        for (int i = 0; i < 3; ++i) {
+            M(p + i, c) = P(p + i, c) + dt * P(v + i, c);
+            M(v + i, c) = P(v + i, c) + A(i, 0) * P(th, c) + A(i, 1) * P(th + 1, c) + A(i, 2) * P(th + 2, c) +
+                          B(i, 0) * P(ba, c) + B(i, 1) * P(ba + 1, c) + B(i, 2) * P(ba + 2, c) + dt * P(g + i, c);
+            M(th + i, c) =
+                E(i, 0) * P(th, c) + E(i, 1) * P(th + 1, c) + E(i, 2) * P(th + 2, c) - dt * P(bg + i, c);
+        }
+    }
+
+    // P = M * F^T, upper triangle of the p, v, theta rows, then mirrored
+    for (int r = 0; r < 9; ++r) {
+        for (int j = 0; j < 3; ++j) {
+            if (p + j >= r) {
+                P(r, p + j) = M(r, p + j) + dt * M(r, v + j);
+            }
+            if (v + j >= r) {
+                P(r, v + j) = M(r, v + j) + M(r, th) * A(j, 0) + M(r, th + 1) * A(j, 1) + M(r, th + 2) * A(j, 2) +
+                              M(r, ba) * B(j, 0) + M(r, ba + 1) * B(j, 1) + M(r, ba + 2) * B(j, 2) +
+                              dt * M(r, g + j);
+            }
+            if (th + j >= r) {
+                P(r, th + j) = M(r, th) * E(j, 0) + M(r, th + 1) * E(j, 1) + M(r, th + 2) * E(j, 2) -
+                               dt * M(r, bg + j);
+            }
+        }
+        // the columns of bg, ba and grav are those of M
+        for (int c = 9; c < kDim; ++c) {
+            P(r, c) = M(r, c);
+            P(c, r) = P(r, c);
+        }
+        for (int c = r + 1; c < 9; ++c) {
+            P(c, r) = P(r, c);
+        }
+    }
+
+    // Q is diagonal
+    for (int i = 0; i < kDim; ++i) {
+        P(i, i) += ConstLanes(q + i * kWidth);
+    }
+}
+
+template <typename S>
+template <typename Observe>
+bool ESKFBank<S>::UpdateLane(size_t lane, Observe&& observe) {
+    Filter& filter = filters_[lane];
+    filter.SetX(GetNominalState(lane).template cast<double>(),
+                Vec3d(At(x_, kNumNominal, lane, kG), At(x_, kNumNominal, lane, kG + 1),
+                      At(x_, kNumNominal, lane, kG + 2)));
+    filter.SetCov(GetCov(lane));
+
+    if (!observe(filter)) {
+        return false;
+    }
+
+    const NavStateT x = filter.GetNominalState();
+    const Vec3d grav = filter.GetGravity();
+    const Eigen::Quaternion<S>& quat = x.R_.unit_quaternion();
+    const S nominal[kNumNominal] = {x.p_[0],     x.p_[1],     x.p_[2],     x.v_[0],     x.v_[1],
+                                    x.v_[2],     quat.w(),    quat.x(),    quat.y(),    quat.z(),
+                                    x.bg_[0],    x.bg_[1],    x.bg_[2],    x.ba_[0],    x.ba_[1],
+                                    x.ba_[2],    S(grav[0]),  S(grav[1]),  S(grav[2])};
+    for (int i = 0; i < kNumNominal; ++i) {
+        At(x_, kNumNominal, lane, i) = nominal[i];
+    }
+
+    const Mat18T& cov = filter.GetCov();
+    for (int r = 0; r < kDim; ++r) {
+        for (int c = 0; c < kDim; ++c) {
+            At(cov_, kDim * kDim, lane, r * kDim + c) = cov(r, c);
+        }
+    }
+    return true;
+}
+
+template <typename S>
+void ESKFBank<S>::ObserveGps(const GNSS& gnss) {
+    for (size_t k = 0; k < n_; ++k) {
+        gnss_updated_[k] = UpdateLane(k, [&gnss](Filter& filter) { return filter.ObserveGps(gnss); });
+    }
+    current_time_ = gnss.unix_time_;
+}
+
+template <typename S>
+void ESKFBank<S>::ObserveWheelSpeed(size_t lane, const Odom& odom) {
+    UpdateLane(lane, [&odom](Filter& filter) { return filter.ObserveWheelSpeed(odom); });
+}
+
+template <typename S>
+typename ESKFBank<S>::NavStateT ESKFBank<S>::GetNominalState(size_t lane) const {
+    auto at = [this, lane](int i) { return At(x_, kNumNominal, lane, i); };
+    using VecT = typename NavStateT::Vec3;
+    const Eigen::Quaternion<S> quat(at(kQ), at(kQ + 1), at(kQ + 2), at(kQ + 3));
+    return NavStateT(current_time_, typename NavStateT::SO3(quat), VecT(at(kP), at(kP + 1), at(kP + 2)),
+                     VecT(at(kV), at(kV + 1), at(kV + 2)), VecT(at(kBg), at(kBg + 1), at(kBg + 2)),
+                     VecT(at(kBa), at(kBa + 1), at(kBa + 2)));
+}
+
+template <typename S>
+SE3 ESKFBank<S>::GetNominalSE3(size_t lane) const {
+    const NavStateT x = GetNominalState(lane);
+    return SE3(x.R_.template cast<double>(), x.p_.template cast<double>());
+}
+
+template <typename S>
+typename ESKFBank<S>::Mat18T ESKFBank<S>::GetCov(size_t lane) const {
+    Mat18T cov;
+    for (int r = 0; r < kDim; ++r) {
+        for (int c = 0; c < kDim; ++c) {
+            cov(r, c) = At(cov_, kDim * kDim, lane, r * kDim + c);
+        }
+    }
+    return cov;
+}
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_ESKF_BANK_HPP
@@ -1,9 +1,13 @@
 #ifndef IMU_GPS_ESKF_OPTIONS_HPP
-#define IMU_GPS_ESKFOPTIONS_HPP
+#define IMU_GPS_ESKF_OPTIONS_HPP
 
 #include "common/eigen_types.h"
+#include "common/gnss.h"
 #include "common/math_utils.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace imu_gps {
 
 struct ESKFOptions {
@@ -30,12 +34,57 @@ struct ESKFOptions {
     double gnss_pos_noise_ = 0.1;                   // 0.1,. GNSS position noise
     double gnss_height_noise_ = 0.1;                // 0.1, GNSS height noise
     double gnss_ang_noise_ = 1.0 * math::kDEG2RAD;  // 1.0, GNSS rotation noise
+    // Multipliers of the GNSS noise by fix quality, fixed solutions (and readings without a status) use it as is
+    double gnss_float_noise_scale_ = 5.0;
+    double gnss_pseudo_noise_scale_ = 20.0;
+    double gnss_single_noise_scale_ = 100.0;
+    // Chi-square gate of GNSS fixes: a fix whose innovation r has r^T S^-1 r above it (S the innovation covariance)
+    // is rejected before the gain and covariance update, 0 = accept all. 22.5 is the 99.9% quantile of 6 DoF.
+    // Given for a pose fix, fixes of fewer DoF use GnssGateChi2(dof).
+    double gnss_gate_chi2_ = 0.0;
 
     /// Other configurations
     bool update_bias_gyro_ = true;  // Whether to update gyroscope bias
     bool update_bias_acce_ = true;  // Whether to update accelerometer bias
+    bool block_predict_ = true;  // Propagate the covariance block-wise instead of the dense F * P * F^T
+    // Propagate the covariance once every N IMU samples (and before every
+    // measurement) with a pre-integrated transition matrix, 1 = every sample
+    int cov_predict_interval_ = 1;
+
+    /// Iterated update, only used by IESKF
+    int max_iterations_ = 4;  // Cap on the Gauss-Newton iterations of one observation, 1 = ESKF update
+    double quit_eps_ = 1e-6;  // Stop iterating once the norm of the state increment is below this
+
+    /**
+     * gnss_gate_chi2_ for a fix of dof degrees of freedom, at the rejection probability it has for a 6-DoF pose fix,
+     * e.g. 16.4 at 3 DoF for 22.5. Wilson-Hilferty approximation of the chi-square quantiles, within about 1% of them up to 99.99%.
+     */
+    double GnssGateChi2(int dof) const {
+        if (gnss_gate_chi2_ <= 0 || dof == 6) {
+            return gnss_gate_chi2_;
+        }
+        // normal quantile of the gate at 6 DoF, then the chi-square quantile of dof at it
+        auto var = [](int k) { return 2.0 / (9.0 * k); };
+        const double z = (std::cbrt(gnss_gate_chi2_ / 6.0) - (1 - var(6))) / std::sqrt(var(6));
+        const double c = std::max(1 - var(dof) + z * std::sqrt(var(dof)), 1e-3);  // a tiny gate stays a gate
+        return dof * c * c * c;
+    }
+
+    /// Multiplier of the GNSS noise for a fix of the given quality
+    double GnssNoiseScale(GpsStatusType status) const {
+        switch (status) {
+            case GpsStatusType::GNSS_FLOAT_SOLUTION:
+                return gnss_float_noise_scale_;
+            case GpsStatusType::GNSS_PSEUDO_SOLUTION:
+                return gnss_pseudo_noise_scale_;
+            case GpsStatusType::GNSS_SINGLE_POINT_SOLUTION:
+                return gnss_single_noise_scale_;
+            default:
+                return 1.0;
+        }
+    }
 };
 
 }  // namespace imu_gps
 
-#endif  // IMU_GPS_ESKFOPTIONS_HPP
+#endif  // IMU_GPS_ESKF_OPTIONS_HPP
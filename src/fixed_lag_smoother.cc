@@ -0,0 +1,384 @@
+#include "fixed_lag_smoother.h"
+#include "common/math_utils.h"
+
+#include <glog/logging.h>
+
+namespace imu_gps {
+
+namespace {
+
+// Offsets in the 15-dof error state, the order of ESKF
+constexpr int kP = 0;
+constexpr int kV = 3;
+constexpr int kR = 6;
+constexpr int kBg = 9;
+constexpr int kBa = 12;
+constexpr int kDim = 15;
+
+using Vec15 = Eigen::Matrix<double, 15, 1>;
+
+/// Error of x w.r.t. ref, the rotation with a right perturbation
+Vec15 BoxMinus(const NavStated& x, const NavStated& ref) {
+    Vec15 dx;
+    dx.segment<3>(kP) = x.p_ - ref.p_;
+    dx.segment<3>(kV) = x.v_ - ref.v_;
+    dx.segment<3>(kR) = (ref.R_.inverse() * x.R_).log();
+    dx.segment<3>(kBg) = x.bg_ - ref.bg_;
+    dx.segment<3>(kBa) = x.ba_ - ref.ba_;
+    return dx;
+}
+
+void BoxPlus(NavStated& x, const Vec15& dx) {
+    x.p_ += dx.segment<3>(kP);
+    x.v_ += dx.segment<3>(kV);
+    x.R_ = x.R_ * SO3::exp(dx.segment<3>(kR));
+    x.bg_ += dx.segment<3>(kBg);
+    x.ba_ += dx.segment<3>(kBa);
+}
+
+/// Add a factor on one keyframe, returns its weighted squared error
+template <int N>
+double AddUnary(const Eigen::Matrix<double, N, 1>& r, const Eigen::Matrix<double, N, kDim>& J,
+                const Eigen::Matrix<double, N, N>& W, Mat15d& H, Vec15& g) {
+    const Eigen::Matrix<double, kDim, N> JtW = J.transpose() * W;
+    H.noalias() += JtW * J;
+    g.noalias() += JtW * r;
+    return r.dot(W * r);
+}
+
+/// Add a factor on keyframes i and i + 1, returns its weighted squared error
+template <int N>
+double AddBinary(const Eigen::Matrix<double, N, 1>& r, const Eigen::Matrix<double, N, kDim>& Ji,
+                 const Eigen::Matrix<double, N, kDim>& Jj, const Eigen::Matrix<double, N, N>& W, Mat15d& Hii,
+                 Mat15d& Hjj, Mat15d& Hji, Vec15& gi, Vec15& gj) {
+    const Eigen::Matrix<double, kDim, N> JitW = Ji.transpose() * W;
+    const Eigen::Matrix<double, kDim, N> JjtW = Jj.transpose() * W;
+    Hii.noalias() += JitW * Ji;
+    Hjj.noalias() += JjtW * Jj;
+    Hji.noalias() += JjtW * Ji;
+    gi.noalias() += JitW * r;
+    gj.noalias() += JjtW * r;
+    return r.dot(W * r);
+}
+
+}  // namespace
+
+FixedLagSmoother::FixedLagSmoother(Options options) : options_(options) {
+    options_.window_size_ = std::max<size_t>(options_.window_size_, 2);
+}
+
+IMUPreintegration::Options FixedLagSmoother::PreintegOptions(const NavStated& state) const {
+    IMUPreintegration::Options preinteg_options;
+    preinteg_options.init_bg_ = state.bg_;
+    preinteg_options.init_ba_ = state.ba_;
+    preinteg_options.gyro_var_ = options_.eskf_options_.gyro_var_;
+    preinteg_options.acce_var_ = options_.eskf_options_.acce_var_;
+    return preinteg_options;
+}
+
+void FixedLagSmoother::Init(const NavStated& state, const Vec3d& gravity, const Mat15d& cov) {
+    gravity_ = gravity;
+    frames_.clear();
+
+    Keyframe frame;
+    frame.state_ = state;
+    frame.preinteg_ = IMUPreintegration(PreintegOptions(state));
+    frames_.push_back(frame);
+    ++stats_.num_keyframes_;
+
+    prior_state_ = state;
+    prior_H_ = cov.ldlt().solve(Mat15d::Identity());
+    prior_H_ = 0.5 * (prior_H_ + prior_H_.transpose());
+    prior_b_.setZero();
+
+    last_imu_time_ = state.timestamp_;
+    has_imu_ = false;
+}
+
+void FixedLagSmoother::AddIMU(const IMU& imu) {
+    if (!Initialized()) {
+        return;
+    }
+
+    // same convention as IMUIntegration, a reading covers the interval since the previous one
+    const double dt = imu.timestamp_ - last_imu_time_;
+    if (dt > 0 && dt < 0.1) {
+        frames_.back().preinteg_.Integrate(imu, dt);
+    }
+    last_imu_time_ = std::max(last_imu_time_, imu.timestamp_);
+    last_imu_ = imu;
+    has_imu_ = true;
+}
+
+void FixedLagSmoother::AddOdom(const Odom& odom) {
+    last_odom_ = odom;
+    has_last_odom_ = true;
+}
+
+void FixedLagSmoother::AddGNSS(const GNSS& gnss) {
+    if (!Initialized() || !gnss.heading_valid_) {
+        return;
+    }
+
+    const double t = gnss.unix_time_;
+    if (t <= frames_.back().state_.timestamp_) {
+        return;
+    }
+
+    // close the interval at the keyframe time with the latest reading
+    if (has_imu_ && t > last_imu_time_ && t - last_imu_time_ < 0.1) {
+        frames_.back().preinteg_.Integrate(last_imu_, t - last_imu_time_);
+        last_imu_time_ = t;
+    }
+    if (frames_.back().preinteg_.dt_ <= 0) {
+        // no IMU readings since the last keyframe, nothing to connect the two
+        return;
+    }
+
+    if (frames_.size() >= options_.window_size_) {
+        Marginalize();
+    }
+
+    const Keyframe& last = frames_.back();
+    Keyframe frame;
+    frame.state_ = last.preinteg_.Predict(last.state_, gravity_);
+    frame.state_.timestamp_ = t;
+    frame.preinteg_ = IMUPreintegration(PreintegOptions(frame.state_));
+    frame.gnss_pose_ = gnss.utm_pose_;
+    frame.has_gnss_ = true;
+
+    if (options_.with_odom_ && has_last_odom_ && std::abs(last_odom_.timestamp_ - t) <= options_.odom_time_th_) {
+        const auto& eo = options_.eskf_options_;
+        double velo_l = eo.wheel_radius_ * last_odom_.left_pulse_ / eo.circle_pulse_ * 2 * M_PI / eo.odom_span_;
+        double velo_r = eo.wheel_radius_ * last_odom_.right_pulse_ / eo.circle_pulse_ * 2 * M_PI / eo.odom_span_;
+        frame.odom_vel_ = Vec3d(0.5 * (velo_l + velo_r), 0, 0);
+        frame.has_odom_ = true;
+        ++stats_.num_odom_factors_;
+    }
+
+    frames_.push_back(frame);
+    ++stats_.num_keyframes_;
+
+    Optimize();
+}
+
+double FixedLagSmoother::Linearize(size_t num_frames, size_t num_unary, Blocks& blocks) const {
+    blocks.diag_.assign(num_frames, Mat15d::Zero());
+    blocks.off_.assign(num_frames, Mat15d::Zero());
+    blocks.grad_.assign(num_frames, Vec15::Zero());
+
+    const auto& eo = options_.eskf_options_;
+    double chi2 = 0;
+
+    // prior
+    {
+        const Vec15 dx = BoxMinus(frames_[0].state_, prior_state_);
+        blocks.diag_[0] += prior_H_;
+        blocks.grad_[0] += prior_b_ + prior_H_ * dx;
+        chi2 += dx.dot(prior_H_ * dx) + 2 * prior_b_.dot(dx);
+    }
+
+    // GNSS pose and odom velocity
+    Mat6d gnss_info = Mat6d::Zero();
+    gnss_info.diagonal() << 1.0 / (eo.gnss_pos_noise_ * eo.gnss_pos_noise_),
+        1.0 / (eo.gnss_pos_noise_ * eo.gnss_pos_noise_), 1.0 / (eo.gnss_height_noise_ * eo.gnss_height_noise_),
+        1.0 / (eo.gnss_ang_noise_ * eo.gnss_ang_noise_), 1.0 / (eo.gnss_ang_noise_ * eo.gnss_ang_noise_),
+        1.0 / (eo.gnss_ang_noise_ * eo.gnss_ang_noise_);
+    const Mat3d odom_info = Mat3d::Identity() / (eo.odom_var_ * eo.odom_var_);
+
+    for (size_t i = 0; i < num_unary; ++i) {
+        const Keyframe& frame = frames_[i];
+        const NavStated& x = frame.state_;
+        if (frame.has_gnss_) {
+            Vec6d r;
+            r.head<3>() = x.p_ - frame.gnss_pose_.translation();
+            r.tail<3>() = (frame.gnss_pose_.so3().inverse() * x.R_).log();
+            Eigen::Matrix<double, 6, kDim> J = Eigen::Matrix<double, 6, kDim>::Zero();
+            J.block<3, 3>(0, kP) = Mat3d::Identity();
+            J.block<3, 3>(3, kR) = math::SO3JacobianRightInv(Vec3d(r.tail<3>()));
+            chi2 += AddUnary<6>(r, J, gnss_info, blocks.diag_[i], blocks.grad_[i]);
+        }
+        if (frame.has_odom_) {
+            const Mat3d Rt = x.R_.matrix().transpose();
+            const Vec3d vb = Rt * x.v_;
+            Vec3d r = vb - frame.odom_vel_;
+            Eigen::Matrix<double, 3, kDim> J = Eigen::Matrix<double, 3, kDim>::Zero();
+            J.block<3, 3>(0, kR) = math::SKEW_SYM_MATRIX(vb);
+            J.block<3, 3>(0, kV) = Rt;
+            chi2 += AddUnary<3>(r, J, odom_info, blocks.diag_[i], blocks.grad_[i]);
+        }
+    }
+
+    // IMU pre-integration and bias random walk between neighbors
+    for (size_t i = 0; i + 1 < num_frames; ++i) {
+        const IMUPreintegration& pre = frames_[i].preinteg_;
+        const NavStated& xi = frames_[i].state_;
+        const NavStated& xj = frames_[i + 1].state_;
+        const double dt = pre.dt_;
+
+        const Mat3d Rit = xi.R_.matrix().transpose();
+        const Vec3d dbg = xi.bg_ - pre.bg_;
+        const SO3 dR = pre.GetDeltaRotation(xi.bg_);
+        const Vec3d dv_world = xj.v_ - xi.v_ - gravity_ * dt;
+        const Vec3d dp_world = xj.p_ - xi.p_ - xi.v_ * dt - 0.5 * gravity_ * dt * dt;
+
+        Vec9d r;
+        r.segment<3>(0) = (dR.inverse() * xi.R_.inverse() * xj.R_).log();
+        r.segment<3>(3) = Rit * dv_world - pre.GetDeltaVelocity(xi.bg_, xi.ba_);
+        r.segment<3>(6) = Rit * dp_world - pre.GetDeltaPosition(xi.bg_, xi.ba_);
+
+        const Vec3d er = r.segment<3>(0);
+        const Mat3d jr_inv = math::SO3JacobianRightInv(er);
+
+        Eigen::Matrix<double, 9, kDim> Ji = Eigen::Matrix<double, 9, kDim>::Zero();
+        Eigen::Matrix<double, 9, kDim> Jj = Eigen::Matrix<double, 9, kDim>::Zero();
+        Ji.block<3, 3>(0, kR) = -jr_inv * (xj.R_.inverse() * xi.R_).matrix();
+        Ji.block<3, 3>(0, kBg) = -jr_inv * SO3::exp(er).matrix().transpose() *
+                                 math::SO3JacobianRight(Vec3d(pre.dR_dbg_ * dbg)) * pre.dR_dbg_;
+        Jj.block<3, 3>(0, kR) = jr_inv;
+
+        Ji.block<3, 3>(3, kR) = math::SKEW_SYM_MATRIX(Vec3d(Rit * dv_world));
+        Ji.block<3, 3>(3, kV) = -Rit;
+        Ji.block<3, 3>(3, kBg) = -pre.dV_dbg_;
+        Ji.block<3, 3>(3, kBa) = -pre.dV_dba_;
+        Jj.block<3, 3>(3, kV) = Rit;
+
+        Ji.block<3, 3>(6, kR) = math::SKEW_SYM_MATRIX(Vec3d(Rit * dp_world));
+        Ji.block<3, 3>(6, kP) = -Rit;
+        Ji.block<3, 3>(6, kV) = -Rit * dt;
+        Ji.block<3, 3>(6, kBg) = -pre.dP_dbg_;
+        Ji.block<3, 3>(6, kBa) = -pre.dP_dba_;
+        Jj.block<3, 3>(6, kP) = Rit;
+
+        const Mat9d info = pre.cov_.ldlt().solve(Mat9d::Identity());
+        chi2 += AddBinary<9>(r, Ji, Jj, info, blocks.diag_[i], blocks.diag_[i + 1], blocks.off_[i], blocks.grad_[i],
+                             blocks.grad_[i + 1]);
+
+        // the ESKF bias noise is per IMU reading
+        const double num_readings = std::max(dt / eo.imu_dt_, 1.0);
+        Mat6d bias_info = Mat6d::Zero();
+        bias_info.diagonal().head<3>().setConstant(1.0 / (eo.bias_gyro_var_ * num_readings));
+        bias_info.diagonal().tail<3>().setConstant(1.0 / (eo.bias_acce_var_ * num_readings));
+
+        Vec6d rb;
+        rb.head<3>() = xj.bg_ - xi.bg_;
+        rb.tail<3>() = xj.ba_ - xi.ba_;
+        Eigen::Matrix<double, 6, kDim> Jbi = Eigen::Matrix<double, 6, kDim>::Zero();
+        Eigen::Matrix<double, 6, kDim> Jbj = Eigen::Matrix<double, 6, kDim>::Zero();
+        Jbi.block<6, 6>(0, kBg) = -Mat6d::Identity();
+        Jbj.block<6, 6>(0, kBg) = Mat6d::Identity();
+        chi2 += AddBinary<6>(rb, Jbi, Jbj, bias_info, blocks.diag_[i], blocks.diag_[i + 1], blocks.off_[i],
+                             blocks.grad_[i], blocks.grad_[i + 1]);
+    }
+
+    return chi2;
+}
+
+void FixedLagSmoother::BuildPattern(size_t num_frames) {
+    const int dim = static_cast<int>(num_frames) * kDim;
+    std::vector<Eigen::Triplet<double>> triplets;
+    triplets.reserve(num_frames * kDim * (kDim + 1) / 2 + (num_frames - 1) * kDim * kDim);
+    for (size_t i = 0; i < num_frames; ++i) {
+        const int base = static_cast<int>(i) * kDim;
+        for (int c = 0; c < kDim; ++c) {
+            for (int r = c; r < kDim; ++r) {
+                triplets.emplace_back(base + r, base + c, 0.0);
+            }
+            if (i + 1 < num_frames) {
+                for (int r = 0; r < kDim; ++r) {
+                    triplets.emplace_back(base + kDim + r, base + c, 0.0);
+                }
+            }
+        }
+    }
+
+    H_.resize(dim, dim);
+    H_.setFromTriplets(triplets.begin(), triplets.end());
+    H_.makeCompressed();
+
+    solver_.analyzePattern(H_);
+    pattern_frames_ = num_frames;
+    ++stats_.num_symbolic_;
+}
+
+void FixedLagSmoother::Optimize() {
+    const size_t n = frames_.size();
+    if (n != pattern_frames_) {
+        BuildPattern(n);
+    }
+
+    Blocks blocks;
+    Eigen::VectorXd g(n * kDim);
+    for (int iter = 0; iter < options_.max_iterations_; ++iter) {
+        Linearize(n, n, blocks);
+
+        // column by column, the rows of a column are the lower part of H_ii followed by H_{i+1,i}
+        double* values = H_.valuePtr();
+        for (size_t i = 0; i < n; ++i) {
+            for (int c = 0; c < kDim; ++c) {
+                for (int r = c; r < kDim; ++r) {
+                    *values++ = blocks.diag_[i](r, c);
+                }
+                if (i + 1 < n) {
+                    for (int r = 0; r < kDim; ++r) {
+                        *values++ = blocks.off_[i](r, c);
+                    }
+                }
+            }
+            g.segment<kDim>(i * kDim) = blocks.grad_[i];
+        }
+
+        solver_.factorize(H_);
+        if (solver_.info() != Eigen::Success) {
+            ++stats_.num_failed_;
+            LOG(WARNING) << "smoother: factorization failed at keyframe " << stats_.num_keyframes_;
+            break;
+        }
+        const Eigen::VectorXd dx = solver_.solve(-g);
+        ++stats_.num_iterations_;
+
+        for (size_t i = 0; i < n; ++i) {
+            BoxPlus(frames_[i].state_, dx.segment<kDim>(i * kDim));
+        }
+        if (dx.norm() < 1e-6) {
+            break;
+        }
+    }
+}
+
+void FixedLagSmoother::Marginalize() {
+    Blocks blocks;
+    Linearize(2, 1, blocks);
+
+    // Schur complement of keyframe 0
+    const Mat15d H00_inv = blocks.diag_[0].ldlt().solve(Mat15d::Identity());
+    const Mat15d& H10 = blocks.off_[0];
+    prior_H_ = blocks.diag_[1] - H10 * H00_inv * H10.transpose();
+    prior_H_ = 0.5 * (prior_H_ + prior_H_.transpose());
+    prior_b_ = blocks.grad_[1] - H10 * H00_inv * blocks.grad_[0];
+    prior_state_ = frames_[1].state_;
+
+    Output(frames_.front());
+    frames_.pop_front();
+}
+
+void FixedLagSmoother::Output(const Keyframe& frame) {
+    ++stats_.num_output_;
+    if (frame.has_gnss_) {
+        ++stats_.num_gnss_output_;
+        stats_.gnss_err_sq_sum_ += (frame.state_.p_ - frame.gnss_pose_.translation()).squaredNorm();
+    }
+    if (output_cb_) {
+        output_cb_(frame.state_);
+    }
+}
+
+void FixedLagSmoother::Flush() {
+    for (const auto& frame : frames_) {
+        Output(frame);
+    }
+    frames_.clear();
+    pattern_frames_ = 0;
+}
+
+}  // namespace imu_gps
@@ -0,0 +1,162 @@
+#ifndef IMU_GPS_FIXED_LAG_SMOOTHER_H
+#define IMU_GPS_FIXED_LAG_SMOOTHER_H
+
+#include "common/eigen_types.h"
+#include "common/gnss.h"
+#include "common/imu.h"
+#include "common/nav_state.h"
+#include "common/odom.h"
+#include "eskf_option.hpp"
+#include "imu_preintegration.h"
+
+#include <Eigen/CholmodSupport>
+#include <Eigen/SparseCore>
+#include <cmath>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace imu_gps {
+
+/**
+ * Fixed-lag smoother over a sliding window of keyframes, a batch backend for post-processing GNSS/IMU(/Odom) logs.
+ *
+ * A keyframe is created at every GNSS reading and holds a full 15-dof state (p, v, R, bg, ba, in the error order of
+ * ESKF). The window is optimized by Gauss-Newton over
+ *   - an IMU pre-integration factor and a bias random walk factor between consecutive keyframes,
+ *   - a GNSS pose factor on every keyframe,
+ *   - a body-frame velocity factor from the odometry reading closest to the keyframe, if any,
+ *   - a prior on the oldest keyframe, which holds the information of everything marginalized so far.
+ * When the window is full the oldest keyframe is marginalized with a Schur complement and reported through the output
+ * callback, so every output state has been smoothed with window_size_ - 1 later GNSS readings.
+ *
+ * The Hessian is block tridiagonal and its sparsity pattern only depends on the number of keyframes, so the symbolic
+ * (supernodal) Cholesky factorization is computed once when the window first fills up and reused by every later solve;
+ * each Gauss-Newton iteration only refills the values and runs the numeric factorization.
+ */
+class FixedLagSmoother {
+   public:
+    struct Options {
+        Options() {}
+        ESKFOptions eskf_options_;   // IMU, bias walk, odom and GNSS noise, shared with the filter
+        size_t window_size_ = 10;    // Keyframes optimized together, at least 2
+        int max_iterations_ = 4;     // Gauss-Newton iterations per new keyframe
+        bool with_odom_ = true;      // Add odom velocity factors
+        double odom_time_th_ = 0.1;  // Largest time between a keyframe and the odom reading used for it, seconds
+    };
+
+    /// Counters of a run
+    struct Stats {
+        size_t num_keyframes_ = 0;
+        size_t num_iterations_ = 0;    // Gauss-Newton iterations
+        size_t num_symbolic_ = 0;      // Symbolic factorizations
+        size_t num_failed_ = 0;        // Numeric factorizations that failed, the iteration was skipped
+        size_t num_odom_factors_ = 0;  // Keyframes with an odom velocity factor
+        size_t num_output_ = 0;        // Keyframes reported
+        size_t num_gnss_output_ = 0;   // Reported keyframes with a GNSS factor
+        double gnss_err_sq_sum_ = 0;   // Sum of squared distances between those keyframes and their GNSS positions
+
+        /// RMS distance between the reported keyframes and their GNSS positions
+        double GnssRmse() const { return num_gnss_output_ > 0 ? std::sqrt(gnss_err_sq_sum_ / num_gnss_output_) : 0; }
+    };
+
+    using OutputCallback = std::function<void(const NavStated&)>;
+
+    explicit FixedLagSmoother(Options options = Options());
+
+    /// Set the callback invoked with every keyframe state that leaves the window
+    FixedLagSmoother& SetOutputCallback(OutputCallback cb) {
+        output_cb_ = std::move(cb);
+        return *this;
+    }
+
+    /**
+     * Start at a filter state, e.g. the ESKF state at its first GNSS reading
+     * @param state first keyframe
+     * @param gravity gravity of the filter
+     * @param cov covariance of the state in the error order of ESKF (p, v, R, bg, ba), used as the initial prior
+     */
+    void Init(const NavStated& state, const Vec3d& gravity, const Mat15d& cov);
+
+    bool Initialized() const { return !frames_.empty(); }
+
+    /// Add readings in time order, readings before Init() are ignored
+    void AddIMU(const IMU& imu);
+    void AddOdom(const Odom& odom);
+
+    /// Add a GNSS reading in the map frame (converted to UTM, origin removed), readings without heading are skipped
+    void AddGNSS(const GNSS& gnss);
+
+    /// Report the keyframes left in the window, call at the end of a log
+    void Flush();
+
+    /// Newest keyframe state
+    NavStated GetLatestState() const { return frames_.empty() ? NavStated() : frames_.back().state_; }
+
+    const Stats& GetStats() const { return stats_; }
+
+   private:
+    using Vec15 = Eigen::Matrix<double, 15, 1>;
+
+    struct Keyframe {
+        NavStated state_;
+        IMUPreintegration preinteg_;  // From this keyframe to the next
+        SE3 gnss_pose_;
+        bool has_gnss_ = false;
+        Vec3d odom_vel_ = Vec3d::Zero();  // Body-frame velocity measured by the odometry
+        bool has_odom_ = false;
+    };
+
+    /// Linearized contribution of the factors on the window
+    struct Blocks {
+        std::vector<Mat15d> diag_;  // H_ii
+        std::vector<Mat15d> off_;   // H_{i+1,i}
+        std::vector<Vec15> grad_;   // J^T W r of keyframe i
+    };
+
+    IMUPreintegration::Options PreintegOptions(const NavStated& state) const;
+
+    /**
+     * Linearize the factors on the first num_frames keyframes at their current states
+     * @param num_unary GNSS and odom factors are only added on the first num_unary keyframes
+     * @return the weighted squared error
+     */
+    double Linearize(size_t num_frames, size_t num_unary, Blocks& blocks) const;
+
+    void Optimize();
+
+    /// Marginalize the oldest keyframe into the prior of the next one and report it
+    void Marginalize();
+
+    void Output(const Keyframe& frame);
+
+    /// Rebuild the lower triangular sparsity pattern of num_frames keyframes and analyze it
+    void BuildPattern(size_t num_frames);
+
+    Options options_;
+    OutputCallback output_cb_;
+    Vec3d gravity_ = Vec3d(0, 0, -9.8);
+
+    std::deque<Keyframe> frames_;
+    double last_imu_time_ = 0;
+    IMU last_imu_;  // Held until the next keyframe time when a GNSS reading falls between two IMU readings
+    bool has_imu_ = false;
+    Odom last_odom_;
+    bool has_last_odom_ = false;
+
+    // Prior on the oldest keyframe: 0.5 * dx^T H dx + b^T dx around prior_state_
+    Mat15d prior_H_ = Mat15d::Zero();
+    Vec15 prior_b_ = Vec15::Zero();
+    NavStated prior_state_;
+
+    // Sparse system of the window, the pattern is rebuilt only when the number of keyframes changes
+    Eigen::SparseMatrix<double> H_;
+    size_t pattern_frames_ = 0;
+    Eigen::CholmodSupernodalLLT<Eigen::SparseMatrix<double>, Eigen::Lower> solver_;
+
+    Stats stats_;
+};
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_FIXED_LAG_SMOOTHER_H
@@ -0,0 +1,166 @@
+#ifndef IMU_GPS_GINS_BANK_REPLAY_H
+#define IMU_GPS_GINS_BANK_REPLAY_H
+
+#include "eskf_bank.hpp"
+#include "gins_replay.h"
+
+#include <functional>
+#include <vector>
+
+namespace imu_gps {
+
+/**
+ * The GinsReplay flow for K option variants at once, on an ESKFBank.
+ *
+ * The readings are parsed, the IMU is initialized and GNSS is converted to UTM once for all variants, so the variants
+ * may only differ in their ESKFOptions and with_odom_. The remaining options (antenna, initializer) are taken from
+ * the first variant. Every lane reports the same states as a GinsReplay with its options would.
+ *
+ * @tparam S scalar type of the bank
+ */
+template <typename S = double>
+class GinsBankReplay {
+   public:
+    using StateCallback = std::function<void(size_t lane, const NavStated&)>;
+
+    explicit GinsBankReplay(const std::vector<GinsReplayOptions>& options)
+        : options_(options),
+          imu_init_(options.at(0).init_options_),
+          bank_(EskfOptions(options)),
+          stats_(options.size()) {}
+
+    /// Set the callback invoked with the new state of every lane
+    GinsBankReplay& SetStateCallback(StateCallback cb) {
+        state_cb_ = std::move(cb);
+        return *this;
+    }
+
+    void AddIMU(const IMU& imu) {
+        for (auto& s : stats_) {
+            ++s.num_imu_;
+        }
+        if (!imu_init_.InitSuccess()) {
+            imu_init_.AddIMU(imu);
+            return;
+        }
+
+        if (!imu_inited_) {
+            bank_.SetInitialConditions(imu_init_.GetInitBg(), imu_init_.GetInitBa(), imu_init_.GetGravity());
+            imu_inited_ = true;
+            return;
+        }
+
+        if (!gnss_inited_) {
+            return;
+        }
+
+        bank_.Predict(imu);
+        for (auto& s : stats_) {
+            ++s.num_predict_;
+        }
+        PublishState();
+    }
+
+    void AddGNSS(const GNSS& gnss) {
+        GNSS gnss_convert = gnss;
+        gnss_convert.utm_valid_ = imu_inited_ && ConvertGps2UTM(gnss_convert, options_[0].antenna_pos_,
+                                                                options_[0].antenna_angle_);
+        AddConvertedGNSS(gnss_convert);
+    }
+
+    /// Same as GinsReplay::AddConvertedGNSS
+    void AddConvertedGNSS(const GNSS& gnss) {
+        for (auto& s : stats_) {
+            ++s.num_gnss_;
+        }
+        if (!imu_inited_ || !gnss.utm_valid_ || !gnss.heading_valid_) {
+            return;
+        }
+
+        GNSS gnss_convert = gnss;
+        if (!first_gnss_set_) {
+            origin_ = gnss_convert.utm_pose_.translation();
+            first_gnss_set_ = true;
+        }
+        gnss_convert.utm_pose_.translation() -= origin_;
+
+        std::vector<double> err_sq(bank_.Size());
+        for (size_t k = 0; k < bank_.Size(); ++k) {
+            err_sq[k] = (bank_.GetNominalSE3(k).translation() - gnss_convert.utm_pose_.translation()).squaredNorm();
+        }
+
+        bank_.ObserveGps(gnss_convert);
+        for (size_t k = 0; k < bank_.Size(); ++k) {
+            if (!bank_.GnssUpdated(k)) {
+                ++stats_[k].num_gnss_rejected_;
+                continue;
+            }
+            if (gnss_inited_) {
+                stats_[k].gnss_err_sq_sum_ += err_sq[k];
+            }
+            ++stats_[k].num_gnss_update_;
+        }
+
+        PublishState();
+        gnss_inited_ = true;
+    }
+
+    void AddOdom(const Odom& odom) {
+        imu_init_.AddOdom(odom);
+        if (!imu_inited_ || !gnss_inited_) {
+            return;
+        }
+        for (size_t k = 0; k < bank_.Size(); ++k) {
+            if (options_[k].with_odom_) {
+                bank_.ObserveWheelSpeed(k, odom);
+                ++stats_[k].num_odom_update_;
+            }
+        }
+    }
+
+    bool Running() const { return imu_inited_ && gnss_inited_; }
+
+    size_t Size() const { return bank_.Size(); }
+    const GinsReplayStats& GetStats(size_t lane) const { return stats_[lane]; }
+    const ESKFBank<S>& GetBank() const { return bank_; }
+    Vec3d GetOrigin() const { return origin_; }
+
+   private:
+    static std::vector<ESKFOptions> EskfOptions(const std::vector<GinsReplayOptions>& options) {
+        std::vector<ESKFOptions> eskf_options;
+        eskf_options.reserve(options.size());
+        for (const auto& o : options) {
+            eskf_options.emplace_back(o.eskf_options_);
+        }
+        return eskf_options;
+    }
+
+    void PublishState() {
+        if (!state_cb_) {
+            return;
+        }
+        for (size_t k = 0; k < bank_.Size(); ++k) {
+            if constexpr (std::is_same_v<S, double>) {
+                state_cb_(k, bank_.GetNominalState(k));
+            } else {
+                state_cb_(k, bank_.GetNominalState(k).template cast<double>());
+            }
+        }
+    }
+
+    std::vector<GinsReplayOptions> options_;
+    StaticIMUInit imu_init_;
+    ESKFBank<S> bank_;
+    StateCallback state_cb_;
+
+    bool imu_inited_ = false;
+    bool gnss_inited_ = false;
+    bool first_gnss_set_ = false;
+    Vec3d origin_ = Vec3d::Zero();
+
+    std::vector<GinsReplayStats> stats_;
+};
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_GINS_BANK_REPLAY_H
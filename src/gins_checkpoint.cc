@@ -0,0 +1,199 @@
+#include "gins_checkpoint.h"
+
+#include <glog/logging.h>
+#include <cstring>
+
+namespace imu_gps {
+
+namespace {
+
+/// Writes consecutive doubles of a record
+struct RecordWriter {
+    void Add(double v) { *p_++ = v; }
+    void Add(const Vec3d& v) {
+        Add(v[0]);
+        Add(v[1]);
+        Add(v[2]);
+    }
+    double* p_;
+};
+
+/// Reads consecutive doubles of a record
+struct RecordReader {
+    double Next() { return *p_++; }
+    Vec3d Next3() {
+        const double x = Next(), y = Next(), z = Next();
+        return Vec3d(x, y, z);
+    }
+    const double* p_;
+};
+
+void Encode(const GinsCheckpoint& cp, double* record) {
+    RecordWriter w{record};
+    w.Add(cp.state_.timestamp_);
+    const Quatd& q = cp.state_.R_.unit_quaternion();
+    w.Add(q.w());
+    w.Add(q.x());
+    w.Add(q.y());
+    w.Add(q.z());
+    w.Add(cp.state_.p_);
+    w.Add(cp.state_.v_);
+    w.Add(cp.state_.bg_);
+    w.Add(cp.state_.ba_);
+    w.Add(cp.gravity_);
+    for (int i = 0; i < cp.dim_; ++i) {
+        for (int j = i; j < cp.dim_; ++j) {
+            w.Add(cp.cov_(i, j));
+        }
+    }
+    w.Add(cp.init_bg_);
+    w.Add(cp.init_ba_);
+    w.Add(cp.init_gravity_);
+    w.Add(cp.origin_);
+    w.Add(double(cp.stats_.num_imu_));
+    w.Add(double(cp.stats_.num_predict_));
+    w.Add(double(cp.stats_.num_gnss_));
+    w.Add(double(cp.stats_.num_gnss_update_));
+    w.Add(double(cp.stats_.num_gnss_rejected_));
+    w.Add(double(cp.stats_.num_odom_update_));
+    w.Add(cp.stats_.gnss_err_sq_sum_);
+}
+
+void Decode(const double* record, int dim, GinsCheckpoint& cp) {
+    RecordReader r{record};
+    cp.state_.timestamp_ = r.Next();
+    const double qw = r.Next(), qx = r.Next(), qy = r.Next(), qz = r.Next();
+    cp.state_.R_ = SO3(Quatd(qw, qx, qy, qz));
+    cp.state_.p_ = r.Next3();
+    cp.state_.v_ = r.Next3();
+    cp.state_.bg_ = r.Next3();
+    cp.state_.ba_ = r.Next3();
+    cp.gravity_ = r.Next3();
+    cp.dim_ = dim;
+    cp.cov_.setZero();
+    for (int i = 0; i < dim; ++i) {
+        for (int j = i; j < dim; ++j) {
+            cp.cov_(i, j) = cp.cov_(j, i) = r.Next();
+        }
+    }
+    cp.init_bg_ = r.Next3();
+    cp.init_ba_ = r.Next3();
+    cp.init_gravity_ = r.Next3();
+    cp.origin_ = r.Next3();
+    cp.stats_.num_imu_ = size_t(r.Next());
+    cp.stats_.num_predict_ = size_t(r.Next());
+    cp.stats_.num_gnss_ = size_t(r.Next());
+    cp.stats_.num_gnss_update_ = size_t(r.Next());
+    cp.stats_.num_gnss_rejected_ = size_t(r.Next());
+    cp.stats_.num_odom_update_ = size_t(r.Next());
+    cp.stats_.gnss_err_sq_sum_ = r.Next();
+}
+
+}  // namespace
+
+bool CheckpointWriter::Open(const std::string& file_path, int dim) {
+    Close();
+
+    if (dim <= 0 || dim > 18) {
+        LOG(ERROR) << "Invalid filter dimension for checkpoints: " << dim;
+        return false;
+    }
+
+    fp_ = std::fopen(file_path.c_str(), "wb");
+    if (fp_ == nullptr) {
+        LOG(ERROR) << "Failed to open file: " << file_path;
+        return false;
+    }
+
+    Header header;
+    header.dim_ = dim;
+    std::fwrite(&header, sizeof(header), 1, fp_);
+    std::fflush(fp_);
+
+    dim_ = dim;
+    num_checkpoints_ = 0;
+    record_.resize(NumValues(dim));
+    return true;
+}
+
+void CheckpointWriter::Write(const GinsCheckpoint& cp) {
+    if (fp_ == nullptr) {
+        return;
+    }
+    if (cp.dim_ != dim_) {
+        LOG(ERROR) << "Checkpoint of a " << cp.dim_ << "-state filter in a file of " << dim_ << "-state checkpoints";
+        return;
+    }
+
+    Encode(cp, record_.data());
+    std::fwrite(record_.data(), sizeof(double), record_.size(), fp_);
+    std::fflush(fp_);
+    ++num_checkpoints_;
+}
+
+void CheckpointWriter::Close() {
+    if (fp_ != nullptr) {
+        std::fclose(fp_);
+        fp_ = nullptr;
+    }
+}
+
+bool LoadCheckpoint(const std::string& file_path, double time, GinsCheckpoint& cp) {
+    FILE* fp = std::fopen(file_path.c_str(), "rb");
+    if (fp == nullptr) {
+        LOG(ERROR) << "Failed to open file: " << file_path;
+        return false;
+    }
+
+    CheckpointWriter::Header header, expected;
+    if (std::fread(&header, sizeof(header), 1, fp) != 1 ||
+        std::memcmp(header.magic_, expected.magic_, sizeof(header.magic_)) != 0 ||
+        header.version_ != expected.version_ || header.dim_ == 0 || header.dim_ > 18) {
+        LOG(ERROR) << "Not a checkpoint file: " << file_path;
+        std::fclose(fp);
+        return false;
+    }
+
+    // a partially written last record is ignored
+    const size_t record_size = CheckpointWriter::NumValues(header.dim_) * sizeof(double);
+    std::fseek(fp, 0, SEEK_END);
+    const size_t num_records = (std::ftell(fp) - sizeof(header)) / record_size;
+
+    auto record_time = [&](size_t i) {
+        double t = 0;
+        std::fseek(fp, sizeof(header) + i * record_size, SEEK_SET);
+        std::fread(&t, sizeof(t), 1, fp);
+        return t;
+    };
+
+    // first record after time
+    size_t lo = 0, hi = num_records;
+    while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        if (record_time(mid) <= time) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == 0) {
+        LOG(ERROR) << "No checkpoint at or before " << time << " in " << file_path;
+        std::fclose(fp);
+        return false;
+    }
+
+    std::vector<double> record(CheckpointWriter::NumValues(header.dim_));
+    std::fseek(fp, sizeof(header) + (lo - 1) * record_size, SEEK_SET);
+    const bool ok = std::fread(record.data(), record_size, 1, fp) == 1;
+    std::fclose(fp);
+    if (!ok) {
+        LOG(ERROR) << "Failed to read checkpoint from " << file_path;
+        return false;
+    }
+
+    Decode(record.data(), header.dim_, cp);
+    return true;
+}
+
+}  // namespace imu_gps
@@ -0,0 +1,67 @@
+#ifndef IMU_GPS_GINS_CHECKPOINT_H
+#define IMU_GPS_GINS_CHECKPOINT_H
+
+#include "gins_replay.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace imu_gps {
+
+/**
+ * Checkpoint files of GinsReplay runs.
+ *
+ * A Header followed by fixed-size records in the order they are written (time order for one run), so the checkpoint
+ * of a given time is found by binary search without reading the file. A record is NumValues(dim) little-endian
+ * doubles:
+ *   t q(wxyz) p v bg ba gravity, the upper triangle of the covariance row by row,
+ *   init_bg init_ba init_gravity origin, and the GinsReplayStats counters.
+ * Every record is flushed when written, so the file of an interrupted run is usable up to its last checkpoint.
+ */
+class CheckpointWriter {
+   public:
+#pragma pack(push, 1)
+    struct Header {
+        char magic_[8] = {'I', 'G', 'C', 'K', 'P', 'T', '\r', '\n'};
+        uint32_t version_ = 2;
+        uint32_t dim_ = 0;  // Error-state dimension of the filter
+    };
+#pragma pack(pop)
+
+    /// Number of doubles of a record for a filter of the given dimension
+    static size_t NumValues(int dim) { return 20 + dim * (dim + 1) / 2 + 12 + 7; }
+
+    CheckpointWriter() = default;
+    ~CheckpointWriter() { Close(); }
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    /// Create the file for the checkpoints of a dim-state filter
+    bool Open(const std::string& file_path, int dim);
+
+    /// Append a checkpoint, must have the dimension given to Open()
+    void Write(const GinsCheckpoint& cp);
+
+    void Close();
+
+    size_t NumCheckpoints() const { return num_checkpoints_; }
+
+   private:
+    FILE* fp_ = nullptr;
+    int dim_ = 0;
+    size_t num_checkpoints_ = 0;
+    std::vector<double> record_;
+};
+
+/**
+ * Load the last checkpoint at or before time
+ * @return false if the file is missing or invalid, or has no checkpoint before time
+ */
+bool LoadCheckpoint(const std::string& file_path, double time, GinsCheckpoint& cp);
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_GINS_CHECKPOINT_H
@@ -0,0 +1,69 @@
+#include "gins_config.h"
+#include "batch_manifest.h"
+
+#include <glog/logging.h>
+#include <yaml-cpp/yaml.h>
+
+namespace imu_gps {
+
+GinsConfig::GinsConfig(std::string file_path, double reload_interval)
+    : file_path_(std::move(file_path)),
+      reload_interval_(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(reload_interval))),
+      last_poll_(std::chrono::steady_clock::now()) {}
+
+bool GinsConfig::Load(GinsReplayOptions& options) {
+    std::error_code ec;
+    last_write_time_ = std::filesystem::last_write_time(file_path_, ec);
+
+    YAML::Node root;
+    try {
+        root = YAML::LoadFile(file_path_);
+    } catch (const YAML::Exception& e) {
+        LOG(ERROR) << "Failed to load config " << file_path_ << ": " << e.what();
+        return false;
+    }
+    if (!root.IsMap()) {
+        // an empty file is a valid, empty config
+        if (root.IsNull()) {
+            return true;
+        }
+        LOG(ERROR) << "Config " << file_path_ << " is not a map of options";
+        return false;
+    }
+
+    GinsReplayOptions parsed = options;
+    for (const auto& it : root) {
+        const std::string key = it.first.as<std::string>();
+        if (!it.second.IsScalar() || !SetReplayOption(parsed, key, it.second.Scalar())) {
+            LOG(ERROR) << "Config " << file_path_ << ": invalid option " << key;
+            return false;
+        }
+    }
+
+    options = parsed;
+    return true;
+}
+
+bool GinsConfig::Poll(GinsReplayOptions& options) {
+    const auto now = std::chrono::steady_clock::now();
+    if (now - last_poll_ < reload_interval_) {
+        return false;
+    }
+    last_poll_ = now;
+
+    std::error_code ec;
+    const auto write_time = std::filesystem::last_write_time(file_path_, ec);
+    if (ec || write_time == last_write_time_) {
+        return false;
+    }
+
+    // an invalid file is reported once, until it is written again
+    if (!Load(options)) {
+        return false;
+    }
+    LOG(INFO) << "reloaded config " << file_path_;
+    return true;
+}
+
+}  // namespace imu_gps
@@ -0,0 +1,45 @@
+#ifndef IMU_GPS_GINS_CONFIG_H
+#define IMU_GPS_GINS_CONFIG_H
+
+#include "gins_replay.h"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+namespace imu_gps {
+
+/**
+ * YAML configuration of a GinsReplay, loaded at startup and reloaded while running when the file changes.
+ *
+ * The file is a map of the option keys of SetReplayOption (batch_manifest.h) to their values, e.g.
+ *     gyro_var: 1.0e-5
+ *     gnss_gate_chi2: 22.5
+ *     antenna_angle: 12.06
+ *     init_time_seconds: 5
+ * Keys missing from the file keep the value they had, and a file that does not parse changes nothing.
+ * Poll() only reads the modification time of the file, at most once every reload_interval seconds, so it can be
+ * called from the filter loop and the new options applied in place with GinsReplay::SetOptions.
+ */
+class GinsConfig {
+   public:
+    explicit GinsConfig(std::string file_path, double reload_interval = 1.0);
+
+    /// Apply the file to options, @return false if it cannot be read or has an invalid key, options are then unchanged
+    bool Load(GinsReplayOptions& options);
+
+    /// Reload the file into options if it changed since the last Load, @return true if options changed
+    bool Poll(GinsReplayOptions& options);
+
+    const std::string& GetFilePath() const { return file_path_; }
+
+   private:
+    std::string file_path_;
+    std::chrono::steady_clock::duration reload_interval_;
+    std::chrono::steady_clock::time_point last_poll_;
+    std::filesystem::file_time_type last_write_time_{};
+};
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_GINS_CONFIG_H
@@ -0,0 +1,351 @@
+#ifndef IMU_GPS_GINS_PIPELINE_H
+#define IMU_GPS_GINS_PIPELINE_H
+
+#include "common/batch_pool.h"
+#include "common/bounded_queue.h"
+#include "common/io_utils.h"
+#include "common/replay_pacer.h"
+#include "common/sensor_sync.h"
+#include "gins_replay.h"
+#include "gins_telemetry.h"
+#include "utm_convert.h"
+
+#include <glog/logging.h>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace imu_gps {
+
+/// One reading of a log
+using SensorEvent = std::variant<IMU, Odom, GNSS>;
+
+/// Configuration of the pipeline stages
+struct GinsPipelineOptions {
+    size_t batch_size_ = 256;  // Readings (or states) handed from one stage to the next at once
+    size_t queue_depth_ = 16;  // Batches buffered between two stages before the producer blocks
+    double replay_speed_ = 0;  // ReplayPacer speed of the filter stage, 0 = as fast as possible
+    double sync_window_ = 0;   // If > 0, put the readings in time order with a SensorSynchronizer of this window
+};
+
+/// Readings or states handed from one stage to the next, stamped with the arrival of the first reading they come from
+template <typename T>
+struct PipelineBatch {
+    std::vector<T> items_;
+    std::chrono::steady_clock::time_point arrival_;
+};
+
+/// Back-pressure counters of a run, number of times a stage waited for its consumer
+struct GinsPipelineStats {
+    size_t num_events_ = 0;       // Readings parsed
+    size_t reader_waits_ = 0;     // Reader waited for the conversion stage
+    size_t converter_waits_ = 0;  // Conversion stage waited for the filter
+    size_t filter_waits_ = 0;     // Filter waited for the output stage
+    size_t event_batches_ = 0;    // Reading batches allocated, constant after warm-up
+    size_t state_batches_ = 0;    // State batches allocated, constant after warm-up
+};
+
+/**
+ * The GinsReplay flow split into four threads connected by bounded queues:
+ *
+ *   reader (TxtIO/LiveIO) -> GNSS conversion (ConvertGps2UTM) -> filter (GinsReplay) -> output (state callback)
+ *
+ * Readings travel in batches to keep the per-reading synchronization cost low. Every stage is a single thread and
+ * every queue is FIFO, so the filter receives the readings in log order and the output callback receives the states in
+ * the order the filter published them, exactly as with a single-threaded GinsReplay. With sync_window_ > 0 the filter
+ * stage additionally restores time order with a SensorSynchronizer, for logs recorded from jittery live feeds.
+ * The queues are bounded, so a slow stage throttles the ones before it and memory use stays constant regardless of
+ * the log size. The batches are recycled through a BatchPool after the last stage that uses them, so a steady run does
+ * no heap allocation per reading.
+ *
+ * @tparam Filter filter type, needs the interface of ESKF
+ */
+template <typename Filter = ESKFD>
+class GinsPipeline {
+   public:
+    using OutputCallback = std::function<void(const NavStated&)>;
+    /// Sets new options and returns true if they changed, e.g. GinsConfig::Poll
+    using OptionsSource = std::function<bool(GinsReplayOptions&)>;
+
+    explicit GinsPipeline(GinsReplayOptions replay_options = GinsReplayOptions(),
+                          GinsPipelineOptions options = GinsPipelineOptions())
+        : replay_options_(replay_options), options_(options), replay_(replay_options) {}
+
+    /// Set the callback invoked on the output thread with every new filter state
+    GinsPipeline& SetOutputCallback(OutputCallback cb) {
+        output_cb_ = std::move(cb);
+        return *this;
+    }
+
+    /// Poll for new options on the filter thread before every batch, see GinsReplay::SetOptions
+    GinsPipeline& SetOptionsSource(OptionsSource source) {
+        options_source_ = std::move(source);
+        return *this;
+    }
+
+    /**
+     * Record the stage latencies, reading rates and queue depths of the runs, null to disable.
+     * The read, convert and filter stages are recorded here, end_to_end after the output callback of every state;
+     * the output callback may record output and ui.
+     */
+    GinsPipeline& SetTelemetry(GinsTelemetry* telemetry) {
+        telemetry_ = telemetry;
+        return *this;
+    }
+
+    /// Process a whole log, returns once every stage is done
+    void Run(const std::string& file_path) {
+        TxtIO io(file_path);
+        Run(io);
+    }
+
+    /**
+     * Process the readings of a source until its Go() returns
+     * @tparam Source needs the callback setters and Go() of TxtIO, e.g. LiveIO
+     */
+    template <typename Source>
+    void Run(Source& source) {
+        BoundedQueue<PipelineBatch<SensorEvent>> parsed(options_.queue_depth_);
+        BoundedQueue<PipelineBatch<SensorEvent>> converted(options_.queue_depth_);
+        BoundedQueue<PipelineBatch<NavStated>> states(options_.queue_depth_);
+        BatchPool<SensorEvent> event_pool(options_.batch_size_);
+        BatchPool<NavStated> state_pool(options_.batch_size_);
+        event_pool_ = &event_pool;
+        state_pool_ = &state_pool;
+
+        std::thread reader([&]() { ReadStage(source, parsed); });
+        std::thread converter([&]() { ConvertStage(parsed, converted); });
+        std::thread output([&]() { OutputStage(states); });
+        FilterStage(converted, states);
+
+        reader.join();
+        converter.join();
+        output.join();
+
+        pipeline_stats_.reader_waits_ = parsed.NumFullWaits();
+        pipeline_stats_.converter_waits_ = converted.NumFullWaits();
+        pipeline_stats_.filter_waits_ = states.NumFullWaits();
+        pipeline_stats_.event_batches_ = event_pool.GetStats().num_allocated_;
+        pipeline_stats_.state_batches_ = state_pool.GetStats().num_allocated_;
+        event_pool_ = nullptr;
+        state_pool_ = nullptr;
+        LOG(INFO) << "pipeline: " << pipeline_stats_.num_events_ << " readings, stage waits reader "
+                  << pipeline_stats_.reader_waits_ << ", converter " << pipeline_stats_.converter_waits_
+                  << ", filter " << pipeline_stats_.filter_waits_ << ", batches allocated "
+                  << pipeline_stats_.event_batches_ << " + " << pipeline_stats_.state_batches_;
+    }
+
+    const GinsReplayStats& GetStats() const { return replay_.GetStats(); }
+    const GinsPipelineStats& GetPipelineStats() const { return pipeline_stats_; }
+    const GinsReplay<Filter>& GetReplay() const { return replay_; }
+    GinsReplay<Filter>& GetReplay() { return replay_; }
+
+   private:
+    template <typename Source>
+    void ReadStage(Source& source, BoundedQueue<PipelineBatch<SensorEvent>>& out) {
+        PipelineBatch<SensorEvent> batch{event_pool_->Acquire(), {}};
+        size_t num_events = 0;
+        auto last_added = std::chrono::steady_clock::now();
+        auto add = [&](const auto& reading) {
+            if (telemetry_) {
+                const auto now = std::chrono::steady_clock::now();
+                telemetry_->Record(GinsTelemetry::Stage::READ, now - last_added);
+                if (batch.items_.empty()) {
+                    batch.arrival_ = now;
+                }
+            }
+            batch.items_.emplace_back(reading);
+            if (batch.items_.size() >= options_.batch_size_) {
+                num_events += batch.items_.size();
+                out.Push(std::move(batch));
+                batch.items_ = event_pool_->Acquire();
+                if (telemetry_) {
+                    telemetry_->SetQueueDepth(GinsTelemetry::Queue::PARSED, out.Size());
+                }
+            }
+            if (telemetry_) {
+                last_added = std::chrono::steady_clock::now();
+            }
+        };
+
+        source.SetIMUProcessFunc([&](const IMU& imu) { add(imu); })
+            .SetOdomProcessFunc([&](const Odom& odom) { add(odom); })
+            .SetGNSSProcessFunc([&](const GNSS& gnss) { add(gnss); })
+            .Go();
+
+        if (!batch.items_.empty()) {
+            num_events += batch.items_.size();
+            out.Push(std::move(batch));
+        } else {
+            event_pool_->Release(std::move(batch.items_));
+        }
+        pipeline_stats_.num_events_ = num_events;
+        out.Close();
+    }
+
+    void ConvertStage(BoundedQueue<PipelineBatch<SensorEvent>>& in, BoundedQueue<PipelineBatch<SensorEvent>>& out) {
+        PipelineBatch<SensorEvent> batch;
+        while (in.Pop(batch)) {
+            Vec2d antenna_pos;
+            double antenna_angle = 0;
+            {
+                std::lock_guard<std::mutex> lock(options_mutex_);
+                antenna_pos = replay_options_.antenna_pos_;
+                antenna_angle = replay_options_.antenna_angle_;
+            }
+            for (auto& event : batch.items_) {
+                if (GNSS* gnss = std::get_if<GNSS>(&event)) {
+                    const auto t1 = std::chrono::steady_clock::now();
+                    gnss->utm_valid_ = ConvertGps2UTM(*gnss, antenna_pos, antenna_angle);
+                    if (telemetry_) {
+                        telemetry_->RecordSince(GinsTelemetry::Stage::CONVERT, t1);
+                    }
+                }
+            }
+            out.Push(std::move(batch));
+            if (telemetry_) {
+                telemetry_->SetQueueDepth(GinsTelemetry::Queue::CONVERTED, out.Size());
+            }
+        }
+        out.Close();
+    }
+
+    void FilterStage(BoundedQueue<PipelineBatch<SensorEvent>>& in, BoundedQueue<PipelineBatch<NavStated>>& out) {
+        ReplayPacer pacer(options_.replay_speed_);
+        PipelineBatch<NavStated> published{state_pool_->Acquire(), {}};
+        PipelineBatch<SensorEvent> batch;
+        auto flush = [&]() {
+            if (!published.items_.empty()) {
+                out.Push(std::move(published));
+                published.items_ = state_pool_->Acquire();
+                if (telemetry_) {
+                    telemetry_->SetQueueDepth(GinsTelemetry::Queue::STATES, out.Size());
+                }
+            }
+        };
+        replay_.SetStateCallback([&](const NavStated& state) {
+            if (published.items_.empty()) {
+                published.arrival_ = batch.arrival_;
+            }
+            published.items_.emplace_back(state);
+            // a paced replay is usually watched in the UI, hand every state over at once
+            if (published.items_.size() >= options_.batch_size_ || pacer.Paced()) {
+                flush();
+            }
+        });
+
+        // the filter time of a reading, without the pacing wait
+        auto timed = [&](GinsTelemetry::Sensor sensor, double sensor_time, auto&& process) {
+            if (!telemetry_) {
+                process();
+                return;
+            }
+            const auto t1 = std::chrono::steady_clock::now();
+            process();
+            telemetry_->RecordSince(GinsTelemetry::Stage::FILTER, t1);
+            telemetry_->CountReading(sensor, sensor_time);
+        };
+        auto add_imu = [&](const IMU& imu) {
+            pacer.WaitUntil(imu.timestamp_);
+            timed(GinsTelemetry::Sensor::IMU, imu.timestamp_, [&]() { replay_.AddIMU(imu); });
+        };
+        auto add_odom = [&](const Odom& odom) {
+            timed(GinsTelemetry::Sensor::ODOM, odom.timestamp_, [&]() { replay_.AddOdom(odom); });
+        };
+        auto add_gnss = [&](const GNSS& gnss) {
+            timed(GinsTelemetry::Sensor::GNSS, gnss.unix_time_, [&]() { replay_.AddConvertedGNSS(gnss); });
+        };
+
+        std::optional<SensorSynchronizer> sync;
+        if (options_.sync_window_ > 0) {
+            SensorSynchronizer::Options sync_options;
+            sync_options.latency_window_ = options_.sync_window_;
+            sync.emplace(sync_options);
+            sync->SetIMUProcessFunc(add_imu).SetOdomProcessFunc(add_odom).SetGNSSProcessFunc(add_gnss);
+        }
+
+        while (in.Pop(batch)) {
+            PollOptions();
+            for (const auto& event : batch.items_) {
+                if (const IMU* imu = std::get_if<IMU>(&event)) {
+                    if (sync) {
+                        sync->AddIMU(*imu);
+                    } else {
+                        add_imu(*imu);
+                    }
+                } else if (const Odom* odom = std::get_if<Odom>(&event)) {
+                    if (sync) {
+                        sync->AddOdom(*odom);
+                    } else {
+                        add_odom(*odom);
+                    }
+                } else if (sync) {
+                    sync->AddGNSS(std::get<GNSS>(event));
+                } else {
+                    add_gnss(std::get<GNSS>(event));
+                }
+            }
+            event_pool_->Release(std::move(batch.items_));
+            flush();
+        }
+        if (sync) {
+            sync->Flush();
+            flush();
+            LOG(INFO) << sync->StatsString();
+        }
+        replay_.SetStateCallback(nullptr);
+        state_pool_->Release(std::move(published.items_));
+        out.Close();
+    }
+
+    /// Apply new options from the options source to the replay, and the antenna to the converter
+    void PollOptions() {
+        if (!options_source_) {
+            return;
+        }
+        GinsReplayOptions options = replay_.GetOptions();
+        if (!options_source_(options)) {
+            return;
+        }
+        replay_.SetOptions(options);
+        std::lock_guard<std::mutex> lock(options_mutex_);
+        replay_options_ = options;
+    }
+
+    void OutputStage(BoundedQueue<PipelineBatch<NavStated>>& in) {
+        PipelineBatch<NavStated> batch;
+        while (in.Pop(batch)) {
+            if (output_cb_) {
+                for (const auto& state : batch.items_) {
+                    output_cb_(state);
+                    if (telemetry_) {
+                        telemetry_->RecordSince(GinsTelemetry::Stage::END_TO_END, batch.arrival_);
+                    }
+                }
+            }
+            state_pool_->Release(std::move(batch.items_));
+        }
+    }
+
+    GinsReplayOptions replay_options_;  // Guarded by options_mutex_ while running, read by the converter
+    std::mutex options_mutex_;
+    GinsPipelineOptions options_;
+    GinsReplay<Filter> replay_;
+    OutputCallback output_cb_;
+    OptionsSource options_source_;
+    GinsTelemetry* telemetry_ = nullptr;
+    GinsPipelineStats pipeline_stats_;
+
+    /// Batch pools of the current Run()
+    BatchPool<SensorEvent>* event_pool_ = nullptr;
+    BatchPool<NavStated>* state_pool_ = nullptr;
+};
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_GINS_PIPELINE_H
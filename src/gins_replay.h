@@ -0,0 +1,357 @@
+#ifndef IMU_GPS_GINS_REPLAY_H
+#define IMU_GPS_GINS_REPLAY_H
+
+#include "common/gnss.h"
+#include "common/imu.h"
+#include "common/nav_state.h"
+#include "common/odom.h"
+#include "common/timer/timer.h"
+#include "eskf.hpp"
+#include "static_imu_init.h"
+#include "utm_convert.h"
+
+#include <glog/logging.h>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <optional>
+
+namespace imu_gps {
+
+/// Configuration of one GNSS/IMU(/Odom) integrated navigation run
+struct GinsReplayOptions {
+    ESKFOptions eskf_options_;
+    StaticIMUInit::Options init_options_;
+
+    // The following parameters are only for the data provided in this book
+    double antenna_angle_ = 12.06;                  // RTK antenna installation angle (in degrees)
+    Vec2d antenna_pos_ = Vec2d(-0.17, -0.20);       // RTK antenna installation offset in X and Y
+    bool with_odom_ = true;                         // Whether to include odometry information
+    bool profile_ = false;                          // Record Predict/Observe* latencies in common::Timer
+    double checkpoint_interval_ = 0;                // If > 0, minimum log time between two checkpoints (seconds)
+};
+
+/// Counters collected during a run
+struct GinsReplayStats {
+    size_t num_imu_ = 0;            // IMU readings received
+    size_t num_predict_ = 0;        // IMU readings used for prediction
+    size_t num_gnss_ = 0;           // GNSS readings received
+    size_t num_gnss_update_ = 0;    // GNSS readings used for correction
+    size_t num_gnss_rejected_ = 0;  // GNSS readings rejected by the innovation gate (gnss_gate_chi2_)
+    size_t num_odom_update_ = 0;    // Odom readings used for correction
+    double gnss_err_sq_sum_ = 0;    // Sum of squared distances between predicted and observed GNSS positions
+
+    /// RMS distance between the predicted position and the GNSS position before each correction
+    double GnssRmse() const { return num_gnss_update_ > 1 ? std::sqrt(gnss_err_sq_sum_ / (num_gnss_update_ - 1)) : 0; }
+};
+
+/**
+ * Everything a GinsReplay needs to resume a run: the filter state, the initializer results, the map origin and the
+ * counters. Taken right after a GNSS correction, where the filter has no pending pre-integrated samples.
+ */
+struct GinsCheckpoint {
+    NavStated state_;                    // Nominal state, its timestamp_ is the time of the checkpoint
+    Vec3d gravity_ = Vec3d(0, 0, -9.8);  // Estimated gravity
+    int dim_ = 18;                       // Error-state dimension of the filter
+    Mat18d cov_ = Mat18d::Zero();        // Error-state covariance in the top-left dim_ x dim_ block
+
+    Vec3d init_bg_ = Vec3d::Zero();       // StaticIMUInit results
+    Vec3d init_ba_ = Vec3d::Zero();
+    Vec3d init_gravity_ = Vec3d::Zero();
+
+    Vec3d origin_ = Vec3d::Zero();  // UTM position of the map origin
+    GinsReplayStats stats_;
+};
+
+/**
+ * The RTK+IMU(+Odom) integrated navigation flow of run_eskf_gins, packed into an object.
+ *
+ * All state of a run (initializer, filter, map origin) lives in this object, so independent runs can be executed
+ * concurrently from different threads. Feed readings in log order through AddIMU/AddGNSS/AddOdom; every new filter
+ * state is reported through the state callback.
+ *
+ * With checkpoint_interval_ > 0, a GinsCheckpoint is handed to the checkpoint callback after the first GNSS correction
+ * at least that long after the previous one. Restore() on a new GinsReplay with the same options continues the run
+ * from there, with the readings logged after the checkpoint time.
+ *
+ * StartFromPriors() sets the filter up from the results of an earlier StaticIMUInit of the same device (see
+ * imu_init_cache.h) without waiting for the vehicle to stand still. The initializer keeps running on the readings next
+ * to the filter, whose bias states refine the priors online, and its results are handed to the init callback when it
+ * converges, e.g. to update the cache for the next run.
+ *
+ * @tparam Filter filter type, needs the interface of ESKF
+ */
+template <typename Filter = ESKFD>
+class GinsReplay {
+   public:
+    using StateCallback = std::function<void(const NavStated&)>;
+    using CheckpointCallback = std::function<void(const GinsCheckpoint&)>;
+    using InitCallback = std::function<void(const StaticIMUInit::Result&)>;
+    static constexpr int kDim = Filter::CovT::RowsAtCompileTime;
+
+    explicit GinsReplay(GinsReplayOptions options = GinsReplayOptions())
+        : options_(options), imu_init_(options.init_options_), filter_(options.eskf_options_) {}
+
+    /// Set the callback invoked with every new filter state
+    GinsReplay& SetStateCallback(StateCallback cb) {
+        state_cb_ = std::move(cb);
+        return *this;
+    }
+
+    /// Set the callback invoked with the checkpoints, see GinsReplayOptions::checkpoint_interval_
+    GinsReplay& SetCheckpointCallback(CheckpointCallback cb) {
+        checkpoint_cb_ = std::move(cb);
+        return *this;
+    }
+
+    void AddIMU(const IMU& imu) {
+        ++stats_.num_imu_;
+        if (!imu_init_.InitSuccess()) {
+            imu_init_.AddIMU(imu);
+            if (imu_init_.InitSuccess()) {
+                priors_ = imu_init_.GetResult();
+                if (init_cb_) {
+                    init_cb_(priors_);
+                }
+            }
+            // without priors, the filter waits for the initializer
+            if (!imu_inited_) {
+                return;
+            }
+        } else if (!imu_inited_) {
+            // Read initial biases and set up the filter.
+            // Noise estimated by the initializer.
+            //   options.gyro_var_ = sqrt(imu_init_.GetCovGyro()[0]);
+            //   options.acce_var_ = sqrt(imu_init_.GetCovAcce()[0]);
+            filter_.SetInitialConditions(options_.eskf_options_, imu_init_.GetInitBg(), imu_init_.GetInitBa(),
+                                         imu_init_.GetGravity());
+            imu_inited_ = true;
+            return;
+        }
+
+        /// Wait for valid RTK data.
+        if (!gnss_inited_) {
+            return;
+        }
+
+        /// Once GNSS is also received, start the prediction.
+        {
+            static const int timer_id = common::Timer::Register("ESKF Predict");
+            ProfileScope t(options_.profile_, timer_id);
+            filter_.Predict(imu);
+        }
+        ++stats_.num_predict_;
+
+        /// The predict function will update the filter, so data can be sent at this point.
+        PublishState();
+    }
+
+    void AddGNSS(const GNSS& gnss) {
+        GNSS gnss_convert = gnss;
+        ConvertGNSS(gnss_convert);
+        AddConvertedGNSS(gnss_convert);
+    }
+
+    /**
+     * The conversion step of AddGNSS: ConvertGps2UTM with the antenna options of this run, skipped until the filter
+     * is set up since AddConvertedGNSS drops those readings anyway. @return utm_valid_
+     */
+    bool ConvertGNSS(GNSS& gnss) const {
+        gnss.utm_valid_ = imu_inited_ && ConvertGps2UTM(gnss, options_.antenna_pos_, options_.antenna_angle_);
+        return gnss.utm_valid_;
+    }
+
+    /**
+     * Add a GNSS reading that has already been through ConvertGps2UTM with the antenna options of this run (and no
+     * map origin), e.g. on another thread. Readings with utm_valid_ == false are counted and skipped.
+     */
+    void AddConvertedGNSS(const GNSS& gnss) {
+        ++stats_.num_gnss_;
+        if (!imu_inited_ || !gnss.utm_valid_ || !gnss.heading_valid_) {
+            return;
+        }
+
+        GNSS gnss_convert = gnss;
+
+        if (!first_gnss_set_) {
+            origin_ = gnss_convert.utm_pose_.translation();
+            first_gnss_set_ = true;
+        }
+        gnss_convert.utm_pose_.translation() -= origin_;
+
+        const double err_sq =
+            (filter_.GetNominalSE3().translation() - gnss_convert.utm_pose_.translation()).squaredNorm();
+
+        // RTK heading must be valid in order to integrate with the filter.
+        // Rejected fixes are timed separately, their count and cost show up next to those of the updates.
+        static const int timer_id = common::Timer::Register("ESKF ObserveGps");
+        static const int rejected_timer_id = common::Timer::Register("ESKF ObserveGps rejected");
+        const auto t1 = std::chrono::steady_clock::now();
+        const bool updated = filter_.ObserveGps(gnss_convert);
+        if (options_.profile_) {
+            common::Timer::Record(updated ? timer_id : rejected_timer_id, std::chrono::steady_clock::now() - t1);
+        }
+        if (!updated) {
+            ++stats_.num_gnss_rejected_;
+            return;
+        }
+
+        if (gnss_inited_) {
+            stats_.gnss_err_sq_sum_ += err_sq;
+        }
+        ++stats_.num_gnss_update_;
+
+        PublishState();
+
+        gnss_inited_ = true;
+
+        if (checkpoint_cb_ && options_.checkpoint_interval_ > 0 &&
+            gnss.unix_time_ - last_checkpoint_time_ >= options_.checkpoint_interval_) {
+            last_checkpoint_time_ = gnss.unix_time_;
+            checkpoint_cb_(Checkpoint());
+        }
+    }
+
+    void AddOdom(const Odom& odom) {
+        /// Odom processing function, Odom is only used for initialization in this chapter
+        imu_init_.AddOdom(odom);
+        if (options_.with_odom_ && imu_inited_ && gnss_inited_) {
+            static const int timer_id = common::Timer::Register("ESKF ObserveWheelSpeed");
+            ProfileScope t(options_.profile_, timer_id);
+            filter_.ObserveWheelSpeed(odom);
+            ++stats_.num_odom_update_;
+        }
+    }
+
+    /// Set the callback invoked once with the results of the static IMU initialization when it converges
+    GinsReplay& SetInitCallback(InitCallback cb) {
+        init_cb_ = std::move(cb);
+        return *this;
+    }
+
+    /**
+     * Set the filter up from the biases and gravity of an earlier initialization, before the first reading
+     * @return false if the filter is already set up
+     */
+    bool StartFromPriors(const StaticIMUInit::Result& priors) {
+        if (imu_inited_) {
+            LOG(WARNING) << "The filter is already initialized, the IMU priors are ignored";
+            return false;
+        }
+
+        filter_.SetInitialConditions(options_.eskf_options_, priors.init_bg_, priors.init_ba_, priors.gravity_);
+        priors_ = priors;
+        imu_inited_ = true;
+        LOG(INFO) << "starting from the IMU priors, bg = " << priors.init_bg_.transpose()
+                  << ", ba = " << priors.init_ba_.transpose() << ", grav = " << priors.gravity_.transpose();
+        return true;
+    }
+
+    /**
+     * Replace the options between readings, e.g. reloaded from a config file (GinsConfig). The filter noise is
+     * rebuilt in place (Filter::SetOptions), the state, covariance and initialization are kept. init_options_ only
+     * apply to a new run.
+     */
+    void SetOptions(const GinsReplayOptions& options) {
+        const StaticIMUInit::Options init_options = options_.init_options_;
+        options_ = options;
+        options_.init_options_ = init_options;
+        filter_.SetOptions(options_.eskf_options_);
+    }
+
+    const GinsReplayOptions& GetOptions() const { return options_; }
+
+    /// Whether the filter is running (IMU initialized and the first GNSS received)
+    bool Running() const { return imu_inited_ && gnss_inited_; }
+
+    /// Whether the filter is set up from the IMU initialization (or priors), from then on GNSS readings are converted
+    bool IMUInited() const { return imu_inited_; }
+
+    const GinsReplayStats& GetStats() const { return stats_; }
+    const Filter& GetFilter() const { return filter_; }
+    Filter& GetFilter() { return filter_; }
+
+    /// UTM position of the map origin (the first valid GNSS reading)
+    Vec3d GetOrigin() const { return origin_; }
+
+    /// Snapshot of the run, exact when taken between readings after a GNSS correction
+    GinsCheckpoint Checkpoint() {
+        GinsCheckpoint cp;
+        if constexpr (std::is_same_v<typename Filter::NavStateT, NavStated>) {
+            cp.state_ = filter_.GetNominalState();
+        } else {
+            cp.state_ = filter_.GetNominalState().template cast<double>();
+        }
+        cp.gravity_ = filter_.GetGravity();
+        cp.dim_ = kDim;
+        cp.cov_.template topLeftCorner<kDim, kDim>() = filter_.GetCov().template cast<double>();
+        cp.init_bg_ = priors_.init_bg_;
+        cp.init_ba_ = priors_.init_ba_;
+        cp.init_gravity_ = priors_.gravity_;
+        cp.origin_ = origin_;
+        cp.stats_ = stats_;
+        return cp;
+    }
+
+    /// Continue from a checkpoint of a run with the same options, feed the readings after its time next
+    bool Restore(const GinsCheckpoint& cp) {
+        if (cp.dim_ != kDim) {
+            LOG(ERROR) << "Checkpoint of a " << cp.dim_ << "-state filter, this filter has " << kDim << " states";
+            return false;
+        }
+
+        using Scalar = typename Filter::CovT::Scalar;
+        imu_init_.SetInitResult(cp.init_bg_, cp.init_ba_, cp.init_gravity_);
+        priors_ = imu_init_.GetResult();
+        filter_.SetInitialConditions(options_.eskf_options_, cp.init_bg_, cp.init_ba_, cp.init_gravity_);
+        filter_.Restore(cp.state_, cp.gravity_, cp.cov_.template topLeftCorner<kDim, kDim>().template cast<Scalar>());
+        imu_inited_ = true;
+        gnss_inited_ = true;
+        first_gnss_set_ = true;
+        origin_ = cp.origin_;
+        stats_ = cp.stats_;
+        last_checkpoint_time_ = cp.state_.timestamp_;
+        return true;
+    }
+
+   private:
+    /// common::Timer::Scope that only reads the clock when profiling is enabled
+    struct ProfileScope {
+        ProfileScope(bool enabled, int id) {
+            if (enabled) {
+                scope_.emplace(id);
+            }
+        }
+        std::optional<common::Timer::Scope> scope_;
+    };
+
+    void PublishState() {
+        if (state_cb_) {
+            if constexpr (std::is_same_v<typename Filter::NavStateT, NavStated>) {
+                state_cb_(filter_.GetNominalState());
+            } else {
+                state_cb_(filter_.GetNominalState().template cast<double>());
+            }
+        }
+    }
+
+    GinsReplayOptions options_;
+    StaticIMUInit imu_init_;
+    Filter filter_;
+    StateCallback state_cb_;
+    CheckpointCallback checkpoint_cb_;
+    InitCallback init_cb_;
+
+    StaticIMUInit::Result priors_;  // Those of StartFromPriors() until the initializer converges, then its results
+    bool imu_inited_ = false;
+    bool gnss_inited_ = false;
+    bool first_gnss_set_ = false;
+    Vec3d origin_ = Vec3d::Zero();
+    double last_checkpoint_time_ = std::numeric_limits<double>::lowest();
+
+    GinsReplayStats stats_;
+};
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_GINS_REPLAY_H
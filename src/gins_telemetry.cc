@@ -0,0 +1,192 @@
+#include "gins_telemetry.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <glog/logging.h>
+#include <cstdlib>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+
+namespace imu_gps {
+
+namespace {
+
+constexpr char kUdpPrefix[] = "udp://";
+
+constexpr const char* kStageNames[] = {"read", "convert", "filter", "output", "ui", "end_to_end"};
+constexpr const char* kSensorNames[] = {"imu", "odom", "gnss"};
+constexpr const char* kQueueNames[] = {"parsed", "converted", "states"};
+
+static_assert(std::size(kStageNames) == size_t(GinsTelemetry::Stage::NUM_STAGES));
+static_assert(std::size(kSensorNames) == size_t(GinsTelemetry::Sensor::NUM_SENSORS));
+static_assert(std::size(kQueueNames) == size_t(GinsTelemetry::Queue::NUM_QUEUES));
+
+}  // namespace
+
+GinsTelemetry::GinsTelemetry(Options options) : options_(std::move(options)) {}
+
+bool GinsTelemetry::Start() {
+    if (exporter_.joinable()) {
+        return true;
+    }
+
+    const std::string& sink = options_.sink_;
+    if (sink.compare(0, sizeof(kUdpPrefix) - 1, kUdpPrefix) == 0) {
+        const std::string host_port = sink.substr(sizeof(kUdpPrefix) - 1);
+        const size_t colon = host_port.rfind(':');
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        if (colon == std::string::npos ||
+            ::inet_pton(AF_INET, host_port.substr(0, colon).c_str(), &addr.sin_addr) != 1) {
+            LOG(ERROR) << "Expected udp://ADDRESS:PORT, got " << sink;
+            return false;
+        }
+        addr.sin_port = htons(std::atoi(host_port.c_str() + colon + 1));
+
+        fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd_ < 0 || ::connect(fd_, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+            LOG(ERROR) << "Failed to open telemetry socket to " << sink;
+            if (fd_ >= 0) {
+                ::close(fd_);
+                fd_ = -1;
+            }
+            return false;
+        }
+    } else {
+        fp_ = std::fopen(sink.c_str(), "w");
+        if (fp_ == nullptr) {
+            LOG(ERROR) << "Failed to open file: " << sink;
+            return false;
+        }
+    }
+
+    Snapshot();  // the first line covers the run from here
+    stop_ = false;
+    exporter_ = std::thread([this]() { Export(); });
+    return true;
+}
+
+void GinsTelemetry::Stop() {
+    if (!exporter_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    exporter_.join();
+
+    Write(Snapshot());
+    if (fp_ != nullptr) {
+        std::fclose(fp_);
+        fp_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+void GinsTelemetry::Export() {
+    const auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(std::max(0.01, options_.export_interval_)));
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (!cv_.wait_for(lock, interval, [this] { return stop_; })) {
+        lock.unlock();
+        Write(Snapshot());
+        lock.lock();
+    }
+}
+
+void GinsTelemetry::Write(const std::string& line) {
+    if (fp_ != nullptr) {
+        std::fputs(line.c_str(), fp_);
+        std::fputc('\n', fp_);
+        std::fflush(fp_);
+    } else if (fd_ >= 0) {
+        // a missing listener is not an error of the run
+        ::send(fd_, line.data(), line.size(), MSG_DONTWAIT);
+    }
+}
+
+std::string GinsTelemetry::Snapshot() {
+    const auto now = Clock::now();
+    const double interval = std::chrono::duration<double>(now - prev_time_).count();
+    prev_time_ = now;
+    const double per_second = interval > 0 ? 1.0 / interval : 0.0;
+
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(3) << "{\"time\": "
+       << std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count()
+       << ", \"interval\": " << interval;
+
+    ss << ", \"rate\": {";
+    for (int i = 0; i < int(Sensor::NUM_SENSORS); ++i) {
+        const uint64_t count = counts_[i].load(std::memory_order_relaxed);
+        ss << (i > 0 ? ", " : "") << "\"" << kSensorNames[i] << "\": " << double(count - prev_counts_[i]) * per_second;
+        prev_counts_[i] = count;
+    }
+
+    // no rate before a reading of the interval has a previous one to compare with
+    const double sensor_time = sensor_time_.load(std::memory_order_relaxed);
+    const double sensor_time_rate =
+        prev_sensor_time_ > 0 && sensor_time > 0 ? (sensor_time - prev_sensor_time_) * per_second : 0.0;
+    prev_sensor_time_ = sensor_time;
+    ss << "}, \"sensor_time_rate\": " << sensor_time_rate;
+
+    // the histograms are cumulative, the interval is the difference to the previous snapshot
+    ss << ", \"latency_ms\": {";
+    constexpr double ns2ms = 1e-6;
+    std::vector<uint64_t> buckets(common::Timer::Histogram::kNumBuckets);
+    for (int s = 0; s < int(Stage::NUM_STAGES); ++s) {
+        HistState& prev = prev_hists_[s];
+        std::fill(buckets.begin(), buckets.end(), 0);
+        uint64_t count = 0, sum_ns = 0, max_ns = 0;
+        hists_[s].MergeInto(buckets, count, sum_ns, max_ns);
+
+        const uint64_t n = count - prev.count_;
+        const double mean = n > 0 ? double(sum_ns - prev.sum_ns_) / double(n) * ns2ms : 0.0;
+        double p50 = 0, p99 = 0, max = 0;
+        uint64_t seen = 0;
+        const uint64_t rank50 = std::max<uint64_t>(1, uint64_t(0.5 * double(n) + 0.5));
+        const uint64_t rank99 = std::max<uint64_t>(1, uint64_t(0.99 * double(n) + 0.5));
+        for (int i = 0; i < common::Timer::Histogram::kNumBuckets; ++i) {
+            const uint64_t b = buckets[i] - prev.buckets_[i];
+            prev.buckets_[i] = buckets[i];
+            if (b == 0) {
+                continue;
+            }
+            const double value = common::Timer::Histogram::BucketValue(i) * ns2ms;
+            if (seen < rank50 && seen + b >= rank50) {
+                p50 = value;
+            }
+            if (seen < rank99 && seen + b >= rank99) {
+                p99 = value;
+            }
+            seen += b;
+            max = value;
+        }
+        prev.count_ = count;
+        prev.sum_ns_ = sum_ns;
+
+        ss << (s > 0 ? ", " : "") << "\"" << kStageNames[s] << "\": {\"count\": " << n << ", \"mean\": " << mean
+           << ", \"p50\": " << p50 << ", \"p99\": " << p99 << ", \"max\": " << max << "}";
+    }
+
+    ss << "}, \"queue_depth\": {";
+    for (int q = 0; q < int(Queue::NUM_QUEUES); ++q) {
+        QueueGauge& g = queues_[q];
+        const size_t last = g.last_.load(std::memory_order_relaxed);
+        ss << (q > 0 ? ", " : "") << "\"" << kQueueNames[q] << "\": {\"last\": " << last
+           << ", \"max\": " << std::max(last, g.max_.exchange(last, std::memory_order_relaxed)) << "}";
+    }
+    ss << "}}";
+    return ss.str();
+}
+
+}  // namespace imu_gps
@@ -0,0 +1,133 @@
+#ifndef IMU_GPS_GINS_TELEMETRY_H
+#define IMU_GPS_GINS_TELEMETRY_H
+
+#include "common/timer/timer.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace imu_gps {
+
+/**
+ * Rolling rate and latency metrics of the fusion loop, exported periodically as JSON lines.
+ *
+ * The stages of a reading, from the reader to the published NavStated, record their durations into latency
+ * histograms (common::Timer::Histogram, lock-free), the filter counts the readings of every sensor and the pipeline
+ * stages report the depth of their output queue. Every export_interval_ seconds a thread writes one line with the
+ * metrics of the interval since the previous line:
+ *     {"time": <unix s>, "interval": <s>, "rate": {"imu": <1/s>, "odom": <1/s>, "gnss": <1/s>},
+ *      "sensor_time_rate": <x>, "latency_ms": {"read": {"count", "mean", "p50", "p99", "max"}, ...},
+ *      "queue_depth": {"parsed": {"last", "max"}, ...}}
+ * sensor_time_rate is the sensor time covered per wall-clock second, a live run falls behind real time when it stays
+ * below 1, and so does end_to_end latency grow. The lines go to a file, or to udp://ADDRESS:PORT as one datagram each.
+ *
+ * Each stage and each queue must be recorded from a single thread, the counters from any.
+ */
+class GinsTelemetry {
+   public:
+    enum class Stage {
+        READ,        // Parsing, time between two readings on the reader thread
+        CONVERT,     // ConvertGps2UTM of a GNSS reading
+        FILTER,      // GinsReplay processing of a reading (Predict/Observe)
+        OUTPUT,      // Writing a state to the trajectory file
+        UI,          // Handing a state to the UI
+        END_TO_END,  // From the arrival of a reading to its state published
+        NUM_STAGES
+    };
+    enum class Sensor { IMU, ODOM, GNSS, NUM_SENSORS };
+    enum class Queue { PARSED, CONVERTED, STATES, NUM_QUEUES };  // Queues of GinsPipeline
+
+    struct Options {
+        std::string sink_;              // File path, or udp://ADDRESS:PORT
+        double export_interval_ = 1.0;  // Seconds between two lines
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    explicit GinsTelemetry(Options options);
+    ~GinsTelemetry() { Stop(); }
+
+    GinsTelemetry(const GinsTelemetry&) = delete;
+    GinsTelemetry& operator=(const GinsTelemetry&) = delete;
+
+    /// Open the sink and start exporting, @return false if the sink cannot be opened
+    bool Start();
+
+    /// Export the last interval and stop
+    void Stop();
+
+    void Record(Stage stage, Clock::duration d) {
+        const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+        Hist(stage).Record(uint64_t(std::max<int64_t>(0, ns)));
+    }
+
+    /// Record the time since t1
+    void RecordSince(Stage stage, Clock::time_point t1) { Record(stage, Clock::now() - t1); }
+
+    /// Count a reading handed to the filter, with its sensor time
+    void CountReading(Sensor sensor, double sensor_time) {
+        counts_[int(sensor)].fetch_add(1, std::memory_order_relaxed);
+        sensor_time_.store(sensor_time, std::memory_order_relaxed);
+    }
+
+    void SetQueueDepth(Queue queue, size_t depth) {
+        QueueGauge& g = queues_[int(queue)];
+        g.last_.store(depth, std::memory_order_relaxed);
+        if (depth > g.max_.load(std::memory_order_relaxed)) {
+            g.max_.store(depth, std::memory_order_relaxed);
+        }
+    }
+
+    /// JSON line of the metrics since the previous call
+    std::string Snapshot();
+
+   private:
+    /// Cumulative counters of a histogram at the previous snapshot
+    struct HistState {
+        std::vector<uint64_t> buckets_ = std::vector<uint64_t>(common::Timer::Histogram::kNumBuckets, 0);
+        uint64_t count_ = 0;
+        uint64_t sum_ns_ = 0;
+    };
+
+    struct QueueGauge {
+        std::atomic<size_t> last_{0};
+        std::atomic<size_t> max_{0};  // Since the previous snapshot
+    };
+
+    common::Timer::Histogram& Hist(Stage stage) { return hists_[int(stage)]; }
+
+    void Export();
+    void Write(const std::string& line);
+
+    Options options_;
+    std::array<common::Timer::Histogram, int(Stage::NUM_STAGES)> hists_;
+    std::array<std::atomic<uint64_t>, int(Sensor::NUM_SENSORS)> counts_{};
+    std::array<QueueGauge, int(Queue::NUM_QUEUES)> queues_;
+    std::atomic<double> sensor_time_{0};
+
+    // previous snapshot, only touched by Snapshot()
+    std::array<HistState, int(Stage::NUM_STAGES)> prev_hists_;
+    std::array<uint64_t, int(Sensor::NUM_SENSORS)> prev_counts_{};
+    double prev_sensor_time_ = 0;
+    Clock::time_point prev_time_ = Clock::now();
+
+    FILE* fp_ = nullptr;
+    int fd_ = -1;  // UDP socket, connected to the sink
+    std::thread exporter_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+};
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_GINS_TELEMETRY_H
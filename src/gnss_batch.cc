@@ -0,0 +1,97 @@
+#include "gnss_batch.h"
+#include "common/math_utils.h"
+#include "utm_convert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <thread>
+
+namespace imu_gps {
+
+void GnssBatch::reserve(size_t n) {
+    unix_time_.reserve(n);
+    lat_.reserve(n);
+    lon_.reserve(n);
+    alt_.reserve(n);
+    heading_.reserve(n);
+    heading_valid_.reserve(n);
+}
+
+void GnssBatch::Add(const GNSS& gnss) {
+    unix_time_.emplace_back(gnss.unix_time_);
+    lat_.emplace_back(gnss.lat_lon_alt_[0]);
+    lon_.emplace_back(gnss.lat_lon_alt_[1]);
+    alt_.emplace_back(gnss.lat_lon_alt_[2]);
+    heading_.emplace_back(gnss.heading_);
+    heading_valid_.emplace_back(gnss.heading_valid_);
+}
+
+size_t ConvertGnssBatch(GnssBatch& batch, const Vec2d& antenna_pos, double antenna_angle, const Vec3d& map_origin,
+                        int num_threads) {
+    const size_t n = batch.size();
+    batch.x_.resize(n);
+    batch.y_.resize(n);
+    batch.z_.resize(n);
+    batch.yaw_.resize(n);
+    batch.valid_.resize(n);
+    batch.zone_.resize(n);
+
+    /// TGB, the same for every reading. TBG is a rotation about z, so TGB = (Rz(-angle), -Rz(-angle) * pos)
+    const SE3 TBG(SO3::rotZ(antenna_angle * math::kDEG2RAD), Vec3d(antenna_pos[0], antenna_pos[1], 0));
+    const SE3 TGB = TBG.inverse();
+    const double tgb_x = TGB.translation().x();
+    const double tgb_y = TGB.translation().y();
+    const double tgb_z = TGB.translation().z();
+    const double tgb_yaw = -antenna_angle * math::kDEG2RAD;
+
+    const UtmProjector projector;
+
+    // [begin, end) of the readings: UTM for the whole chunk, then the body transform over plain arrays
+    auto convert = [&](size_t begin, size_t end) {
+        const size_t m = end - begin;
+        std::unique_ptr<bool[]> ok(new bool[m]);
+        projector.Project(batch.lat_.data() + begin, batch.lon_.data() + begin, m, batch.x_.data() + begin,
+                          batch.y_.data() + begin, batch.zone_.data() + begin, nullptr, ok.get());
+        for (size_t i = 0; i < m; ++i) {
+            batch.valid_[begin + i] = ok[i];
+        }
+
+        for (size_t i = begin; i < end; ++i) {
+            /// heading: north-east-down to east-north-up, 0 if not valid
+            const double heading = batch.heading_valid_[i] ? (90 - batch.heading_[i]) * math::kDEG2RAD : 0;
+            const double c = std::cos(heading), s = std::sin(heading);
+
+            /// TWB = TWG * TGB, TWG = (Rz(heading), utm - origin)
+            const double gx = batch.x_[i] - map_origin[0];
+            const double gy = batch.y_[i] - map_origin[1];
+            const double gz = batch.alt_[i] - map_origin[2];
+            batch.x_[i] = gx + c * tgb_x - s * tgb_y;
+            batch.y_[i] = gy + s * tgb_x + c * tgb_y;
+            batch.z_[i] = gz + tgb_z;
+
+            // without a valid heading only the translation is kept, as in ConvertGps2UTM
+            batch.yaw_[i] = batch.heading_valid_[i] ? heading + tgb_yaw : 0;
+        }
+    };
+
+    if (num_threads <= 0) {
+        num_threads = std::max(1, int(std::thread::hardware_concurrency()));
+    }
+    constexpr size_t min_chunk = 4096;
+    const size_t num_chunks = std::max<size_t>(1, std::min<size_t>(num_threads, (n + min_chunk - 1) / min_chunk));
+    const size_t chunk = (n + num_chunks - 1) / num_chunks;
+
+    std::vector<std::thread> workers;
+    for (size_t begin = chunk; begin < n; begin += chunk) {
+        workers.emplace_back(convert, begin, std::min(n, begin + chunk));
+    }
+    convert(0, std::min(n, chunk));
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    return std::count(batch.valid_.begin(), batch.valid_.end(), 1);
+}
+
+}  // namespace imu_gps
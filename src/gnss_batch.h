@@ -0,0 +1,59 @@
+#ifndef IMU_GPS_GNSS_BATCH_H
+#define IMU_GPS_GNSS_BATCH_H
+
+#include "common/eigen_types.h"
+#include "common/gnss.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace imu_gps {
+
+/**
+ * GNSS readings stored as a structure of arrays, for offline conversion of whole logs.
+ *
+ * Fill it with Add (or directly through the input arrays), then call ConvertGnssBatch, which fills the output
+ * arrays with what ConvertGps2UTM would put into GNSS::utm_pose_ for every reading.
+ */
+struct GnssBatch {
+    // inputs, one entry per reading
+    std::vector<double> unix_time_;
+    std::vector<double> lat_;      // degrees
+    std::vector<double> lon_;      // degrees
+    std::vector<double> alt_;
+    std::vector<double> heading_;  // degrees, from the dual antenna
+    std::vector<uint8_t> heading_valid_;
+
+    // outputs of ConvertGnssBatch: the vehicle pose TWB in UTM, rotation only about z
+    std::vector<double> x_, y_, z_;
+    std::vector<double> yaw_;     // radians, 0 if the heading is not valid
+    std::vector<uint8_t> valid_;  // UTM conversion succeeded
+    std::vector<int> zone_;
+
+    size_t size() const { return unix_time_.size(); }
+
+    void reserve(size_t n);
+
+    void Add(const GNSS& gnss);
+
+    /// Converted pose of reading i, same as GNSS::utm_pose_ after ConvertGps2UTM
+    SE3 Pose(size_t i) const { return SE3(SO3::rotZ(yaw_[i]), Vec3d(x_[i], y_[i], z_[i])); }
+};
+
+/**
+ * Batch version of ConvertGps2UTM: lat/lon -> UTM -> antenna extrinsics -> body pose for every reading.
+ * The antenna transform TGB is computed once, the readings are split into contiguous chunks that are converted in
+ * parallel.
+ * @param batch readings, the output arrays are resized and filled
+ * @param antenna_pos Installation position
+ * @param antenna_angle Installation angle, degrees
+ * @param map_origin Subtracted from the UTM position
+ * @param num_threads worker threads, 0 = number of hardware threads
+ * @return number of valid readings
+ */
+size_t ConvertGnssBatch(GnssBatch& batch, const Vec2d& antenna_pos, double antenna_angle,
+                        const Vec3d& map_origin = Vec3d::Zero(), int num_threads = 0);
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_GNSS_BATCH_H
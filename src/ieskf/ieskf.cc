@@ -0,0 +1,204 @@
+#include "ieskf/ieskf.h"
+
+#include <glog/logging.h>
+
+namespace imu_gps {
+
+IESKF::IESKF(Options options) : options_(options) { BuildNoise(options); }
+
+void IESKF::SetInitialConditions(Options options, const Vec3d& init_bg, const Vec3d& init_ba,
+                                 const Vec3d& gravity) {
+    BuildNoise(options);
+    options_ = options;
+    x_.x_.bg_ = init_bg;
+    x_.x_.ba_ = init_ba;
+    x_.g_ = gravity;
+    cov_ = Mat18d::Identity() * 1e-4;
+}
+
+void IESKF::BuildNoise(const Options& options) {
+    // same as ESKF::BuildNoise, the IMU terms are discrete variances
+    const double ev = options.acce_var_, et = options.gyro_var_;
+    const double eg = options.bias_gyro_var_, ea = options.bias_acce_var_;
+    q_ << 0, 0, 0, ev, ev, ev, et, et, et, eg, eg, eg, ea, ea, ea, 0, 0, 0;
+
+    const double o2 = options.odom_var_ * options.odom_var_;
+    odom_noise_ = Vec3d(o2, o2, o2).asDiagonal();
+}
+
+bool IESKF::Predict(const IMU& imu) {
+    const double dt = imu.timestamp_ - x_.x_.timestamp_;
+    if (dt > (5 * options_.imu_dt_) || dt < 0) {
+        LOG(INFO) << "skip this imu because dt_ = " << dt;
+        x_.x_.timestamp_ = imu.timestamp_;
+        return false;
+    }
+
+    NavStated& x = x_.x_;
+    const Vec3d acce = imu.acce_ - x.ba_;
+    const SO3 dR = SO3::exp((imu.gyro_ - x.bg_) * dt);
+    const Vec3d acce_world = x.R_ * acce;
+    x.p_ += x.v_ * dt + 0.5 * (acce_world + x_.g_) * dt * dt;
+    x.v_ += (acce_world + x_.g_) * dt;
+    x.R_ = x.R_ * dR;
+
+    // F is the identity except for the blocks of ESKF::Predict:
+    //   F(p, v) = I * dt, F(v, theta) = A, F(v, ba) = B, F(v, g) = I * dt, F(theta, theta) = E, F(theta, bg) = -I * dt
+    const Mat3d B = -x.R_.matrix() * dt;
+    const Mat3d A = B * SO3::hat(acce);
+    const Mat3d E = dR.matrix().transpose();
+
+    // F * P changes the p, v, theta rows
+    constexpr int p = 0, v = 3, th = 6, bg = 9, ba = 12, g = 15;
+    auto row = [this](int i) { return cov_.block<3, 18>(i, 0); };
+    fp_rows_.block<3, 18>(p, 0) = row(p) + dt * row(v);
+    fp_rows_.block<3, 18>(v, 0) = row(v) + A.lazyProduct(row(th)) + B.lazyProduct(row(ba)) + dt * row(g);
+    fp_rows_.block<3, 18>(th, 0) = E.lazyProduct(row(th)) - dt * row(bg);
+    cov_.topRows<9>() = fp_rows_;
+
+    // (F * P) * F^T the same columns
+    auto col = [this](int i) { return cov_.block<18, 3>(0, i); };
+    fpf_cols_.block<18, 3>(0, p) = col(p) + dt * col(v);
+    fpf_cols_.block<18, 3>(0, v) =
+        col(v) + col(th).lazyProduct(A.transpose()) + col(ba).lazyProduct(B.transpose()) + dt * col(g);
+    fpf_cols_.block<18, 3>(0, th) = col(th).lazyProduct(E.transpose()) - dt * col(bg);
+    cov_.leftCols<9>() = fpf_cols_;
+
+    tmp_ = cov_.transpose();
+    cov_ = 0.5 * (cov_ + tmp_);
+    cov_.diagonal() += q_;
+
+    x_.x_.timestamp_ = imu.timestamp_;
+    return true;
+}
+
+template <int N, typename Model>
+bool IESKF::IteratedUpdate(Workspace<N>& ws, const Eigen::Matrix<double, N, N>& V, Model&& model,
+                           double gate_chi2) {
+    x_pred_ = x_;
+    const int max_iterations = std::max(1, options_.max_iterations_);
+
+    bool converged = false;
+    for (int iter = 0; iter < max_iterations && !converged; ++iter) {
+        // prior residual of the current estimate, zero in the first iteration
+        dx_prior_ = x_.BoxMinus(x_pred_);
+        model(x_, ws);
+
+        // The prior covariance is used as is for every linearization point, the change of the tangent space between
+        // x_pred_ and x_ (a Jacobian of theta close to I) is neglected, as usual for IESKF on short iterations.
+        ws.PHt_.noalias() = cov_ * ws.H_.transpose();
+        ws.S_.noalias() = ws.H_ * ws.PHt_;
+        ws.S_ += V;
+        ws.ldlt_.compute(ws.S_);
+        if (iter == 0 && gate_chi2 > 0 && ws.r_.dot(ws.ldlt_.solve(ws.r_)) > gate_chi2) {
+            return false;
+        }
+        ws.K_.transpose() = ws.ldlt_.solve(ws.PHt_.transpose());
+
+        // Gauss-Newton step: dx = K * (r + H * dx_prior) - dx_prior
+        ws.r_.noalias() += ws.H_ * dx_prior_;
+        dx_.noalias() = ws.K_ * ws.r_;
+        dx_ -= dx_prior_;
+        if (!options_.update_bias_gyro_) {
+            dx_.segment<3>(9).setZero();
+        }
+        if (!options_.update_bias_acce_) {
+            dx_.segment<3>(12).setZero();
+        }
+
+        x_ = x_.BoxPlus(dx_);
+        ++stats_.num_iterations_;
+        converged = dx_.norm() < options_.quit_eps_;
+    }
+
+    ++stats_.num_updates_;
+    if (converged) {
+        ++stats_.num_converged_;
+    }
+
+    // Joseph form with the last linearization, (I - K H) P (I - K H)^T + K V K^T
+    ikh_.setIdentity();
+    ikh_.noalias() -= ws.K_ * ws.H_;
+    tmp_.noalias() = ikh_ * cov_;
+    cov_.noalias() = tmp_ * ikh_.transpose();
+    cov_.noalias() += ws.K_ * V * ws.K_.transpose();
+
+    // Reset to the updated state, projection of ESKF::ProjectCov with the total rotation increment
+    const Vec3d dtheta = x_.BoxMinus(x_pred_).segment<3>(6);
+    const Mat3d G = Mat3d::Identity() - 0.5 * SO3::hat(dtheta);
+    // operator* evaluates into a temporary, the blocks are read and written in place
+    cov_.block<3, 18>(6, 0) = G * cov_.block<3, 18>(6, 0);
+    cov_.block<18, 3>(0, 6) = cov_.block<18, 3>(0, 6) * G.transpose();
+    tmp_ = cov_.transpose();
+    cov_ = 0.5 * (cov_ + tmp_);
+    return true;
+}
+
+bool IESKF::ObserveWheelSpeed(const Odom& odom) {
+    const double velo_l =
+        options_.wheel_radius_ * odom.left_pulse_ / options_.circle_pulse_ * 2 * M_PI / options_.odom_span_;
+    const double velo_r =
+        options_.wheel_radius_ * odom.right_pulse_ / options_.circle_pulse_ * 2 * M_PI / options_.odom_span_;
+    const Vec3d vel_odom(0.5 * (velo_l + velo_r), 0, 0);
+
+    // r = R * v_odom - v, H is I at v as in ESKF (the rotation is held fixed in the world velocity)
+    IteratedUpdate<3>(odom_ws_, odom_noise_, [&vel_odom](const NavStateManifold& x, Workspace<3>& ws) {
+        ws.r_ = x.x_.R_ * vel_odom - x.x_.v_;
+        ws.H_.setZero();
+        ws.H_.block<3, 3>(0, 3).setIdentity();
+    });
+    return true;
+}
+
+bool IESKF::ObserveGps(const GNSS& gnss) {
+    if (first_gnss_) {
+        x_.x_.R_ = gnss.utm_pose_.so3();
+        x_.x_.p_ = gnss.utm_pose_.translation();
+        first_gnss_ = false;
+        x_.x_.timestamp_ = gnss.unix_time_;
+        return true;
+    }
+
+    const double scale = options_.GnssNoiseScale(gnss.status_);
+    const bool updated = gnss.heading_valid_
+                             ? ObserveSE3(gnss.utm_pose_, scale * options_.gnss_pos_noise_,
+                                          scale * options_.gnss_ang_noise_, options_.gnss_gate_chi2_)
+                             : ObservePosition(gnss.utm_pose_.translation(), scale * options_.gnss_pos_noise_,
+                                               options_.GnssGateChi2(3));
+    x_.x_.timestamp_ = gnss.unix_time_;
+    return updated;
+}
+
+bool IESKF::ObserveSE3(const SE3& pose, double trans_noise, double ang_noise, double gate_chi2) {
+    Vec6d noise_vec;
+    noise_vec << trans_noise, trans_noise, trans_noise, ang_noise, ang_noise, ang_noise;
+    const Mat6d V = noise_vec.asDiagonal();
+
+    // r = [p_obs - p, Log(R^T R_obs)], H has I at p and the inverse left Jacobian of the rotation residual at theta
+    return IteratedUpdate<6>(
+        se3_ws_, V,
+        [&pose](const NavStateManifold& x, Workspace<6>& ws) {
+            ws.r_.head<3>() = pose.translation() - x.x_.p_;
+            ws.r_.tail<3>() = (x.x_.R_.inverse() * pose.so3()).log();
+            ws.H_.setZero();
+            ws.H_.block<3, 3>(0, 0).setIdentity();
+            ws.H_.block<3, 3>(3, 6) = math::SO3JacobianRightInv(Vec3d(-ws.r_.tail<3>()));
+        },
+        gate_chi2);
+}
+
+bool IESKF::ObservePosition(const Vec3d& pos, double trans_noise, double gate_chi2) {
+    const Mat3d V = Mat3d::Identity() * trans_noise;
+
+    // r = p_obs - p, H is I at p
+    return IteratedUpdate<3>(
+        pos_ws_, V,
+        [&pos](const NavStateManifold& x, Workspace<3>& ws) {
+            ws.r_ = pos - x.x_.p_;
+            ws.H_.setZero();
+            ws.H_.block<3, 3>(0, 0).setIdentity();
+        },
+        gate_chi2);
+}
+
+}  // namespace imu_gps
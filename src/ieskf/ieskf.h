@@ -0,0 +1,138 @@
+#ifndef IMU_GPS_IESKF_H
+#define IMU_GPS_IESKF_H
+
+#include "common/eigen_types.h"
+#include "common/gnss.h"
+#include "common/imu.h"
+#include "common/math_utils.h"
+#include "common/nav_state.h"
+#include "common/odom.h"
+#include "eskf_option.hpp"
+#include "ieskf/nav_state_manifold.h"
+
+namespace imu_gps {
+
+/**
+ * Iterated error-state Kalman filter.
+ *
+ * Same state, prediction and noise model as ESKF<double>, but every observation is a Gauss-Newton solve: the
+ * measurement is re-linearized at the updated state until the increment norm drops below quit_eps_, at most
+ * max_iterations_ times (see ESKFOptions). The Jacobians, gains and products of all steps live in preallocated
+ * members, so Predict and the observations do no allocation and an update costs at most max_iterations_ solves.
+ *
+ * Has the interface of ESKF, so it can be used as the Filter of GinsReplay and GinsPipeline.
+ */
+class IESKF {
+   public:
+    using NavStateT = NavStated;
+    using Options = ESKFOptions;
+    using CovT = Mat18d;
+
+    /// Counters of the iterated updates
+    struct Stats {
+        size_t num_updates_ = 0;     // Observations
+        size_t num_iterations_ = 0;  // Linearizations over all observations
+        size_t num_converged_ = 0;   // Observations that converged before the iteration cap
+    };
+
+    explicit IESKF(Options options = Options());
+
+    /// Set initial conditions, see ESKF::SetInitialConditions
+    void SetInitialConditions(Options options, const Vec3d& init_bg, const Vec3d& init_ba,
+                              const Vec3d& gravity = Vec3d(0, 0, -9.8));
+
+    /// Replace the options of a running filter, see ESKF::SetOptions
+    void SetOptions(const Options& options) {
+        BuildNoise(options);
+        options_ = options;
+    }
+
+    /// Propagate using IMU measurements
+    bool Predict(const IMU& imu);
+
+    /// Observe wheel speed measurements
+    bool ObserveWheelSpeed(const Odom& odom);
+
+    /// Observe GPS measurements, noise scaling, gate and position-only fixes as in ESKF::ObserveGps
+    bool ObserveGps(const GNSS& gnss);
+
+    /// Observe an SE3 pose, noise and gate as in ESKF::ObserveSE3
+    bool ObserveSE3(const SE3& pose, double trans_noise = 0.1, double ang_noise = 1.0 * math::kDEG2RAD,
+                    double gate_chi2 = 0);
+
+    /// Observe a position only, see ESKF::ObservePosition
+    bool ObservePosition(const Vec3d& pos, double trans_noise = 0.1, double gate_chi2 = 0);
+
+    NavStated GetNominalState() const { return x_.x_; }
+    SE3 GetNominalSE3() const { return x_.x_.GetSE3(); }
+
+    void SetX(const NavStated& x, const Vec3d& grav) { x_ = NavStateManifold(x, grav); }
+    void SetCov(const Mat18d& cov) { cov_ = cov; }
+    const Mat18d& GetCov() const { return cov_; }
+    Vec3d GetGravity() const { return x_.g_; }
+
+    /// Resume from a saved state, see ESKF::Restore
+    void Restore(const NavStated& x, const Vec3d& grav, const Mat18d& cov) {
+        SetX(x, grav);
+        SetCov(cov);
+        first_gnss_ = false;
+    }
+
+    const Stats& GetStats() const { return stats_; }
+
+   private:
+    /// Workspace of an N-dimensional observation
+    template <int N>
+    struct Workspace {
+        Eigen::Matrix<double, N, 1> r_;    // Residual at the linearization point
+        Eigen::Matrix<double, N, 18> H_;   // Jacobian, r(x ⊞ dx) = r - H * dx
+        Eigen::Matrix<double, 18, N> PHt_;
+        Eigen::Matrix<double, N, N> S_;    // Innovation covariance
+        Eigen::LDLT<Eigen::Matrix<double, N, N>> ldlt_;
+        Eigen::Matrix<double, 18, N> K_;
+    };
+
+    void BuildNoise(const Options& options);
+
+    /**
+     * Iterated update.
+     * @param ws workspace of the observation
+     * @param V observation noise
+     * @param model fills ws.r_ and ws.H_ at the given state
+     * @param gate_chi2 if > 0, reject the observation if r^T S^-1 r at the prior is above it, before any gain
+     * @return false if rejected, the state and covariance are then unchanged
+     */
+    template <int N, typename Model>
+    bool IteratedUpdate(Workspace<N>& ws, const Eigen::Matrix<double, N, N>& V, Model&& model,
+                        double gate_chi2 = 0);
+
+    NavStateManifold x_;  // The timestamp_ of its NavState is the filter time
+    Mat18d cov_ = Mat18d::Identity();
+
+    /// Noise
+    Vec18d q_ = Vec18d::Zero();  // Diagonal of the process noise
+    Mat3d odom_noise_ = Mat3d::Zero();
+
+    /// Predict workspace: the p, v, theta rows of F * P, and the p, v, theta columns of F * P * F^T
+    Eigen::Matrix<double, 9, 18> fp_rows_;
+    Eigen::Matrix<double, 18, 9> fpf_cols_;
+
+    /// Update workspace
+    NavStateManifold x_pred_;  // State before the update, the prior of every iteration
+    Vec18d dx_prior_ = Vec18d::Zero();
+    Vec18d dx_ = Vec18d::Zero();
+    Mat18d ikh_ = Mat18d::Identity();
+    Mat18d tmp_ = Mat18d::Zero();
+    Workspace<3> odom_ws_;
+    Workspace<3> pos_ws_;
+    Workspace<6> se3_ws_;
+
+    bool first_gnss_ = true;
+
+    Options options_;
+    Stats stats_;
+};
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_IESKF_H
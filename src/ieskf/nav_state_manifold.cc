@@ -0,0 +1,27 @@
+#include "ieskf/nav_state_manifold.h"
+
+namespace imu_gps {
+
+NavStateManifold NavStateManifold::BoxPlus(const Vec18d& dx) const {
+    NavStateManifold result = *this;
+    result.x_.p_ += dx.segment<3>(0);
+    result.x_.v_ += dx.segment<3>(3);
+    result.x_.R_ = x_.R_ * SO3::exp(dx.segment<3>(6));
+    result.x_.bg_ += dx.segment<3>(9);
+    result.x_.ba_ += dx.segment<3>(12);
+    result.g_ += dx.segment<3>(15);
+    return result;
+}
+
+Vec18d NavStateManifold::BoxMinus(const NavStateManifold& other) const {
+    Vec18d dx;
+    dx.segment<3>(0) = x_.p_ - other.x_.p_;
+    dx.segment<3>(3) = x_.v_ - other.x_.v_;
+    dx.segment<3>(6) = (other.x_.R_.inverse() * x_.R_).log();
+    dx.segment<3>(9) = x_.bg_ - other.x_.bg_;
+    dx.segment<3>(12) = x_.ba_ - other.x_.ba_;
+    dx.segment<3>(15) = g_ - other.g_;
+    return dx;
+}
+
+}  // namespace imu_gps
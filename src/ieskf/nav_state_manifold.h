@@ -0,0 +1,29 @@
+#ifndef IMU_GPS_NAV_STATE_MANIFOLD_H
+#define IMU_GPS_NAV_STATE_MANIFOLD_H
+
+#include "common/eigen_types.h"
+#include "common/nav_state.h"
+
+namespace imu_gps {
+
+/**
+ * The 18-dimensional state of the iterated ESKF: a NavState and the gravity, seen as a manifold.
+ * Error-state order as in ESKF: p, v, theta, bg, ba, grav, with the rotation perturbed on the right (R * Exp(theta)).
+ */
+struct NavStateManifold {
+    NavStateManifold() = default;
+    NavStateManifold(const NavStated& x, const Vec3d& grav) : x_(x), g_(grav) {}
+
+    /// x ⊞ dx
+    NavStateManifold BoxPlus(const Vec18d& dx) const;
+
+    /// x ⊟ other, the error state that moves other to x
+    Vec18d BoxMinus(const NavStateManifold& other) const;
+
+    NavStated x_;
+    Vec3d g_ = Vec3d(0, 0, -9.8);
+};
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_NAV_STATE_MANIFOLD_H
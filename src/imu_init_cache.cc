@@ -0,0 +1,103 @@
+#include "imu_init_cache.h"
+
+#include <glog/logging.h>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace imu_gps {
+
+namespace {
+
+bool ValidDevice(const std::string& device) {
+    return !device.empty() && device[0] != '#' && device.find_first_of(" \t\r\n") == std::string::npos;
+}
+
+/// Device id of a cache line, empty for comments and blank lines
+std::string LineDevice(const std::string& line) {
+    std::istringstream ss(line);
+    std::string device;
+    ss >> device;
+    return device.empty() || device[0] == '#' ? std::string() : device;
+}
+
+}  // namespace
+
+bool LoadIMUInitCache(const std::string& cache_path, const std::string& device, StaticIMUInit::Result& result) {
+    std::ifstream fin(cache_path);
+    if (!ValidDevice(device) || !fin) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(fin, line)) {
+        if (LineDevice(line) != device) {
+            continue;
+        }
+
+        std::istringstream ss(line);
+        std::string name;
+        ss >> name;
+        StaticIMUInit::Result r;
+        for (Vec3d* v : {&r.init_bg_, &r.init_ba_, &r.gravity_, &r.cov_gyro_, &r.cov_acce_}) {
+            ss >> (*v)[0] >> (*v)[1] >> (*v)[2];
+        }
+        if (!ss || r.gravity_.norm() < 1.0) {
+            LOG(ERROR) << "Invalid IMU init cache line for " << device << " in " << cache_path;
+            return false;
+        }
+
+        result = r;
+        return true;
+    }
+    return false;
+}
+
+bool SaveIMUInitCache(const std::string& cache_path, const std::string& device, const StaticIMUInit::Result& result) {
+    if (!ValidDevice(device)) {
+        LOG(ERROR) << "Invalid IMU device id: '" << device << "'";
+        return false;
+    }
+
+    // the lines of the other devices
+    std::vector<std::string> lines;
+    {
+        std::ifstream fin(cache_path);
+        std::string line;
+        while (std::getline(fin, line)) {
+            if (LineDevice(line) != device) {
+                lines.emplace_back(line);
+            }
+        }
+    }
+
+    std::ostringstream ss;
+    ss << device << std::setprecision(17);
+    for (const Vec3d* v : {&result.init_bg_, &result.init_ba_, &result.gravity_, &result.cov_gyro_, &result.cov_acce_}) {
+        ss << " " << (*v)[0] << " " << (*v)[1] << " " << (*v)[2];
+    }
+    lines.emplace_back(ss.str());
+
+    const std::string tmp_path = cache_path + ".tmp";
+    {
+        std::ofstream fout(tmp_path, std::ios::trunc);
+        for (const auto& line : lines) {
+            fout << line << "\n";
+        }
+        if (!fout.flush()) {
+            LOG(ERROR) << "Failed to write file: " << tmp_path;
+            return false;
+        }
+    }
+
+    if (std::rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+        LOG(ERROR) << "Failed to replace file: " << cache_path;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace imu_gps
@@ -0,0 +1,33 @@
+#ifndef IMU_GPS_IMU_INIT_CACHE_H
+#define IMU_GPS_IMU_INIT_CACHE_H
+
+#include "static_imu_init.h"
+
+#include <string>
+
+namespace imu_gps {
+
+/**
+ * Cache of the StaticIMUInit results of each device, so that the next run of a device can start its filter at once
+ * from them instead of waiting for the vehicle to stand still (GinsReplay::StartFromPriors).
+ *
+ * A text file with one line per device:
+ *     <device> bg(3) ba(3) gravity(3) cov_gyro(3) cov_acce(3)
+ * Lines starting with # are ignored. Device ids cannot contain whitespace.
+ */
+
+/**
+ * Load the cached results of a device
+ * @return false if the file is missing or has no valid line for the device
+ */
+bool LoadIMUInitCache(const std::string& cache_path, const std::string& device, StaticIMUInit::Result& result);
+
+/**
+ * Store the results of a device, replacing its previous line and keeping those of the other devices.
+ * The file is rewritten through a temporary file, an interrupted save leaves the previous cache.
+ */
+bool SaveIMUInitCache(const std::string& cache_path, const std::string& device, const StaticIMUInit::Result& result);
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_IMU_INIT_CACHE_H
@@ -3,8 +3,13 @@
 
 #include "common/eigen_types.h"
 #include "common/imu.h"
+#include "common/math_utils.h"
 #include "common/nav_state.h"
 
+#include <algorithm>
+#include <thread>
+#include <vector>
+
 namespace imu_gps {
 
 /**
@@ -31,6 +36,114 @@ class IMUIntegration {
         timestamp_ = imu.timestamp_;
     }
 
+    /// AddIMU of n consecutive readings, with the rotation increments computed in one batch
+    void AddIMUs(const IMU* imus, size_t n) {
+        for (auto& v : w_) {
+            v.resize(n);
+        }
+        for (auto& v : dq_) {
+            v.resize(n);
+        }
+
+        double t = timestamp_;
+        for (size_t i = 0; i < n; ++i) {
+            const double dt = imus[i].timestamp_ - t;
+            const Vec3d w = (dt > 0 && dt < 0.1) ? Vec3d((imus[i].gyro_ - bg_) * dt) : Vec3d::Zero();
+            w_[0][i] = w[0];
+            w_[1][i] = w[1];
+            w_[2][i] = w[2];
+            t = imus[i].timestamp_;
+        }
+        math::SO3ExpBatch(n, w_[0].data(), w_[1].data(), w_[2].data(), dq_[0].data(), dq_[1].data(), dq_[2].data(),
+                          dq_[3].data());
+
+        for (size_t i = 0; i < n; ++i) {
+            const IMU& imu = imus[i];
+            double dt = imu.timestamp_ - timestamp_;
+            if (dt > 0 && dt < 0.1) {
+                p_ = p_ + (v_ * dt) +
+                     (0.5 * (R_ * (imu.acce_ - ba_) + gravity_) * dt * dt);
+                v_ = v_ + (R_ * (imu.acce_ - ba_) * dt) + (gravity_ * dt);
+                R_ = R_ * SO3(Quatd(dq_[0][i], dq_[1][i], dq_[2][i], dq_[3][i]));
+            }
+            timestamp_ = imu.timestamp_;
+        }
+    }
+
+    /**
+     * AddIMU of n consecutive readings, integrated in segments on num_threads threads. If states is not null,
+     * states[i] is set to the state after imus[i].
+     *
+     * Every segment is first integrated from the identity without gravity, which gives its motion relative to its
+     * start state: dR, dv, dp over the integrated time dt. The start states then follow from a scan over the
+     * segments, and the per-sample states from composing the relative ones onto them:
+     *   R = R0 * dR, v = v0 + g * dt + R0 * dv, p = p0 + v0 * dt + 0.5 * g * dt^2 + R0 * dp
+     * This is the discretization of AddIMU, so the result matches the serial integration up to rounding.
+     */
+    void AddIMUsParallel(const IMU* imus, size_t n, int num_threads, NavStated* states = nullptr) {
+        constexpr size_t kMinSegmentSize = 4096;
+        const size_t num_segments = std::clamp<size_t>(n / kMinSegmentSize, 1, std::max(1, num_threads));
+        if (num_segments == 1) {
+            for (size_t i = 0; i < n; ++i) {
+                AddIMU(imus[i]);
+                if (states != nullptr) {
+                    states[i] = GetNavState();
+                }
+            }
+            return;
+        }
+
+        auto begin = [&](size_t s) { return n * s / num_segments; };
+        auto parallel = [num_segments](auto&& f) {
+            std::vector<std::thread> workers;
+            for (size_t s = 0; s < num_segments; ++s) {
+                workers.emplace_back(f, s);
+            }
+            for (auto& w : workers) {
+                w.join();
+            }
+        };
+
+        // relative motion of every segment, and of every sample within its segment
+        std::vector<IMUIntegration> deltas(num_segments, IMUIntegration(Vec3d::Zero(), bg_, ba_));
+        std::vector<double> elapsed(states != nullptr ? n : 0);
+        parallel([&](size_t s) {
+            IMUIntegration& local = deltas[s];
+            local.timestamp_ = s == 0 ? timestamp_ : imus[begin(s) - 1].timestamp_;
+            for (size_t i = begin(s); i < begin(s + 1); ++i) {
+                // the intervals AddIMU integrates
+                const double dt = imus[i].timestamp_ - local.timestamp_;
+                if (dt > 0 && dt < 0.1) {
+                    local.elapsed_ += dt;
+                }
+                local.AddIMU(imus[i]);
+                if (states != nullptr) {
+                    states[i] = local.GetNavState();
+                    elapsed[i] = local.elapsed_;
+                }
+            }
+        });
+
+        // start state of every segment, then the state at the end
+        std::vector<NavStated> starts(num_segments + 1, GetNavState());
+        for (size_t s = 0; s < num_segments; ++s) {
+            starts[s + 1] = Compose(starts[s], deltas[s].GetNavState(), deltas[s].elapsed_);
+        }
+
+        if (states != nullptr) {
+            parallel([&](size_t s) {
+                for (size_t i = begin(s); i < begin(s + 1); ++i) {
+                    states[i] = Compose(starts[s], states[i], elapsed[i]);
+                }
+            });
+        }
+
+        timestamp_ = starts.back().timestamp_;
+        R_ = starts.back().R_;
+        v_ = starts.back().v_;
+        p_ = starts.back().p_;
+    }
+
     NavStated GetNavState() const {
         return NavStated(timestamp_, R_, p_, v_, bg_, ba_);
     }
@@ -40,6 +153,13 @@ class IMUIntegration {
     Vec3d GetP() const { return p_; }
 
    private:
+    /// State after start followed by the relative motion delta over the integrated time dt, at the time of delta
+    NavStated Compose(const NavStated& start, const NavStated& delta, double dt) const {
+        return NavStated(delta.timestamp_, start.R_ * delta.R_,
+                         start.p_ + start.v_ * dt + 0.5 * gravity_ * dt * dt + start.R_ * delta.p_,
+                         start.v_ + gravity_ * dt + start.R_ * delta.v_, bg_, ba_);
+    }
+
     SO3 R_;
     Vec3d v_ = Vec3d::Zero();
     Vec3d p_ = Vec3d::Zero();
@@ -48,6 +168,11 @@ class IMUIntegration {
     Vec3d gravity_ = Vec3d(0, 0, -9.8);
 
     double timestamp_ = 0.0;
+    double elapsed_ = 0.0;  // Integrated time of the relative motions of AddIMUsParallel
+
+    // Scratch of AddIMUs: rotation increments and their quaternions (w, x, y, z), one array per component
+    std::vector<double> w_[3];
+    std::vector<double> dq_[4];
 };
 
 }  // namespace imu_gps
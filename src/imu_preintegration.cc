@@ -0,0 +1,69 @@
+#include "imu_preintegration.h"
+#include "common/math_utils.h"
+
+namespace imu_gps {
+
+IMUPreintegration::IMUPreintegration(Options options) : bg_(options.init_bg_), ba_(options.init_ba_) {
+    noise_gyro_acce_.diagonal() << options.gyro_var_, options.gyro_var_, options.gyro_var_, options.acce_var_,
+        options.acce_var_, options.acce_var_;
+}
+
+void IMUPreintegration::Integrate(const IMU& imu, double dt) {
+    const Vec3d gyr = imu.gyro_ - bg_;
+    const Vec3d acc = imu.acce_ - ba_;
+    const Mat3d dR = dR_.matrix();
+    const Mat3d acc_hat = math::SKEW_SYM_MATRIX(acc);
+    const double dt2 = dt * dt;
+
+    // Bias Jacobians, they use the increments before this reading
+    dP_dba_ = dP_dba_ + dV_dba_ * dt - 0.5 * dR * dt2;
+    dP_dbg_ = dP_dbg_ + dV_dbg_ * dt - 0.5 * dR * acc_hat * dR_dbg_ * dt2;
+    dV_dba_ = dV_dba_ - dR * dt;
+    dV_dbg_ = dV_dbg_ - dR * acc_hat * dR_dbg_ * dt;
+
+    dp_ = dp_ + dv_ * dt + 0.5 * dR * acc * dt2;
+    dv_ = dv_ + dR * acc * dt;
+
+    const Vec3d omega = gyr * dt;
+    const SO3 delta = SO3::exp(omega);
+    const Mat3d delta_inv = delta.matrix().transpose();
+    const Mat3d jr = math::SO3JacobianRight(omega);
+
+    // Covariance propagation of (dR, dv, dp), the noise enters rotation and velocity once per reading like in ESKF
+    Mat9d A = Mat9d::Identity();
+    A.block<3, 3>(0, 0) = delta_inv;
+    A.block<3, 3>(3, 0) = -dR * acc_hat * dt;
+    A.block<3, 3>(6, 0) = -0.5 * dR * acc_hat * dt2;
+    A.block<3, 3>(6, 3) = Mat3d::Identity() * dt;
+
+    Mat96d B = Mat96d::Zero();
+    B.block<3, 3>(0, 0) = Mat3d::Identity();
+    B.block<3, 3>(3, 3) = dR;
+    B.block<3, 3>(6, 3) = 0.5 * dR * dt;
+
+    cov_ = A * cov_ * A.transpose() + B * noise_gyro_acce_ * B.transpose();
+
+    dR_dbg_ = delta_inv * dR_dbg_ - jr * dt;
+    dR_ = dR_ * delta;
+    dt_ += dt;
+}
+
+NavStated IMUPreintegration::Predict(const NavStated& start, const Vec3d& grav) const {
+    const SO3 R = start.R_ * GetDeltaRotation(start.bg_);
+    const Vec3d v = start.R_ * GetDeltaVelocity(start.bg_, start.ba_) + start.v_ + grav * dt_;
+    const Vec3d p =
+        start.R_ * GetDeltaPosition(start.bg_, start.ba_) + start.p_ + start.v_ * dt_ + 0.5 * grav * dt_ * dt_;
+    return NavStated(start.timestamp_ + dt_, R, p, v, start.bg_, start.ba_);
+}
+
+SO3 IMUPreintegration::GetDeltaRotation(const Vec3d& bg) const { return dR_ * SO3::exp(dR_dbg_ * (bg - bg_)); }
+
+Vec3d IMUPreintegration::GetDeltaVelocity(const Vec3d& bg, const Vec3d& ba) const {
+    return dv_ + dV_dbg_ * (bg - bg_) + dV_dba_ * (ba - ba_);
+}
+
+Vec3d IMUPreintegration::GetDeltaPosition(const Vec3d& bg, const Vec3d& ba) const {
+    return dp_ + dP_dbg_ * (bg - bg_) + dP_dba_ * (ba - ba_);
+}
+
+}  // namespace imu_gps
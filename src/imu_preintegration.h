@@ -0,0 +1,66 @@
+#ifndef IMU_GPS_IMU_PREINTEGRATION_H
+#define IMU_GPS_IMU_PREINTEGRATION_H
+
+#include "common/eigen_types.h"
+#include "common/imu.h"
+#include "common/nav_state.h"
+
+namespace imu_gps {
+
+/**
+ * IMU pre-integration between two keyframes (Forster et al., On-Manifold Preintegration).
+ *
+ * Accumulates the rotation, velocity and position increments in the body frame of the first keyframe, independent of
+ * its pose, together with their covariance and their Jacobians w.r.t. the biases. A later change of the bias estimate
+ * is applied to the increments to first order, so the readings never have to be integrated again.
+ *
+ * The noise terms are the discrete per-reading variances of ESKFOptions, so the factor weighs the readings like the
+ * filter does.
+ */
+class IMUPreintegration {
+   public:
+    struct Options {
+        Options() {}
+        Vec3d init_bg_ = Vec3d::Zero();  // Biases the readings are integrated with
+        Vec3d init_ba_ = Vec3d::Zero();
+        double gyro_var_ = 1e-5;  // Rotation noise variance per reading, as ESKFOptions::gyro_var_
+        double acce_var_ = 1e-2;  // Velocity noise variance per reading, as ESKFOptions::acce_var_
+    };
+
+    explicit IMUPreintegration(Options options = Options());
+
+    /// Integrate one reading over dt
+    void Integrate(const IMU& imu, double dt);
+
+    /// State at the end of the interval from the state at its start, with the increments corrected to its biases
+    NavStated Predict(const NavStated& start, const Vec3d& grav) const;
+
+    /// Increments corrected to the given biases
+    SO3 GetDeltaRotation(const Vec3d& bg) const;
+    Vec3d GetDeltaVelocity(const Vec3d& bg, const Vec3d& ba) const;
+    Vec3d GetDeltaPosition(const Vec3d& bg, const Vec3d& ba) const;
+
+    double dt_ = 0;              // Integrated time
+    Mat9d cov_ = Mat9d::Zero();  // Covariance of (dR, dv, dp)
+
+    Vec3d bg_ = Vec3d::Zero();
+    Vec3d ba_ = Vec3d::Zero();
+
+    SO3 dR_;
+    Vec3d dv_ = Vec3d::Zero();
+    Vec3d dp_ = Vec3d::Zero();
+
+    // Jacobians of the increments w.r.t. the biases
+    Mat3d dR_dbg_ = Mat3d::Zero();
+    Mat3d dV_dbg_ = Mat3d::Zero();
+    Mat3d dV_dba_ = Mat3d::Zero();
+    Mat3d dP_dbg_ = Mat3d::Zero();
+    Mat3d dP_dba_ = Mat3d::Zero();
+
+   private:
+    Mat6d noise_gyro_acce_ = Mat6d::Zero();
+};
+
+}  // namespace imu_gps
+
+#endif  // IMU_GPS_IMU_PREINTEGRATION_H
@@ -1,10 +1,12 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
-#include <iomanip>
 #include <memory>
 
 #include "common/gnss.h"
 #include "common/io_utils.h"
+#include "common/replay_pacer.h"
+#include "common/traj_writer.h"
+#include "gnss_batch.h"
 #include "tools/ui/pangolin_window.h"
 #include "utm_convert.h"
 
@@ -16,6 +18,14 @@ DEFINE_double(antenna_angle, 12.06,
 DEFINE_double(antenna_pox_x, -0.17, "RTK antenna installation offset in X");
 DEFINE_double(antenna_pox_y, -0.20, "RTK antenna installation offset in Y");
 DEFINE_bool(with_ui, true, "Whether to display the graphical interface");
+DEFINE_double(replay_speed, 100.0,
+              "Replay speed relative to the sensor timestamps: 1 = real time, "
+              "N = N times real time, 0 = as fast as possible");
+DEFINE_bool(binary_output, false,
+            "Write the trajectory as raw doubles (.bin) instead of text (.txt)");
+DEFINE_bool(batch, false,
+            "Offline mode: load all GNSS readings first and convert them in one parallel batch (no pacing)");
+DEFINE_int32(num_threads, 0, "Worker threads of the batch mode, 0 = number of hardware threads");
 
 /**
  * This program demonstrates how to process GNSS data.
@@ -38,50 +48,56 @@ int main(int argc, char** argv) {
 
     imu_gps::TxtIO io(fLS::FLAGS_txt_path);
 
-    std::ofstream fout("../data/gnss_output.txt");
+    imu_gps::TrajectoryWriter fout(FLAGS_binary_output ? "../data/gnss_output.bin" : "../data/gnss_output.txt",
+                                   FLAGS_binary_output ? imu_gps::TrajectoryWriter::Format::BINARY
+                                                       : imu_gps::TrajectoryWriter::Format::TEXT);
     Vec2d antenna_pos(FLAGS_antenna_pox_x, FLAGS_antenna_pox_y);
 
-    auto save_result = [](std::ofstream& fout, double timestamp,
-                          const SE3& pose) {
-        auto save_vec3 = [](std::ofstream& fout, const Vec3d& v) {
-            fout << v[0] << " " << v[1] << " " << v[2] << " ";
-        };
-        auto save_quat = [](std::ofstream& fout, const Quatd& q) {
-            fout << q.w() << " " << q.x() << " " << q.y() << " " << q.z()
-                 << " ";
-        };
-
-        fout << std::setprecision(18) << timestamp << " "
-             << std::setprecision(9);
-        save_vec3(fout, pose.translation());
-        save_quat(fout, pose.unit_quaternion());
-        fout << std::endl;
-    };
-
     std::shared_ptr<imu_gps::ui::PangolinWindow> ui = nullptr;
     if (FLAGS_with_ui) {
         ui = std::make_shared<imu_gps::ui::PangolinWindow>();
         ui->Init();
     }
 
+    // Poses are written relative to the first converted reading
     bool first_gnss_set = false;
     Vec3d origin = Vec3d::Zero();
-    io.SetGNSSProcessFunc([&](const imu_gps::GNSS& gnss) {
-          imu_gps::GNSS gnss_out = gnss;
-          if (imu_gps::ConvertGps2UTM(gnss_out, antenna_pos, FLAGS_antenna_angle)) {
-              if (!first_gnss_set) {
-                  origin = gnss_out.utm_pose_.translation();
-                  first_gnss_set = true;
-              }
+    auto publish = [&](double timestamp, SE3 pose) {
+        if (!first_gnss_set) {
+            origin = pose.translation();
+            first_gnss_set = true;
+        }
+
+        pose.translation() -= origin;
+        fout.Write(timestamp, pose);
+        if (ui) {
+            ui->UpdateNavState(imu_gps::NavStated(timestamp, pose.so3(), pose.translation()));
+        }
+    };
+
+    if (FLAGS_batch) {
+        imu_gps::GnssBatch batch;
+        io.SetGNSSProcessFunc([&batch](const imu_gps::GNSS& gnss) { batch.Add(gnss); }).Go();
+        size_t num_valid =
+            imu_gps::ConvertGnssBatch(batch, antenna_pos, FLAGS_antenna_angle, Vec3d::Zero(), FLAGS_num_threads);
+        LOG(INFO) << "converted " << num_valid << " of " << batch.size() << " GNSS readings";
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (batch.valid_[i]) {
+                publish(batch.unix_time_[i], batch.Pose(i));
+            }
+        }
+    } else {
+        imu_gps::ReplayPacer pacer(FLAGS_replay_speed);
+        io.SetGNSSProcessFunc([&](const imu_gps::GNSS& gnss) {
+              pacer.WaitUntil(gnss.unix_time_);
 
-              gnss_out.utm_pose_.translation() -= origin;
-              save_result(fout, gnss_out.unix_time_, gnss_out.utm_pose_);
-              ui->UpdateNavState(
-                  imu_gps::NavStated(gnss_out.unix_time_, gnss_out.utm_pose_.so3(),
-                                 gnss_out.utm_pose_.translation()));
-              usleep(1e3);
-          }
-      }).Go();
+              imu_gps::GNSS gnss_out = gnss;
+              if (imu_gps::ConvertGps2UTM(gnss_out, antenna_pos, FLAGS_antenna_angle)) {
+                  publish(gnss_out.unix_time_, gnss_out.utm_pose_);
+              }
+          }).Go();
+    }
 
     if (ui) {
         while (!ui->ShouldQuit()) {
@@ -0,0 +1,211 @@
+#include "batch_manifest.h"
+#include "common/global_flags.h"
+#include "common/io_utils.h"
+#include "common/traj_writer.h"
+#include "gins_bank_replay.h"
+#include "gins_replay.h"
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <thread>
+
+DEFINE_string(manifest, "../data/batch_manifest.txt", "Batch manifest, one run per line: <log> <output> [name] [key=value ...]");
+DEFINE_int32(num_threads, 0, "Number of worker threads, 0 = number of hardware threads");
+DEFINE_string(summary_path, "../data/batch_summary.txt", "Summary table output path");
+DEFINE_bool(bank, false, "Replay the option variants of one log in lockstep on an ESKFBank");
+
+/**
+ * This program replays many logs / option variants of the RTK+IMU integrated navigation in parallel.
+ * Every run owns its own initializer and filter, and runs are distributed over a pool of worker threads.
+ * Each run writes its trajectory in the same format as run_eskf_gins, and a summary table is written at the end.
+ * With --bank, the runs of one log that only differ in their filter options are replayed together on an ESKFBank,
+ * so the log is parsed and the GNSS is converted once for all of them.
+ */
+
+namespace {
+
+struct RunResult {
+    bool ok_ = false;
+    double wall_time_ = 0;
+    imu_gps::GinsReplayStats stats_;
+    imu_gps::NavStated final_state_;
+};
+
+RunResult RunOne(const imu_gps::BatchRunSpec& spec) {
+    RunResult result;
+    auto t1 = std::chrono::steady_clock::now();
+
+    imu_gps::TrajectoryWriter fout(spec.output_path_);
+    if (!fout.IsOpen()) {
+        return result;
+    }
+
+    imu_gps::GinsReplay<> replay(spec.options_);
+    replay.SetStateCallback([&fout, &result](const imu_gps::NavStated& s) {
+        fout.Write(s);
+        result.final_state_ = s;
+    });
+
+    imu_gps::TxtIO io(spec.log_path_);
+    io.SetIMUProcessFunc([&replay](const imu_gps::IMU& imu) { replay.AddIMU(imu); })
+        .SetGNSSProcessFunc([&replay](const imu_gps::GNSS& gnss) { replay.AddGNSS(gnss); })
+        .SetOdomProcessFunc([&replay](const imu_gps::Odom& odom) { replay.AddOdom(odom); })
+        .Go();
+
+    result.ok_ = replay.Running() && !imu_gps::global::FLAG_EXIT;
+    result.stats_ = replay.GetStats();
+    result.wall_time_ =
+        std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - t1).count();
+    return result;
+}
+
+/// Replay runs[indices] on one GinsBankReplay, see GroupRuns for what they have in common
+void RunBank(const std::vector<imu_gps::BatchRunSpec>& runs, const std::vector<size_t>& indices,
+             std::vector<RunResult>& results) {
+    auto t1 = std::chrono::steady_clock::now();
+
+    std::vector<imu_gps::GinsReplayOptions> options;
+    std::vector<std::unique_ptr<imu_gps::TrajectoryWriter>> fouts;
+    for (size_t idx : indices) {
+        options.emplace_back(runs[idx].options_);
+        fouts.emplace_back(std::make_unique<imu_gps::TrajectoryWriter>(runs[idx].output_path_));
+        if (!fouts.back()->IsOpen()) {
+            return;
+        }
+    }
+
+    imu_gps::GinsBankReplay<> replay(options);
+    replay.SetStateCallback([&](size_t lane, const imu_gps::NavStated& s) {
+        fouts[lane]->Write(s);
+        results[indices[lane]].final_state_ = s;
+    });
+
+    imu_gps::TxtIO io(runs[indices[0]].log_path_);
+    io.SetIMUProcessFunc([&replay](const imu_gps::IMU& imu) { replay.AddIMU(imu); })
+        .SetGNSSProcessFunc([&replay](const imu_gps::GNSS& gnss) { replay.AddGNSS(gnss); })
+        .SetOdomProcessFunc([&replay](const imu_gps::Odom& odom) { replay.AddOdom(odom); })
+        .Go();
+
+    double wall_time =
+        std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - t1).count();
+    for (size_t k = 0; k < indices.size(); ++k) {
+        auto& r = results[indices[k]];
+        r.ok_ = replay.Running() && !imu_gps::global::FLAG_EXIT;
+        r.stats_ = replay.GetStats(k);
+        r.wall_time_ = wall_time;
+    }
+}
+
+/**
+ * Jobs of the worker pool, each a list of run indices.
+ * Without --bank every run is a job. With --bank the runs sharing the log, the antenna, the IMU period and the
+ * StaticIMUInit options form one job, the bank initializes all its lanes with one initializer; runs with
+ * cov_predict_interval > 1 are replayed alone, the bank propagates the covariance every sample.
+ */
+std::vector<std::vector<size_t>> GroupRuns(const std::vector<imu_gps::BatchRunSpec>& runs) {
+    std::vector<std::vector<size_t>> jobs;
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const auto& o = runs[i].options_;
+        bool grouped = false;
+        if (FLAGS_bank && o.eskf_options_.cov_predict_interval_ <= 1) {
+            for (auto& job : jobs) {
+                const auto& r = runs[job[0]];
+                const auto& ro = r.options_;
+                if (r.log_path_ == runs[i].log_path_ && ro.eskf_options_.cov_predict_interval_ <= 1 &&
+                    ro.antenna_angle_ == o.antenna_angle_ && ro.antenna_pos_ == o.antenna_pos_ &&
+                    ro.eskf_options_.imu_dt_ == o.eskf_options_.imu_dt_ && ro.init_options_ == o.init_options_) {
+                    job.emplace_back(i);
+                    grouped = true;
+                    break;
+                }
+            }
+        }
+        if (!grouped) {
+            jobs.push_back({i});
+        }
+    }
+    return jobs;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_stderrthreshold = google::WARNING;
+    FLAGS_colorlogtostderr = true;
+    google::ParseCommandLineFlags(&argc, &argv, true);
+
+    std::vector<imu_gps::BatchRunSpec> runs;
+    if (!imu_gps::LoadBatchManifest(FLAGS_manifest, runs) || runs.empty()) {
+        LOG(ERROR) << "No runs loaded from " << FLAGS_manifest;
+        return -1;
+    }
+
+    std::signal(SIGINT, [](int) { imu_gps::global::FLAG_EXIT = true; });
+
+    const auto jobs = GroupRuns(runs);
+    int num_threads = FLAGS_num_threads > 0 ? FLAGS_num_threads : int(std::thread::hardware_concurrency());
+    num_threads = std::max(1, std::min(num_threads, int(jobs.size())));
+
+    std::vector<RunResult> results(runs.size());
+    std::atomic<size_t> next_job{0};
+    auto t1 = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < num_threads; ++i) {
+        workers.emplace_back([&]() {
+            for (size_t j = next_job++; j < jobs.size() && !imu_gps::global::FLAG_EXIT; j = next_job++) {
+                const auto& job = jobs[j];
+                if (job.size() == 1) {
+                    results[job[0]] = RunOne(runs[job[0]]);
+                } else {
+                    RunBank(runs, job, results);
+                }
+                for (size_t idx : job) {
+                    LOG(WARNING) << "finished " << runs[idx].name_ << " in " << results[idx].wall_time_ << " s";
+                }
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    double total_time =
+        std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::steady_clock::now() - t1).count();
+
+    // Summary table
+    std::ofstream fsum(FLAGS_summary_path);
+    auto print_row = [&fsum](const std::string& row) {
+        std::cout << row << std::endl;
+        if (fsum) {
+            fsum << row << "\n";
+        }
+    };
+
+    std::stringstream header;
+    header << std::left << std::setw(20) << "name" << std::setw(6) << "ok" << std::setw(10) << "imu" << std::setw(8)
+           << "gnss" << std::setw(8) << "odom" << std::setw(10) << "gnss_rej" << std::setw(12) << "gnss_rmse"
+           << std::setw(10) << "time_s" << "output";
+    print_row(header.str());
+
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const auto& r = results[i];
+        std::stringstream row;
+        row << std::left << std::setw(20) << runs[i].name_ << std::setw(6) << (r.ok_ ? "yes" : "no")
+            << std::setw(10) << r.stats_.num_predict_ << std::setw(8) << r.stats_.num_gnss_update_ << std::setw(8)
+            << r.stats_.num_odom_update_ << std::setw(10) << r.stats_.num_gnss_rejected_ << std::setw(12)
+            << std::setprecision(4) << r.stats_.GnssRmse() << std::setw(10) << std::setprecision(4) << r.wall_time_
+            << runs[i].output_path_;
+        print_row(row.str());
+    }
+
+    LOG(WARNING) << runs.size() << " runs finished in " << total_time << " s with " << num_threads << " threads.";
+    return 0;
+}
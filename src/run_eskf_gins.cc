@@ -1,15 +1,34 @@
-#include "eskf.hpp"
-#include "static_imu_init.h"
+#include "gins_checkpoint.h"
+#include "gins_config.h"
+#include "gins_pipeline.h"
+#include "gins_replay.h"
+#include "gins_telemetry.h"
+#include "ieskf/ieskf.h"
+#include "imu_init_cache.h"
+#include "common/global_flags.h"
 #include "common/io_utils.h"
+#include "common/live_io.h"
+#include "common/replay_pacer.h"
+#include "common/sensor_sync.h"
+#include "common/traj_writer.h"
 #include "tools/ui/pangolin_window.h"
 #include "utm_convert.h"
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
-#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <functional>
 #include <iomanip>
+#include <limits>
+#include <optional>
 
 DEFINE_string(txt_path, "../data/10.txt", "Data file path");
+DEFINE_string(config, "",
+              "YAML file of replay options (keys as in a batch manifest), applied over the flags and reloaded into the "
+              "running filter when it changes");
+DEFINE_double(config_reload_interval, 1.0, "Seconds between checks of --config for changes, 0 = every GNSS reading");
 
 // The following parameters are only for the data provided in this book
 DEFINE_double(antenna_angle, 12.06,
@@ -18,11 +37,269 @@ DEFINE_double(antenna_pox_x, -0.17, "RTK antenna installation offset in X");
 DEFINE_double(antenna_pox_y, -0.20, "RTK antenna installation offset in Y");
 DEFINE_bool(with_ui, true, "Whether to display the graphical interface");
 DEFINE_bool(with_odom, true, "Whether to include odometry information");
+DEFINE_string(filter, "eskf", "Filter: eskf, or ieskf for iterated measurement updates");
+DEFINE_int32(max_iterations, 4, "IESKF: maximum number of iterations of one measurement update");
+DEFINE_double(gnss_gate_chi2, 0,
+              "Reject GNSS fixes whose innovation chi-square is above this before the update (e.g. 22.5), 0 = off");
+DEFINE_int32(cov_predict_interval, 1,
+             "Propagate the ESKF covariance every N IMU samples (and before every measurement), 1 = every sample");
+DEFINE_double(replay_speed, 10.0,
+              "Replay speed relative to the sensor timestamps: 1 = real time, "
+              "N = N times real time, 0 = as fast as possible");
+DEFINE_bool(profile, false, "Record and print the Predict/Observe latency histograms");
+DEFINE_bool(binary_output, false,
+            "Write the trajectory as raw doubles (.bin) instead of text (.txt)");
+DEFINE_bool(pipeline, false,
+            "Run parsing, GNSS conversion, the filter and the output on separate threads");
+DEFINE_string(live_source, "",
+              "Read live readings instead of --txt_path: udp://ADDRESS:PORT, a serial device or - for stdin");
+DEFINE_double(sync_window, 0,
+              "If > 0, reorder the readings by timestamp within this window (seconds) before the filter, "
+              "readings later than that are dropped");
+DEFINE_string(checkpoint_path, "", "Checkpoint file, written with --checkpoint_interval or read with --start_time");
+DEFINE_double(checkpoint_interval, 0,
+              "If > 0, write a checkpoint of the run to --checkpoint_path every this many seconds of log time");
+DEFINE_double(start_time, 0,
+              "If > 0, resume from the last checkpoint in --checkpoint_path at or before this timestamp, and only "
+              "replay the log from there (binary logs seek through their index)");
+DEFINE_string(imu_init_cache, "",
+              "If set, start the filter at once from the IMU biases and gravity cached for --device_id in this file, "
+              "and store the results of the static initialization there when it converges");
+DEFINE_string(device_id, "default", "Id of the IMU in --imu_init_cache");
+DEFINE_string(telemetry_path, "",
+              "If set, export the reading rates, stage latencies and queue depths as JSON lines to this file, or to "
+              "udp://ADDRESS:PORT");
+DEFINE_double(telemetry_interval, 1.0, "Seconds between two telemetry lines");
 
 /**
  * This program demonstrates the use of RTK+IMU for integrated navigation.
  */
 
+namespace {
+
+void LogFilterStats(const imu_gps::ESKFD&) {}
+
+void LogFilterStats(const imu_gps::IESKF& filter) {
+    const auto& stats = filter.GetStats();
+    LOG(INFO) << "IESKF: " << stats.num_updates_ << " updates, " << stats.num_iterations_ << " iterations, "
+              << stats.num_converged_ << " converged";
+}
+
+void LogGnssStats(const imu_gps::GinsReplayStats& stats) {
+    LOG(INFO) << "GNSS: " << stats.num_gnss_ << " readings, " << stats.num_gnss_update_ << " updates, "
+              << stats.num_gnss_rejected_ << " rejected by the gate";
+}
+
+/**
+ * Resume the replay from its checkpoint with --start_time, or write checkpoints with --checkpoint_interval
+ * @param io the log, restricted to the readings after the checkpoint when resuming
+ * @return false if the run should not start
+ */
+template <typename Filter>
+bool SetUpCheckpoints(imu_gps::GinsReplay<Filter>& replay, imu_gps::CheckpointWriter& writer, imu_gps::TxtIO* io) {
+    if (FLAGS_start_time > 0) {
+        if (io == nullptr) {
+            LOG(ERROR) << "--start_time needs a log, not a live source";
+            return false;
+        }
+
+        imu_gps::GinsCheckpoint cp;
+        if (!imu_gps::LoadCheckpoint(FLAGS_checkpoint_path, FLAGS_start_time, cp) || !replay.Restore(cp)) {
+            return false;
+        }
+        // the reading that triggered the checkpoint is already in it
+        io->SetTimeRange(std::nextafter(cp.state_.timestamp_, std::numeric_limits<double>::max()),
+                         std::numeric_limits<double>::max());
+        LOG(INFO) << "resuming from the checkpoint at " << std::setprecision(18) << cp.state_.timestamp_;
+
+        if (FLAGS_checkpoint_interval > 0) {
+            LOG(WARNING) << "--checkpoint_interval is ignored with --start_time, the checkpoints are read from "
+                         << FLAGS_checkpoint_path;
+        }
+        return true;
+    }
+
+    if (FLAGS_checkpoint_interval > 0) {
+        if (!writer.Open(FLAGS_checkpoint_path, imu_gps::GinsReplay<Filter>::kDim)) {
+            return false;
+        }
+        replay.SetCheckpointCallback([&writer](const imu_gps::GinsCheckpoint& cp) { writer.Write(cp); });
+    }
+    return true;
+}
+
+/// Start from the cached IMU priors of --device_id if any, and cache the results of the static initialization
+template <typename Filter>
+void SetUpIMUInitCache(imu_gps::GinsReplay<Filter>& replay) {
+    // a resumed run is initialized by its checkpoint
+    if (FLAGS_imu_init_cache.empty() || FLAGS_start_time > 0) {
+        return;
+    }
+
+    imu_gps::StaticIMUInit::Result priors;
+    if (imu_gps::LoadIMUInitCache(FLAGS_imu_init_cache, FLAGS_device_id, priors)) {
+        replay.StartFromPriors(priors);
+    } else {
+        LOG(INFO) << "no IMU priors of " << FLAGS_device_id << " in " << FLAGS_imu_init_cache
+                  << ", waiting for the static initialization";
+    }
+
+    replay.SetInitCallback([](const imu_gps::StaticIMUInit::Result& result) {
+        if (imu_gps::SaveIMUInitCache(FLAGS_imu_init_cache, FLAGS_device_id, result)) {
+            LOG(INFO) << "cached the IMU initialization of " << FLAGS_device_id << " in " << FLAGS_imu_init_cache;
+        }
+    });
+}
+
+/**
+ * Replay the file or live source with the given filter, on the pipeline or on a GinsReplay
+ * @param config if not null, polled for new options while running
+ * @param telemetry if not null, records the stages of every reading
+ */
+template <typename Filter>
+void Run(const imu_gps::GinsReplayOptions& replay_options, double replay_speed,
+         const std::function<void(const imu_gps::NavStated&)>& publish, imu_gps::GinsConfig* config,
+         imu_gps::GinsTelemetry* telemetry) {
+    imu_gps::CheckpointWriter checkpoints;
+    std::optional<imu_gps::TxtIO> io;
+    if (FLAGS_live_source.empty()) {
+        io.emplace(FLAGS_txt_path);
+    }
+
+    if (FLAGS_pipeline) {
+        imu_gps::GinsPipelineOptions pipeline_options;
+        pipeline_options.replay_speed_ = replay_speed;
+        pipeline_options.sync_window_ = FLAGS_sync_window;
+        imu_gps::GinsPipeline<Filter> pipeline(replay_options, pipeline_options);
+        pipeline.SetOutputCallback(publish).SetTelemetry(telemetry);
+        if (config) {
+            pipeline.SetOptionsSource([config](imu_gps::GinsReplayOptions& options) { return config->Poll(options); });
+        }
+        if (!SetUpCheckpoints(pipeline.GetReplay(), checkpoints, io ? &*io : nullptr)) {
+            return;
+        }
+        SetUpIMUInitCache(pipeline.GetReplay());
+        if (io) {
+            pipeline.Run(*io);
+        } else {
+            imu_gps::LiveIO live(FLAGS_live_source);
+            pipeline.Run(live);
+        }
+        LogFilterStats(pipeline.GetReplay().GetFilter());
+        LogGnssStats(pipeline.GetStats());
+    } else {
+        imu_gps::GinsReplay<Filter> replay(replay_options);
+        replay.SetStateCallback(publish);
+        if (!SetUpCheckpoints(replay, checkpoints, io ? &*io : nullptr)) {
+            return;
+        }
+        SetUpIMUInitCache(replay);
+
+        imu_gps::ReplayPacer pacer(replay_speed);
+
+        // every stage runs on this thread: reading, filter, then the states published from within the filter
+        using Clock = imu_gps::GinsTelemetry::Clock;
+        using Stage = imu_gps::GinsTelemetry::Stage;
+        using Sensor = imu_gps::GinsTelemetry::Sensor;
+        Clock::time_point arrival, last_done = Clock::now();
+        Clock::duration not_filter{};  // Conversion and publishing within the current reading
+        if (telemetry) {
+            replay.SetStateCallback([&](const imu_gps::NavStated& state) {
+                const auto t1 = Clock::now();
+                publish(state);
+                const auto t2 = Clock::now();
+                not_filter += t2 - t1;
+                telemetry->Record(Stage::END_TO_END, t2 - arrival);
+            });
+        }
+        auto timed = [&](Sensor sensor, double sensor_time, auto&& process) {
+            if (!telemetry) {
+                process();
+                return;
+            }
+            arrival = Clock::now();
+            telemetry->Record(Stage::READ, arrival - last_done);
+            not_filter = {};
+            process();
+            last_done = Clock::now();
+            telemetry->Record(Stage::FILTER, last_done - arrival - not_filter);
+            telemetry->CountReading(sensor, sensor_time);
+        };
+
+        auto add_imu = [&](const imu_gps::IMU& imu) {
+            if (telemetry && pacer.Paced()) {
+                // the pacing wait is neither reading nor filter time
+                const auto t1 = Clock::now();
+                pacer.WaitUntil(imu.timestamp_);
+                last_done += Clock::now() - t1;
+            } else {
+                pacer.WaitUntil(imu.timestamp_);
+            }
+            timed(Sensor::IMU, imu.timestamp_, [&]() { replay.AddIMU(imu); });
+        };
+        auto add_gnss = [&](const imu_gps::GNSS& gnss) {
+            // new options take effect before the observation, at GNSS rate
+            imu_gps::GinsReplayOptions options = replay.GetOptions();
+            if (config && config->Poll(options)) {
+                replay.SetOptions(options);
+            }
+            timed(Sensor::GNSS, gnss.unix_time_, [&]() {
+                // readings before the filter is set up are not converted, and not a CONVERT sample either
+                if (!telemetry || !replay.IMUInited()) {
+                    replay.AddGNSS(gnss);
+                    return;
+                }
+                // AddGNSS in two steps, the conversion is a stage of its own
+                imu_gps::GNSS converted = gnss;
+                const auto t1 = Clock::now();
+                replay.ConvertGNSS(converted);
+                const auto d = Clock::now() - t1;
+                telemetry->Record(Stage::CONVERT, d);
+                not_filter += d;
+                replay.AddConvertedGNSS(converted);
+            });
+        };
+        auto add_odom = [&](const imu_gps::Odom& odom) {
+            timed(Sensor::ODOM, odom.timestamp_, [&]() { replay.AddOdom(odom); });
+        };
+
+        // feed a file or live source into the replay, through the synchronizer if enabled
+        auto run = [&](auto& source) {
+            if (FLAGS_sync_window > 0) {
+                // the synchronizer hands the readings to the replay in time order
+                imu_gps::SensorSynchronizer::Options sync_options;
+                sync_options.latency_window_ = FLAGS_sync_window;
+                imu_gps::SensorSynchronizer sync(sync_options);
+                sync.SetIMUProcessFunc(add_imu).SetGNSSProcessFunc(add_gnss).SetOdomProcessFunc(add_odom);
+
+                source.SetIMUProcessFunc([&](const imu_gps::IMU& imu) { sync.AddIMU(imu); })
+                    .SetGNSSProcessFunc([&](const imu_gps::GNSS& gnss) { sync.AddGNSS(gnss); })
+                    .SetOdomProcessFunc([&](const imu_gps::Odom& odom) { sync.AddOdom(odom); })
+                    .Go();
+                sync.Flush();
+                LOG(INFO) << sync.StatsString();
+            } else {
+                source.SetIMUProcessFunc(add_imu).SetGNSSProcessFunc(add_gnss).SetOdomProcessFunc(add_odom).Go();
+            }
+        };
+
+        if (io) {
+            run(*io);
+        } else {
+            imu_gps::LiveIO live(FLAGS_live_source);
+            run(live);
+        }
+        LogFilterStats(replay.GetFilter());
+        LogGnssStats(replay.GetStats());
+    }
+
+    if (checkpoints.NumCheckpoints() > 0) {
+        LOG(INFO) << "wrote " << checkpoints.NumCheckpoints() << " checkpoints to " << FLAGS_checkpoint_path;
+    }
+}
+
+}  // namespace
+
 int main(int argc, char** argv) {
     google::InitGoogleLogging(argv[0]);
     FLAGS_stderrthreshold = google::INFO;
@@ -32,40 +309,47 @@ int main(int argc, char** argv) {
     if (fLS::FLAGS_txt_path.empty()) {
         return -1;
     }
+    if (FLAGS_filter != "eskf" && FLAGS_filter != "ieskf") {
+        LOG(ERROR) << "Unknown --filter " << FLAGS_filter << ", expected eskf or ieskf";
+        return -1;
+    }
 
-    imu_gps::StaticIMUInit imu_init;
-    imu_gps::ESKFD eskf;
-
-    imu_gps::TxtIO io(FLAGS_txt_path);
-    Vec2d antenna_pos(FLAGS_antenna_pox_x, FLAGS_antenna_pox_y);
+    imu_gps::GinsReplayOptions replay_options;
+    replay_options.antenna_angle_ = FLAGS_antenna_angle;
+    replay_options.antenna_pos_ = Vec2d(FLAGS_antenna_pox_x, FLAGS_antenna_pox_y);
+    replay_options.with_odom_ = FLAGS_with_odom;
+    replay_options.eskf_options_.cov_predict_interval_ = FLAGS_cov_predict_interval;
+    replay_options.eskf_options_.max_iterations_ = FLAGS_max_iterations;
+    replay_options.eskf_options_.gnss_gate_chi2_ = FLAGS_gnss_gate_chi2;
+    replay_options.profile_ = FLAGS_profile;
+    replay_options.checkpoint_interval_ = FLAGS_checkpoint_interval;
 
-    auto save_vec3 = [](std::ofstream& fout, const Vec3d& v) {
-        fout << v[0] << " " << v[1] << " " << v[2] << " ";
-    };
-    auto save_quat = [](std::ofstream& fout, const Quatd& q) {
-        fout << q.w() << " " << q.x() << " " << q.y() << " " << q.z() << " ";
-    };
+    std::optional<imu_gps::GinsTelemetry> telemetry;
+    if (!FLAGS_telemetry_path.empty()) {
+        imu_gps::GinsTelemetry::Options telemetry_options;
+        telemetry_options.sink_ = FLAGS_telemetry_path;
+        telemetry_options.export_interval_ = FLAGS_telemetry_interval;
+        telemetry.emplace(telemetry_options);
+        if (!telemetry->Start()) {
+            return -1;
+        }
+    }
 
-    auto save_result = [&save_vec3, &save_quat](
-                           std::ofstream& fout,
-                           const imu_gps::NavStated& save_state) {
-        fout << std::setprecision(18) << save_state.timestamp_ << " "
-             << std::setprecision(9);
-        save_vec3(fout, save_state.p_);
-        save_quat(fout, save_state.R_.unit_quaternion());
-        save_vec3(fout, save_state.v_);
-        save_vec3(fout, save_state.bg_);
-        save_vec3(fout, save_state.ba_);
-        fout << std::endl;
-    };
+    std::optional<imu_gps::GinsConfig> config;
+    if (!FLAGS_config.empty()) {
+        config.emplace(FLAGS_config, FLAGS_config_reload_interval);
+        if (!config->Load(replay_options)) {
+            return -1;
+        }
+    }
 
     // Set the output file name based on the --with_odom flag
-    std::string output_filename = FLAGS_with_odom ? "../data/gins_with_odom.txt" : "../data/gins_no_odom.txt";
+    std::string output_filename = replay_options.with_odom_ ? "../data/gins_with_odom" : "../data/gins_no_odom";
+    output_filename += FLAGS_binary_output ? ".bin" : ".txt";
 
-    // std::ofstream fout("../data/gins.txt");
-
-    std::ofstream fout(output_filename);
-    bool imu_inited = false, gnss_inited = false;
+    imu_gps::TrajectoryWriter fout(output_filename, FLAGS_binary_output
+                                                        ? imu_gps::TrajectoryWriter::Format::BINARY
+                                                        : imu_gps::TrajectoryWriter::Format::TEXT);
 
     std::shared_ptr<imu_gps::ui::PangolinWindow> ui = nullptr;
     if (FLAGS_with_ui) {
@@ -73,88 +357,44 @@ int main(int argc, char** argv) {
         ui->Init();
     }
 
-    bool first_gnss_set = false;
-    Vec3d origin = Vec3d::Zero();
-
-    io.SetIMUProcessFunc([&](const imu_gps::IMU& imu) {
-          if (!imu_init.InitSuccess()) {
-              imu_init.AddIMU(imu);
-              return;
-          }
-
-          if (!imu_inited) {
-              // Read initial biases and set up ESKF.
-              imu_gps::ESKFOptions options;
-
-              // Noise estimated by the initializer.
-              //   options.gyro_var_ = sqrt(imu_init.GetCovGyro()[0]);
-              //   options.acce_var_ = sqrt(imu_init.GetCovAcce()[0]);
-              eskf.SetInitialConditions(options, imu_init.GetInitBg(),
-                                        imu_init.GetInitBa(),
-                                        imu_init.GetGravity());
-
-              imu_inited = true;
-              return;
-          }
-
-          /// Wait for valid RTK data.
-          if (!gnss_inited) {
-              return;
-          }
-
-          /// Once GNSS is also received, start the prediction.
-          eskf.Predict(imu);
-
-          /// The predict function will update the ESKF,
-          ///   so data can be sent at\  this point.
-          auto state = eskf.GetNominalState();
-          if (ui) {
-              ui->UpdateNavState(state);
-          }
-
-          /// Record data for plotting purposes.
-          save_result(fout, state);
-
-          usleep(1e3);
-      })
-        .SetGNSSProcessFunc([&](const imu_gps::GNSS& gnss) {
-            if (!imu_inited) {
-                return;
+    auto publish = [&](const imu_gps::NavStated& state) {
+        auto t1 = telemetry ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+        if (ui) {
+            ui->UpdateNavState(state);
+            if (telemetry) {
+                const auto t2 = std::chrono::steady_clock::now();
+                telemetry->Record(imu_gps::GinsTelemetry::Stage::UI, t2 - t1);
+                t1 = t2;
             }
+        }
 
-            imu_gps::GNSS gnss_convert = gnss;
-            if (!imu_gps::ConvertGps2UTM(gnss_convert, antenna_pos,
-                                     FLAGS_antenna_angle) ||
-                !gnss_convert.heading_valid_) {
-                return;
-            }
+        /// Record data for plotting purposes.
+        fout.Write(state);
+        if (telemetry) {
+            telemetry->RecordSince(imu_gps::GinsTelemetry::Stage::OUTPUT, t1);
+        }
+    };
 
-            if (!first_gnss_set) {
-                origin = gnss_convert.utm_pose_.translation();
-                first_gnss_set = true;
-            }
-            gnss_convert.utm_pose_.translation() -= origin;
+    // live readings arrive at sensor rate already, and only stop on Ctrl-C
+    const double replay_speed = FLAGS_live_source.empty() ? FLAGS_replay_speed : 0;
+    if (!FLAGS_live_source.empty()) {
+        std::signal(SIGINT, [](int) { imu_gps::global::FLAG_EXIT = true; });
+    }
 
-            // RTK heading must be valid in order to integrate with ESKF.
-            eskf.ObserveGps(gnss_convert);
+    if (FLAGS_filter == "ieskf") {
+        Run<imu_gps::IESKF>(replay_options, replay_speed, publish, config ? &*config : nullptr,
+                            telemetry ? &*telemetry : nullptr);
+    } else {
+        Run<imu_gps::ESKFD>(replay_options, replay_speed, publish, config ? &*config : nullptr,
+                            telemetry ? &*telemetry : nullptr);
+    }
+    if (telemetry) {
+        telemetry->Stop();
+    }
 
-            auto state = eskf.GetNominalState();
-            if (ui) {
-                ui->UpdateNavState(state);
-            }
-            save_result(fout, state);
-
-            gnss_inited = true;
-        })
-        .SetOdomProcessFunc([&](const imu_gps::Odom& odom) {
-            /// Odom processing function, Odom is only used for initialization
-            /// in this chapter
-            imu_init.AddOdom(odom);
-            if (FLAGS_with_odom && imu_inited && gnss_inited) {
-                eskf.ObserveWheelSpeed(odom);
-            }
-        })
-        .Go();
+    if (FLAGS_profile) {
+        imu_gps::common::Timer::PrintAll();
+    }
 
     while (ui && !ui->ShouldQuit()) {
         usleep(1e5);
@@ -0,0 +1,90 @@
+#include "common/io_utils.h"
+#include "common/traj_writer.h"
+#include "fixed_lag_smoother.h"
+#include "gins_replay.h"
+#include "utm_convert.h"
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+DEFINE_string(txt_path, "../data/10.txt", "Data file path");
+DEFINE_string(output_path, "../data/gins_smoothed.txt", "Smoothed trajectory output path");
+
+// The following parameters are only for the data provided in this book
+DEFINE_double(antenna_angle, 12.06, "RTK antenna installation angle (in degrees)");
+DEFINE_double(antenna_pox_x, -0.17, "RTK antenna installation offset in X");
+DEFINE_double(antenna_pox_y, -0.20, "RTK antenna installation offset in Y");
+DEFINE_bool(with_odom, true, "Whether to include odometry information");
+DEFINE_int32(window_size, 10, "Keyframes (GNSS readings) in the smoothing window");
+DEFINE_int32(max_iterations, 4, "Gauss-Newton iterations per keyframe");
+
+/**
+ * This program post-processes a log with the fixed-lag smoother.
+ * The ESKF of run_eskf_gins initializes the IMU and provides the first state, then every GNSS reading becomes a
+ * keyframe of the smoother; the keyframes leaving the window are written as "t p q(wxyz) v bg ba", one line each.
+ */
+
+int main(int argc, char** argv) {
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_stderrthreshold = google::INFO;
+    FLAGS_colorlogtostderr = true;
+    google::ParseCommandLineFlags(&argc, &argv, true);
+
+    imu_gps::GinsReplayOptions replay_options;
+    replay_options.antenna_angle_ = FLAGS_antenna_angle;
+    replay_options.antenna_pos_ = Vec2d(FLAGS_antenna_pox_x, FLAGS_antenna_pox_y);
+    replay_options.with_odom_ = FLAGS_with_odom;
+    imu_gps::GinsReplay<> replay(replay_options);
+
+    imu_gps::FixedLagSmoother::Options smoother_options;
+    smoother_options.eskf_options_ = replay_options.eskf_options_;
+    smoother_options.window_size_ = FLAGS_window_size;
+    smoother_options.max_iterations_ = FLAGS_max_iterations;
+    smoother_options.with_odom_ = FLAGS_with_odom;
+    imu_gps::FixedLagSmoother smoother(smoother_options);
+
+    imu_gps::TrajectoryWriter fout(FLAGS_output_path);
+    if (!fout.IsOpen()) {
+        return -1;
+    }
+    smoother.SetOutputCallback([&fout](const imu_gps::NavStated& state) { fout.Write(state); });
+
+    auto add_imu = [&](const imu_gps::IMU& imu) {
+        replay.AddIMU(imu);
+        smoother.AddIMU(imu);
+    };
+    auto add_odom = [&](const imu_gps::Odom& odom) {
+        replay.AddOdom(odom);
+        smoother.AddOdom(odom);
+    };
+    auto add_gnss = [&](const imu_gps::GNSS& gnss) {
+        replay.AddGNSS(gnss);
+        if (!smoother.Initialized()) {
+            // the reading that started the filter is the first keyframe
+            if (replay.Running()) {
+                auto& filter = replay.GetFilter();
+                smoother.Init(filter.GetNominalState(), filter.GetGravity(), filter.GetCov().topLeftCorner<15, 15>());
+            }
+            return;
+        }
+
+        imu_gps::GNSS gnss_convert = gnss;
+        if (!imu_gps::ConvertGps2UTM(gnss_convert, replay_options.antenna_pos_, replay_options.antenna_angle_)) {
+            return;
+        }
+        gnss_convert.utm_pose_.translation() -= replay.GetOrigin();
+        smoother.AddGNSS(gnss_convert);
+    };
+
+    imu_gps::TxtIO io(FLAGS_txt_path);
+    io.SetIMUProcessFunc(add_imu).SetGNSSProcessFunc(add_gnss).SetOdomProcessFunc(add_odom).Go();
+    smoother.Flush();
+
+    const auto& stats = smoother.GetStats();
+    LOG(INFO) << "smoother: " << stats.num_keyframes_ << " keyframes, " << stats.num_odom_factors_
+              << " with odom, " << stats.num_iterations_ << " iterations, " << stats.num_symbolic_
+              << " symbolic factorizations, " << stats.num_failed_ << " failed";
+    LOG(INFO) << "GNSS position rmse, filter (predicted): " << replay.GetStats().GnssRmse()
+              << ", smoother: " << stats.GnssRmse();
+    return 0;
+}
@@ -1,13 +1,31 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
-#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <vector>
 
+#include "imu_init_cache.h"
 #include "imu_integration.h"
 #include "common/io_utils.h"
+#include "common/replay_pacer.h"
+#include "common/traj_writer.h"
 #include "tools/ui/pangolin_window.h"
 
 DEFINE_string(imu_txt_path, "../data/10.txt", "Data file path");
 DEFINE_bool(with_ui, true, "Whether to display the graphical interface");
+DEFINE_double(replay_speed, 100.0,
+              "Replay speed relative to the sensor timestamps: 1 = real time, "
+              "N = N times real time, 0 = as fast as possible");
+DEFINE_bool(binary_output, false,
+            "Write the trajectory as raw doubles (.bin) instead of text (.txt)");
+DEFINE_int32(num_threads, 1,
+             "1 integrates the readings as they are parsed, N > 1 (0 = number "
+             "of hardware threads) loads the log and integrates it in N "
+             "parallel segments (IMUIntegration::AddIMUsParallel)");
+DEFINE_string(imu_init_cache, "",
+              "If set, integrate with the IMU biases and gravity cached for "
+              "--device_id in this file (written by run_eskf_gins)");
+DEFINE_string(device_id, "default", "Id of the IMU in --imu_init_cache");
 
 /**
  * This program demonstrates how to perform direct integration on an IMU.
@@ -28,10 +46,20 @@ int main(int argc, char** argv) {
 
     imu_gps::TxtIO io(FLAGS_imu_txt_path);
 
-    // In this experiment, we assume that the biases are known.
+    // In this experiment, we assume that the biases are known: those of the
+    // last static initialization of the device if cached, else those below.
     Vec3d init_bg(00.000224886, -7.61038e-05, -0.000742259);
     Vec3d init_ba(-0.165205, 0.0926887, 0.0058049);
     Vec3d gravity(0, 0, -9.8);
+    imu_gps::StaticIMUInit::Result priors;
+    if (!FLAGS_imu_init_cache.empty() &&
+        imu_gps::LoadIMUInitCache(FLAGS_imu_init_cache, FLAGS_device_id,
+                                  priors)) {
+        init_bg = priors.init_bg_;
+        init_ba = priors.init_ba_;
+        gravity = priors.gravity_;
+        LOG(INFO) << "using the cached IMU biases of " << FLAGS_device_id;
+    }
 
     imu_gps::IMUIntegration imu_integ(gravity, init_bg, init_ba);
 
@@ -41,36 +69,54 @@ int main(int argc, char** argv) {
         ui->Init();
     }
 
-    auto save_result = [](std::ofstream& fout, double timestamp,
-                          const Sophus::SO3d& R, const Vec3d& v,
-                          const Vec3d& p) {
-        auto save_vec3 = [](std::ofstream& fout, const Vec3d& v) {
-            fout << v[0] << " " << v[1] << " " << v[2] << " ";
-        };
-        auto save_quat = [](std::ofstream& fout, const Quatd& q) {
-            fout << q.w() << " " << q.x() << " " << q.y() << " " << q.z()
-                 << " ";
-        };
-
-        fout << std::setprecision(18) << timestamp << " "
-             << std::setprecision(9);
-        save_vec3(fout, p);
-        save_quat(fout, R.unit_quaternion());
-        save_vec3(fout, v);
-        fout << std::endl;
+    imu_gps::TrajectoryWriter fout(FLAGS_binary_output ? "../data/state.bin" : "../data/state.txt",
+                                   FLAGS_binary_output ? imu_gps::TrajectoryWriter::Format::BINARY
+                                                       : imu_gps::TrajectoryWriter::Format::TEXT);
+    imu_gps::ReplayPacer pacer(FLAGS_replay_speed);
+    auto output = [&fout, &ui, &pacer](const imu_gps::NavStated& state) {
+        pacer.WaitUntil(state.timestamp_);
+
+        const Vec3d& p = state.p_;
+        const Vec3d& v = state.v_;
+        const Quatd q = state.R_.unit_quaternion();
+        fout.Write(state.timestamp_, {p[0], p[1], p[2], q.w(), q.x(), q.y(),
+                                      q.z(), v[0], v[1], v[2]});
+        if (ui) {
+            ui->UpdateNavState(state);
+        }
     };
 
-    std::ofstream fout("../data/state.txt");
-    io.SetIMUProcessFunc([&imu_integ, &save_result, &fout,
-                          &ui](const imu_gps::IMU& imu) {
-          imu_integ.AddIMU(imu);
-          save_result(fout, imu.timestamp_, imu_integ.GetR(), imu_integ.GetV(),
-                      imu_integ.GetP());
-          if (ui) {
-              ui->UpdateNavState(imu_integ.GetNavState());
-              usleep(1e2);
-          }
-      }).Go();
+    const int num_threads = FLAGS_num_threads > 0
+                                ? FLAGS_num_threads
+                                : int(std::thread::hardware_concurrency());
+    if (num_threads <= 1) {
+        io.SetIMUProcessFunc([&imu_integ, &output](const imu_gps::IMU& imu) {
+              imu_integ.AddIMU(imu);
+              output(imu_integ.GetNavState());
+          }).Go();
+    } else {
+        // offline dead reckoning: integrate the whole log, then output it
+        std::vector<imu_gps::IMU> imus;
+        io.SetIMUProcessFunc(
+              [&imus](const imu_gps::IMU& imu) { imus.emplace_back(imu); })
+            .Go();
+
+        std::vector<imu_gps::NavStated> states(imus.size());
+        auto t1 = std::chrono::steady_clock::now();
+        imu_integ.AddIMUsParallel(imus.data(), imus.size(), num_threads,
+                                  states.data());
+        double integration_time =
+            std::chrono::duration_cast<std::chrono::duration<double>>(
+                std::chrono::steady_clock::now() - t1)
+                .count();
+        LOG(INFO) << imus.size() << " IMU readings integrated in "
+                  << integration_time << " s with " << num_threads
+                  << " threads.";
+
+        for (const auto& state : states) {
+            output(state);
+        }
+    }
 
     // If visualization is enabled, wait for the interface to exit
     while (ui && !ui->ShouldQuit()) {
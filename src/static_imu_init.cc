@@ -5,23 +5,72 @@
 
 namespace imu_gps {
 
+StaticIMUInit::StaticIMUInit(Options options) : options_(options) {
+    // one spare slot, a reading is pushed and checked before the window is trimmed
+    init_imu_ring_.resize(options_.init_imu_queue_max_size_ + 1);
+}
+
+void StaticIMUInit::PushIMU(const IMU& imu) {
+    init_imu_ring_[(ring_head_ + ring_size_) % init_imu_ring_.size()] = imu;
+    ++ring_size_;
+    gyro_stats_.Add(imu.gyro_);
+    acce_stats_.Add(imu.acce_);
+}
+
+void StaticIMUInit::PopIMU() {
+    const IMU& imu = init_imu_ring_[ring_head_];
+    gyro_stats_.Remove(imu.gyro_);
+    acce_stats_.Remove(imu.acce_);
+    ring_head_ = (ring_head_ + 1) % init_imu_ring_.size();
+    --ring_size_;
+
+    if (++pops_since_recompute_ >= init_imu_ring_.size()) {
+        RecomputeStats();
+    }
+}
+
+void StaticIMUInit::ClearIMU() {
+    ring_head_ = 0;
+    ring_size_ = 0;
+    pops_since_recompute_ = 0;
+    gyro_stats_.Reset();
+    acce_stats_.Reset();
+    rejected_ = false;
+}
+
+void StaticIMUInit::RecomputeStats() {
+    gyro_stats_.Reset();
+    acce_stats_.Reset();
+    for (size_t i = 0; i < ring_size_; ++i) {
+        const IMU& imu = init_imu_ring_[(ring_head_ + i) % init_imu_ring_.size()];
+        gyro_stats_.Add(imu.gyro_);
+        acce_stats_.Add(imu.acce_);
+    }
+    pops_since_recompute_ = 0;
+}
+
 bool StaticIMUInit::AddIMU(const IMU& imu) {
     if (init_success_) {
         return true;
     }
 
     if (options_.use_speed_for_static_checking_ && !is_static_) {
-        LOG(WARNING) << "Waiting for the vehicle to be stationary";
-        init_imu_deque_.clear();
+        // may last the whole run when the filter started from cached priors
+        if (!waiting_) {
+            LOG(WARNING) << "Waiting for the vehicle to be stationary";
+            waiting_ = true;
+        }
+        ClearIMU();
         return false;
     }
+    waiting_ = false;
 
-    if (init_imu_deque_.empty()) {
+    if (ring_size_ == 0) {
         init_start_time_ = imu.timestamp_;
     }
 
     // Add to initialization queue
-    init_imu_deque_.push_back(imu);
+    PushIMU(imu);
 
     double init_time =
         imu.timestamp_ - init_start_time_;  // Elapsed time for initialization
@@ -31,8 +80,8 @@ bool StaticIMUInit::AddIMU(const IMU& imu) {
     }
 
     // Maintain the length of the initialization queue
-    while (init_imu_deque_.size() > options_.init_imu_queue_max_size_) {
-        init_imu_deque_.pop_front();
+    while (ring_size_ > size_t(options_.init_imu_queue_max_size_)) {
+        PopIMU();
     }
 
     current_time_ = imu.timestamp_;
@@ -56,35 +105,44 @@ bool StaticIMUInit::AddOdom(const Odom& odom) {
 }
 
 bool StaticIMUInit::TryInit() {
-    if (init_imu_deque_.size() < 10) {
+    if (ring_size_ < 10) {
         return false;
     }
 
-    Vec3d mean_gyro, mean_acce;
-    math::ComputeMeanAndCovDiag(init_imu_deque_, mean_gyro, cov_gyro_,
-                                [](const IMU& imu) { return imu.gyro_; });
-    math::ComputeMeanAndCovDiag(init_imu_deque_, mean_acce, cov_acce_,
-                                [this](const IMU& imu) { return imu.acce_; });
+    Vec3d mean_gyro = gyro_stats_.mean_;
+    Vec3d mean_acce = acce_stats_.mean_;
+    cov_gyro_ = gyro_stats_.Var();
+    cov_acce_ = acce_stats_.Var();
 
     // Set gravity with the mean acceleration
-    // as the direction and 9.8 as the magnitude
-    LOG(INFO) << "mean acce: " << mean_acce.transpose();
+    // as the direction and 9.8 as the magnitude.
+    // Attempted at IMU rate while the window stays noisy, which may last the
+    // whole run when the filter started from cached priors, so only the first
+    // attempt of a window is logged
+    if (!rejected_) {
+        LOG(INFO) << "mean acce: " << mean_acce.transpose();
+    }
     gravity_ = -mean_acce / mean_acce.norm() * options_.gravity_norm_;
 
-    // Recalculate accelerometer covariance
-    math::ComputeMeanAndCovDiag(
-        init_imu_deque_, mean_acce, cov_acce_,
-        [this](const IMU& imu) { return imu.acce_ + gravity_; });
+    // Accelerometer bias is the mean of acce + gravity, the offset leaves the
+    // covariance unchanged
+    mean_acce += gravity_;
 
     // Check IMU noise
     if (cov_gyro_.norm() > options_.max_static_gyro_var) {
-        LOG(ERROR) << "Gyroscope measurement noise is too large: "
-                   << cov_gyro_.norm() << " > " << options_.max_static_gyro_var;
+        if (!rejected_) {
+            LOG(ERROR) << "Gyroscope measurement noise is too large: "
+                       << cov_gyro_.norm() << " > " << options_.max_static_gyro_var;
+            rejected_ = true;
+        }
         return false;
     }
     if (cov_acce_.norm() > options_.max_static_acce_var) {
-        LOG(ERROR) << "Accelerometer measurement noise is too large: "
-                   << cov_acce_.norm() << " > " << options_.max_static_acce_var;
+        if (!rejected_) {
+            LOG(ERROR) << "Accelerometer measurement noise is too large: "
+                       << cov_acce_.norm() << " > " << options_.max_static_acce_var;
+            rejected_ = true;
+        }
         return false;
     }
 
@@ -5,7 +5,7 @@
 #include "common/imu.h"
 #include "common/odom.h"
 
-#include <deque>
+#include <vector>
 
 namespace imu_gps {
 
@@ -26,28 +26,44 @@ namespace imu_gps {
     * The initializer collects IMU readings over a period of time and estimates
     initial biases and noise parameters according to section 3.5.4 of the book,
     providing them to the ESKF or other filters.
+
+    * Readings are kept in a fixed-capacity ring allocated once, and the mean and
+    variance of the window are updated incrementally (Welford) as readings enter
+    and leave it, so every AddIMU is O(1) and a restart after motion does not
+    reallocate.
  */
 
 class StaticIMUInit {
    public:
     struct Options {
         Options() {}
-        const double init_time_seconds_ = 10.0;
-        const int init_imu_queue_max_size_ =
+        double init_time_seconds_ = 10.0;
+        int init_imu_queue_max_size_ =
             2000;  // Maximum length of the IMU queue during initialization
-        const int static_odom_pulse_ =
+        int static_odom_pulse_ =
             5;  // Noise in the odometry output during stationary state
-        const double max_static_gyro_var =
+        double max_static_gyro_var =
             0.5;  // Variance of gyroscope measurements in static state
-        const double max_static_acce_var =
+        double max_static_acce_var =
             0.05;  // Variance of accelerometer measurements in static state
-        const double gravity_norm_ = 9.81;  // Magnitude of gravity
-        const bool use_speed_for_static_checking_ =
+        double gravity_norm_ = 9.81;  // Magnitude of gravity
+        bool use_speed_for_static_checking_ =
             true;  // Whether to use odom to determine vehicle stationary state
                    // (some datasets may not have odom option)
+
+        bool operator==(const Options&) const = default;
     };
 
-    StaticIMUInit(Options options = Options()) : options_(options) {}
+    /// Converged biases, gravity and noise
+    struct Result {
+        Vec3d init_bg_ = Vec3d::Zero();
+        Vec3d init_ba_ = Vec3d::Zero();
+        Vec3d gravity_ = Vec3d::Zero();
+        Vec3d cov_gyro_ = Vec3d::Zero();
+        Vec3d cov_acce_ = Vec3d::Zero();
+    };
+
+    StaticIMUInit(Options options = Options());
 
     bool AddIMU(const IMU& imu);
     bool AddOdom(const Odom& odom);
@@ -61,11 +77,59 @@ class StaticIMUInit {
     Vec3d GetInitBg() const { return init_bg_; }
     Vec3d GetInitBa() const { return init_ba_; }
     Vec3d GetGravity() const { return gravity_; }
+    Result GetResult() const { return {init_bg_, init_ba_, gravity_, cov_gyro_, cov_acce_}; }
+
+    /// Skip the initialization with known results, e.g. restored from a checkpoint
+    void SetInitResult(const Vec3d& init_bg, const Vec3d& init_ba, const Vec3d& gravity) {
+        init_bg_ = init_bg;
+        init_ba_ = init_ba;
+        gravity_ = gravity;
+        init_success_ = true;
+    }
 
    private:
+    /// Running mean and unbiased variance of the per-axis readings in a window
+    struct WindowStats {
+        void Reset() {
+            n_ = 0;
+            mean_.setZero();
+            m2_.setZero();
+        }
+
+        void Add(const Vec3d& x) {
+            ++n_;
+            const Vec3d d = x - mean_;
+            mean_ += d / n_;
+            m2_ += d.cwiseProduct(x - mean_);
+        }
+
+        void Remove(const Vec3d& x) {
+            if (--n_ == 0) {
+                Reset();
+                return;
+            }
+            const Vec3d d = x - mean_;
+            mean_ -= d / n_;
+            m2_ -= d.cwiseProduct(x - mean_);
+        }
+
+        Vec3d Var() const { return (m2_ / (n_ - 1)).cwiseMax(0.0); }
+
+        int n_ = 0;
+        Vec3d mean_ = Vec3d::Zero();
+        Vec3d m2_ = Vec3d::Zero();
+    };
+
     /// Attempt system initialization
     bool TryInit();
 
+    void PushIMU(const IMU& imu);
+    void PopIMU();
+    void ClearIMU();
+
+    /// Recompute the window statistics from the ring, bounds the rounding drift of repeated removals
+    void RecomputeStats();
+
     Options options_;
     bool init_success_ = false;
 
@@ -80,10 +144,19 @@ class StaticIMUInit {
     Vec3d gravity_ = Vec3d::Zero();
 
     bool is_static_ = false;  // Flag indicating if the vehicle is stationary
-
-    std::deque<IMU> init_imu_deque_;  // Data for initialization
-    double current_time_ = 0.0;       // Current time
-    double init_start_time_ = 0.0;    // Initial time for stationary state
+    bool waiting_ = false;    // Waiting for the vehicle to stop, logged once per stop
+    bool rejected_ = false;   // The window failed the noise check, logged once per window
+
+    // Data for initialization, a ring of init_imu_queue_max_size_ + 1 slots
+    std::vector<IMU> init_imu_ring_;
+    size_t ring_head_ = 0;  // Index of the oldest reading
+    size_t ring_size_ = 0;  // Number of readings in the window
+    size_t pops_since_recompute_ = 0;
+    WindowStats gyro_stats_;
+    WindowStats acce_stats_;
+
+    double current_time_ = 0.0;     // Current time
+    double init_start_time_ = 0.0;  // Initial time for stationary state
 };
 
 }  // namespace imu_gps
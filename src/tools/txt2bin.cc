@@ -0,0 +1,43 @@
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "common/bin_log.h"
+#include "common/io_utils.h"
+
+DEFINE_string(txt_path, "../data/10.txt", "Input text log path");
+DEFINE_string(bin_path, "../data/10.bin", "Output binary log path");
+
+/**
+ * Converts a text sensor log (IMU/ODOM/GNSS lines) into the indexed binary container.
+ * TxtIO detects the binary format automatically, so the output can be passed to any program that takes a log path.
+ */
+
+int main(int argc, char** argv) {
+    google::InitGoogleLogging(argv[0]);
+    FLAGS_stderrthreshold = google::INFO;
+    FLAGS_colorlogtostderr = true;
+    google::ParseCommandLineFlags(&argc, &argv, true);
+
+    if (FLAGS_txt_path.empty() || FLAGS_bin_path.empty()) {
+        return -1;
+    }
+
+    imu_gps::binlog::BinLogWriter writer;
+    if (!writer.Open(FLAGS_bin_path)) {
+        return -1;
+    }
+
+    imu_gps::TxtIO io(FLAGS_txt_path);
+    io.SetIMUProcessFunc([&writer](const imu_gps::IMU& imu) { writer.Write(imu); })
+        .SetOdomProcessFunc([&writer](const imu_gps::Odom& odom) { writer.Write(odom); })
+        .SetGNSSProcessFunc([&writer](const imu_gps::GNSS& gnss) { writer.Write(gnss); })
+        .Go();
+
+    size_t num_records = writer.NumRecords();
+    if (!writer.Close()) {
+        return -1;
+    }
+
+    LOG(INFO) << "converted " << num_records << " records into " << FLAGS_bin_path;
+    return 0;
+}
@@ -2,6 +2,8 @@
 #include "tools/ui/pangolin_window_impl.h"
 
 #include <glog/logging.h>
+#include <algorithm>
+
 namespace imu_gps::ui {
 
 PangolinWindow::PangolinWindow() { impl_ = std::make_shared<PangolinWindowImpl>(); }
@@ -11,9 +13,6 @@ PangolinWindow::~PangolinWindow() {
 }
 
 bool PangolinWindow::Init() {
-    impl_->kf_result_need_update_.store(false);
-    impl_->gps_need_update_.store(false);
-
     bool inited = impl_->Init();
     if (inited) {
         impl_->render_thread_ = std::thread([this]() { impl_->Render(); });
@@ -26,25 +25,52 @@ void PangolinWindow::Quit() {
         impl_->exit_flag_.store(true);
         // common::options::lio::flg_exit = true;
         impl_->render_thread_.join();
+
+        const UiQueueStats stats = GetQueueStats();
+        LOG(INFO) << "ui queues: nav states pushed " << stats.nav_pushed_ << ", decimated " << stats.nav_decimated_
+                  << ", dropped " << stats.nav_dropped_ << "; gps pushed " << stats.gps_pushed_ << ", dropped "
+                  << stats.gps_dropped_;
     }
     impl_->DeInit();
 }
 
 void PangolinWindow::UpdateNavState(const NavStated& state) {
-    std::unique_lock<std::mutex> lock_lio_res(impl_->mtx_nav_state_);
+    if (impl_->nav_seen_++ % impl_->nav_decimation_.load(std::memory_order_relaxed) != 0) {
+        impl_->nav_decimated_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
 
-    impl_->pose_ = SE3(state.R_, state.p_);
-    impl_->vel_ = state.v_;
-    impl_->bias_acc_ = state.ba_;
-    impl_->bias_gyr_ = state.bg_;
+    PangolinWindowImpl::NavSample sample;
+    sample.pose_ = SE3(state.R_, state.p_);
+    sample.vel_ = state.v_;
+    sample.bias_acc_ = state.ba_;
+    sample.bias_gyr_ = state.bg_;
 
-    impl_->kf_result_need_update_.store(true);
+    if (impl_->nav_queue_.TryPush(sample)) {
+        impl_->nav_pushed_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        impl_->nav_dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
 }
 
 void PangolinWindow::UpdateGps(const GNSS& gps) {
-    std::lock_guard<std::mutex> lock(impl_->mtx_gps_pose_);
-    impl_->gps_pose_ = gps.utm_pose_;
-    impl_->gps_need_update_.store(true);
+    if (impl_->gps_queue_.TryPush(gps.utm_pose_)) {
+        impl_->gps_pushed_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        impl_->gps_dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void PangolinWindow::SetNavStateDecimation(int n) { impl_->nav_decimation_.store(std::max(n, 1)); }
+
+UiQueueStats PangolinWindow::GetQueueStats() const {
+    UiQueueStats stats;
+    stats.nav_pushed_ = impl_->nav_pushed_.load(std::memory_order_relaxed);
+    stats.nav_decimated_ = impl_->nav_decimated_.load(std::memory_order_relaxed);
+    stats.nav_dropped_ = impl_->nav_dropped_.load(std::memory_order_relaxed);
+    stats.gps_pushed_ = impl_->gps_pushed_.load(std::memory_order_relaxed);
+    stats.gps_dropped_ = impl_->gps_dropped_.load(std::memory_order_relaxed);
+    return stats;
 }
 
 bool PangolinWindow::ShouldQuit() { return pangolin::ShouldQuit(); }
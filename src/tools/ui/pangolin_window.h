@@ -5,6 +5,7 @@
 #include "common/gnss.h"
 #include "common/nav_state.h"
 
+#include <cstdint>
 #include <map>
 #include <memory>
 
@@ -12,6 +13,15 @@ namespace imu_gps::ui {
 
 class PangolinWindowImpl;
 
+/// Counters of the queues between the filter thread and the render thread
+struct UiQueueStats {
+    uint64_t nav_pushed_ = 0;     // Nav states handed to the render thread
+    uint64_t nav_decimated_ = 0;  // Nav states skipped on purpose, see SetNavStateDecimation
+    uint64_t nav_dropped_ = 0;    // Nav states lost because the queue was full
+    uint64_t gps_pushed_ = 0;
+    uint64_t gps_dropped_ = 0;
+};
+
 /**
  * @note This class does not directly involve any OpenGL or Pangolin operations, 
  *       and should delegate these tasks to PangolinWindowImpl.
@@ -28,12 +38,18 @@ class PangolinWindow {
     ///       OpenGL/Pangolin-related tasks should be placed in PangolinWindowImpl::Init.
     bool Init();
 
-    /// Update the Kalman filter state
+    /// Update the Kalman filter state, never blocks on the render thread
     void UpdateNavState(const NavStated& state);
 
-    /// Update the GPS positioning results
+    /// Update the GPS positioning results, never blocks on the render thread
     void UpdateGps(const GNSS& gps);
 
+    /// Only forward every n-th nav state to the UI (default 1, every state)
+    void SetNavStateDecimation(int n);
+
+    /// Pushed/decimated/dropped counters, may be called from any thread
+    UiQueueStats GetQueueStats() const;
+
     /// Wait for the display thread to finish and release resources
     void Quit();
 
@@ -1,4 +1,5 @@
 #include <glog/logging.h>
+#include <algorithm>
 #include <string>
 #include <thread>
 
@@ -9,8 +10,6 @@
 
 namespace imu_gps::ui {
 
-using UL = std::unique_lock<std::mutex>;
-
 bool PangolinWindowImpl::Init() {
     // create a window and bind its context to the main thread
     pangolin::CreateWindowAndBind(win_name_, win_width_, win_height_);
@@ -29,10 +28,13 @@ bool PangolinWindowImpl::Init() {
     poses_ui.reset(new ui::UiTrajectory(Vec3f(1.0, 0.0, 0.0)));
 
     /// data log
-    log_vel_.SetLabels(std::vector<std::string>{"vel_x", "vel_y", "vel_z"});
-    log_vel_baselink_.SetLabels(std::vector<std::string>{"baselink_vel_x", "baselink_vel_y", "baselink_vel_z"});
-    log_bias_acc_.SetLabels(std::vector<std::string>{"ba_x", "ba_y", "ba_z"});
-    log_bias_gyr_.SetLabels(std::vector<std::string>{"bg_x", "bg_y", "bg_z"});
+    plot_vel_.labels_ = {"vel_x", "vel_y", "vel_z"};
+    plot_vel_baselink_.labels_ = {"baselink_vel_x", "baselink_vel_y", "baselink_vel_z"};
+    plot_bias_acc_.labels_ = {"ba_x", "ba_y", "ba_z"};
+    plot_bias_gyr_.labels_ = {"bg_x", "bg_y", "bg_z"};
+    for (PlotPanel *panel : {&plot_vel_, &plot_vel_baselink_, &plot_bias_acc_, &plot_bias_gyr_}) {
+        panel->log_.SetLabels(std::vector<std::string>{"i", panel->labels_[0], panel->labels_[1], panel->labels_[2]});
+    }
 
     return true;
 }
@@ -43,39 +45,72 @@ bool PangolinWindowImpl::DeInit() {
 }
 
 bool PangolinWindowImpl::UpdateState() {
-    if (!kf_result_need_update_.load()) {
-        return false;
+    // every state queued since the last frame goes into the plots and the trajectory
+    bool updated = false;
+    NavSample sample;
+    while (nav_queue_.TryPop(sample)) {
+        const SE3 &pose = sample.pose_;
+        const Vec3d &vel = sample.vel_;
+        Vec3d vel_baselink = pose.so3().inverse() * vel;
+
+        // 滤波器状态作曲线图, the plotted DataLogs are rebuilt from the histories by RefreshPlot
+        plot_vel_.history_.Add(vel.cast<float>());
+        plot_vel_baselink_.history_.Add(vel_baselink.cast<float>());
+        plot_bias_acc_.history_.Add(sample.bias_acc_.cast<float>());
+        plot_bias_gyr_.history_.Add(sample.bias_gyr_.cast<float>());
+
+        current_pose_ = pose;
+        poses_ui->AddPt(current_pose_);
+        updated = true;
     }
 
-    std::lock_guard<std::mutex> lock(mtx_nav_state_);
-    Vec3d pos = pose_.translation().eval();
-    Vec3d vel_baselink = pose_.so3().inverse() * vel_;
-    double roll = pose_.angleX();
-    double pitch = pose_.angleY();
-    double yaw = pose_.angleZ();
-
-    // 滤波器状态作曲线图
-    log_vel_.Log(vel_(0), vel_(1), vel_(2));
-    log_vel_baselink_.Log(vel_baselink(0), vel_baselink(1), vel_baselink(2));
-    log_bias_acc_.Log(bias_acc_(0), bias_acc_(1), bias_acc_(2));
-    log_bias_gyr_.Log(bias_gyr_(0), bias_gyr_(1), bias_gyr_(2));
+    return updated;
+}
 
-    current_pose_ = pose_;
-    poses_ui->AddPt(current_pose_);
+bool PangolinWindowImpl::UpdateGps() {
+    bool updated = false;
+    SE3 gps_pose;
+    while (gps_queue_.TryPop(gps_pose)) {
+        traj_gps_ui_->AddPt(gps_pose);
+        updated = true;
+    }
+    return updated;
+}
 
-    kf_result_need_update_.store(false);
-    return false;
+void PangolinWindowImpl::CreatePlotter(PlotPanel &panel, float bottom, float top, float tick_y,
+                                       const pangolin::Colour &background) {
+    panel.plotter_ = std::make_unique<pangolin::Plotter>(&panel.log_, -10, 600, bottom, top, 75, tick_y);
+    panel.plotter_->SetBounds(0.02, 0.98, 0.0, 1.0);
+    panel.plotter_->ClearSeries();
+    for (int i = 0; i < 3; ++i) {
+        panel.plotter_->AddSeries("$0", "$" + std::to_string(i + 1), pangolin::DrawingModeLine,
+                                  pangolin::Colour::Unspecified(), panel.labels_[i]);
+    }
+    panel.plotter_->Track("$0");
+    panel.plotter_->SetBackgroundColour(background);
 }
 
-bool PangolinWindowImpl::UpdateGps() {
-    if (!gps_need_update_.load()) {
-        return false;
+void PangolinWindowImpl::RefreshPlot(PlotPanel &panel) {
+    // hidden plots (menu, or a parent display) cost nothing
+    if (!panel.plotter_->IsShown() || !pangolin::Display(dis_plot_name_).IsShown()) {
+        return;
     }
-    std::lock_guard<std::mutex> lock(mtx_gps_pose_);
 
-    traj_gps_ui_->AddPt(gps_pose_);
-    gps_need_update_.store(false);
-    return true;
+    const pangolin::XYRangef &view = panel.plotter_->GetView();
+    if (panel.history_.NumSamples() == panel.drawn_samples_ && view.x.min == panel.drawn_view_.x.min &&
+        view.x.max == panel.drawn_view_.x.max) {
+        return;
+    }
+
+    // about two points per pixel, min and max of each bucket
+    const size_t max_buckets = std::max(1, panel.plotter_->v.w);
+    panel.log_.Clear();
+    panel.history_.ForEach(view.x.min, view.x.max, max_buckets, [&panel](double x, const Vec3f &v) {
+        panel.log_.Log(float(x), v[0], v[1], v[2]);
+    });
+
+    panel.drawn_samples_ = panel.history_.NumSamples();
+    panel.drawn_view_ = view;
 }
 
 void PangolinWindowImpl::DrawAll() {
@@ -137,30 +172,18 @@ void PangolinWindowImpl::CreateDisplayLayout() {
                                   .AddDisplay(d_cam3d_main);
 
     // OpenGL 'view' of data. We might have many views of the same data.
-    plotter_vel_ = std::make_unique<pangolin::Plotter>(&log_vel_, -10, 600, -11, 11, 75, 2);
-    plotter_vel_->SetBounds(0.02, 0.98, 0.0, 1.0);
-    plotter_vel_->Track("$i");
-    plotter_vel_->SetBackgroundColour(pangolin::Colour(248. / 255., 248. / 255., 255. / 255.));
-    plotter_vel_baselink_ = std::make_unique<pangolin::Plotter>(&log_vel_baselink_, -10, 600, -11, 11, 75, 2);
-    plotter_vel_baselink_->SetBounds(0.02, 0.98, 0.0, 1.0);
-    plotter_vel_baselink_->Track("$i");
-    plotter_vel_baselink_->SetBackgroundColour(pangolin::Colour(1.0, 1.0, 240 / 255.0));
-    plotter_bias_acc_ = std::make_unique<pangolin::Plotter>(&log_bias_acc_, -10, 600, -2.0, 2.0, 75, 0.01);
-    plotter_bias_acc_->SetBounds(0.02, 0.98, 0.0, 1.0);
-    plotter_bias_acc_->Track("$i");
-    plotter_bias_acc_->SetBackgroundColour(pangolin::Colour(255.0 / 255.0, 240.0 / 255.0, 245.0 / 255.0));
-    plotter_bias_gyr_ = std::make_unique<pangolin::Plotter>(&log_bias_gyr_, -10, 600, -0.1, 0.1, 75, 0.01);
-    plotter_bias_gyr_->SetBounds(0.02, 0.98, 0.0, 1.0);
-    plotter_bias_gyr_->Track("$i");
-    plotter_bias_gyr_->SetBackgroundColour(pangolin::Colour(224.0 / 255.0, 255.0 / 255.0, 255.0 / 255.0));
+    CreatePlotter(plot_vel_, -11, 11, 2, pangolin::Colour(248. / 255., 248. / 255., 255. / 255.));
+    CreatePlotter(plot_vel_baselink_, -11, 11, 2, pangolin::Colour(1.0, 1.0, 240 / 255.0));
+    CreatePlotter(plot_bias_acc_, -2.0, 2.0, 0.01, pangolin::Colour(255.0 / 255.0, 240.0 / 255.0, 245.0 / 255.0));
+    CreatePlotter(plot_bias_gyr_, -0.1, 0.1, 0.01, pangolin::Colour(224.0 / 255.0, 255.0 / 255.0, 255.0 / 255.0));
 
     pangolin::View &d_plot = pangolin::Display(dis_plot_name_)
                                  .SetBounds(0.0, 1.0, 0.75, 1.0)
                                  .SetLayout(pangolin::LayoutEqualVertical)
-                                 .AddDisplay(*plotter_bias_acc_)
-                                 .AddDisplay(*plotter_bias_gyr_)
-                                 .AddDisplay(*plotter_vel_)
-                                 .AddDisplay(*plotter_vel_baselink_);
+                                 .AddDisplay(*plot_bias_acc_.plotter_)
+                                 .AddDisplay(*plot_bias_gyr_.plotter_)
+                                 .AddDisplay(*plot_vel_.plotter_)
+                                 .AddDisplay(*plot_vel_baselink_.plotter_);
 
     pangolin::Display(dis_main_name_)
         .SetBounds(0.0, 1.0, pangolin::Attach::Pix(menu_width_), 1.0)
@@ -182,6 +205,7 @@ void PangolinWindowImpl::Render() {
     pangolin::Var<bool> menu_follow_loc("menu.Follow", false, true);
     pangolin::Var<bool> menu_reset_3d_view("menu.Reset 3D View", false, false);
     pangolin::Var<bool> menu_reset_front_view("menu.Set to front View", false, false);
+    pangolin::Var<bool> menu_show_plots("menu.Show Plots", true, true);
 
     // display layout
     CreateDisplayLayout();
@@ -204,8 +228,17 @@ void PangolinWindowImpl::Render() {
             menu_reset_front_view = false;
         }
 
+        if (menu_show_plots.GuiChanged()) {
+            // the 3D view takes the whole width while the plots are hidden
+            pangolin::Display(dis_plot_name_).Show(menu_show_plots);
+            pangolin::Display(dis_3d_name_).SetBounds(0.0, 1.0, 0.0, menu_show_plots ? 0.75 : 1.0);
+        }
+
         PangolinWindowImpl::UpdateState();
         PangolinWindowImpl::UpdateGps();
+        for (PlotPanel *panel : {&plot_vel_, &plot_vel_baselink_, &plot_bias_acc_, &plot_bias_gyr_}) {
+            RefreshPlot(*panel);
+        }
 
         pangolin::Display(dis_3d_main_name_).Activate(s_cam_main_);
         PangolinWindowImpl::DrawAll();
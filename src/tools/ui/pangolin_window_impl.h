@@ -4,12 +4,14 @@
 // Include pangolin
 #include <pangolin/pangolin.h>
 
+#include "common/spsc_ring.h"
 #include "tools/ui/pangolin_window.h"
+#include "tools/ui/plot_history.h"
 #include "tools/ui/ui_car.h"
 #include "tools/ui/ui_trajectory.h"
 
+#include <array>
 #include <atomic>
-#include <mutex>
 #include <string>
 #include <thread>
 
@@ -45,27 +47,34 @@ class PangolinWindowImpl {
     /// Background rendering thread
     std::thread render_thread_;
 
-    /// Some auxiliary locks and atomic variables
-    std::mutex mtx_nav_state_;
-    std::mutex mtx_gps_pose_;
-
     std::atomic<bool> exit_flag_;
 
-    std::atomic<bool> kf_result_need_update_;
-    std::atomic<bool> gps_need_update_;
-
-    /// GPS pose
-    SE3 gps_pose_;
+    /// Filter state as handed over to the render thread
+    struct NavSample {
+        SE3 pose_;
+        Vec3d vel_ = Vec3d::Zero();
+        Vec3d bias_acc_ = Vec3d::Zero();
+        Vec3d bias_gyr_ = Vec3d::Zero();
+    };
+
+    /// Lock-free queues from the filter thread (producer) to the render thread (consumer).
+    /// The render thread drains them once per frame, a full queue drops the new sample.
+    static constexpr size_t nav_queue_size_ = 4096;
+    static constexpr size_t gps_queue_size_ = 1024;
+    SpscRing<NavSample> nav_queue_{nav_queue_size_};
+    SpscRing<SE3> gps_queue_{gps_queue_size_};
+
+    /// Queue counters, written by the producer only
+    std::atomic<int> nav_decimation_{1};
+    uint64_t nav_seen_ = 0;
+    std::atomic<uint64_t> nav_pushed_{0};
+    std::atomic<uint64_t> nav_decimated_{0};
+    std::atomic<uint64_t> nav_dropped_{0};
+    std::atomic<uint64_t> gps_pushed_{0};
+    std::atomic<uint64_t> gps_dropped_{0};
 
     SE3 current_pose_;                 // Current pose
 
-    /// Filter state
-    SE3 pose_;
-    Vec3d vel_;
-    Vec3d bias_acc_;
-    Vec3d bias_gyr_;
-    Vec3d grav_;
-
     //////////////////////////////// Below are related to rendering ///////////////////////////
    private:
     /// Create OpenGL Buffers
@@ -82,6 +91,23 @@ class PangolinWindowImpl {
 
     void RenderLabels();
 
+    /// A filter state plot: the bounded history of a 3-vector and the DataLog its plotter draws
+    struct PlotPanel {
+        PlotHistory history_;
+        pangolin::DataLog log_;  // Envelope of the viewed range of history_, rebuilt by RefreshPlot
+        std::unique_ptr<pangolin::Plotter> plotter_ = nullptr;
+        std::array<std::string, 3> labels_;
+
+        uint64_t drawn_samples_ = 0;  // History size and view range log_ was built for
+        pangolin::XYRangef drawn_view_;
+    };
+
+    /// Create the plotter of a panel, x is the sample index
+    void CreatePlotter(PlotPanel &panel, float bottom, float top, float tick_y, const pangolin::Colour &background);
+
+    /// Rebuild the DataLog of a shown panel from its history when new samples arrived or its view changed
+    void RefreshPlot(PlotPanel &panel);
+
    private:
     /// Window layout-related parameters
     int win_width_ = 1920;
@@ -112,16 +138,11 @@ class PangolinWindowImpl {
     std::shared_ptr<ui::UiTrajectory> traj_gps_ui_ = nullptr;
     std::shared_ptr<ui::UiTrajectory> poses_ui = nullptr;
 
-    // Filter state-related Data logger object
-    pangolin::DataLog log_vel_;           // Velocity in odom frame
-    pangolin::DataLog log_vel_baselink_;  // Velocity in baselink frame
-    pangolin::DataLog log_bias_acc_;      //
-    pangolin::DataLog log_bias_gyr_;      //
-
-    std::unique_ptr<pangolin::Plotter> plotter_vel_ = nullptr;
-    std::unique_ptr<pangolin::Plotter> plotter_vel_baselink_ = nullptr;
-    std::unique_ptr<pangolin::Plotter> plotter_bias_acc_ = nullptr;
-    std::unique_ptr<pangolin::Plotter> plotter_bias_gyr_ = nullptr;
+    // Filter state plots
+    PlotPanel plot_vel_;           // Velocity in odom frame
+    PlotPanel plot_vel_baselink_;  // Velocity in baselink frame
+    PlotPanel plot_bias_acc_;      //
+    PlotPanel plot_bias_gyr_;      //
 };
 
 }  // namespace imu_gps::ui
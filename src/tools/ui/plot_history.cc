@@ -0,0 +1,60 @@
+#include "tools/ui/plot_history.h"
+
+#include <algorithm>
+
+namespace imu_gps::ui {
+
+PlotHistory::PlotHistory(size_t capacity, int num_levels, int factor) {
+    levels_.resize(std::max(1, num_levels));
+    uint64_t width = 1;
+    for (auto& level : levels_) {
+        level.width_ = width;
+        level.ring_.resize(std::max<size_t>(1, capacity));
+        width *= std::max(2, factor);
+    }
+}
+
+void PlotHistory::Add(const Vec3f& v) {
+    const uint64_t x = num_samples_++;
+    last_ = v;
+
+    for (auto& level : levels_) {
+        Bucket& b = level.pending_;
+        if (level.num_pending_ == 0) {
+            b.x_ = x;
+            b.min_ = v;
+            b.max_ = v;
+        } else {
+            b.min_ = b.min_.cwiseMin(v);
+            b.max_ = b.max_.cwiseMax(v);
+        }
+
+        if (++level.num_pending_ < level.width_) {
+            continue;
+        }
+
+        // the bucket is complete, move it into the ring, over the oldest one if full
+        if (level.size_ < level.ring_.size()) {
+            level.ring_[(level.head_ + level.size_) % level.ring_.size()] = b;
+            ++level.size_;
+        } else {
+            level.ring_[level.head_] = b;
+            level.head_ = (level.head_ + 1) % level.ring_.size();
+        }
+        level.num_pending_ = 0;
+    }
+}
+
+const PlotHistory::Level& PlotHistory::SelectLevel(double x0, double x1, size_t max_buckets) const {
+    const double first = std::max(x0, 0.0);
+    const double span = std::max(1.0, std::min(x1, double(num_samples_)) - first);
+    for (const auto& level : levels_) {
+        const bool covers = level.NumBuckets() > 0 && double(level.At(0).x_) <= first;
+        if (covers && span / double(level.width_) <= double(max_buckets)) {
+            return level;
+        }
+    }
+    return levels_.back();
+}
+
+}  // namespace imu_gps::ui
@@ -0,0 +1,109 @@
+#ifndef IMU_GPS_UI_PLOT_HISTORY_H
+#define IMU_GPS_UI_PLOT_HISTORY_H
+
+#include "common/eigen_types.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace imu_gps::ui {
+
+/**
+ * Bounded, multi-resolution history of a 3-channel curve, x being the sample index.
+ *
+ * Level 0 keeps the last capacity samples, level k the last capacity buckets of factor^k samples, each as their
+ * per-channel min and max. Adding a sample costs one update per level and memory stays at levels * capacity buckets
+ * whatever the run length. A range is read from the finest level that still covers it with at most max_buckets
+ * buckets, so zoomed-out views stay as cheap as zoomed-in ones and keep the peaks of the decimated samples.
+ */
+class PlotHistory {
+   public:
+    explicit PlotHistory(size_t capacity = 2048, int num_levels = 6, int factor = 8);
+
+    /// Append a sample, its x is NumSamples() before the call
+    void Add(const Vec3f& v);
+
+    uint64_t NumSamples() const { return num_samples_; }
+
+    /**
+     * Visit the envelope of [x0, x1] as points f(x, value), in increasing x:
+     * every sample of level 0, or the min then the max of every bucket of a coarser level.
+     * The last sample is always visited, so that plots tracking the newest x keep following it.
+     */
+    template <typename F>
+    void ForEach(double x0, double x1, size_t max_buckets, F&& f) const;
+
+   private:
+    struct Bucket {
+        uint64_t x_ = 0;  // Index of the first sample
+        Vec3f min_ = Vec3f::Zero();
+        Vec3f max_ = Vec3f::Zero();
+    };
+
+    /// Ring of the last buckets of one width, and the bucket being filled
+    struct Level {
+        uint64_t width_ = 1;  // Samples per bucket
+        std::vector<Bucket> ring_;
+        size_t head_ = 0;  // Oldest bucket
+        size_t size_ = 0;
+        Bucket pending_;
+        uint64_t num_pending_ = 0;  // Samples in pending_
+
+        /// i-th bucket from the oldest, the pending bucket last
+        size_t NumBuckets() const { return size_ + (num_pending_ > 0 ? 1 : 0); }
+        const Bucket& At(size_t i) const { return i < size_ ? ring_[(head_ + i) % ring_.size()] : pending_; }
+    };
+
+    /// Finest level that covers [x0, x1] with at most max_buckets buckets, the coarsest one if none does
+    const Level& SelectLevel(double x0, double x1, size_t max_buckets) const;
+
+    std::vector<Level> levels_;
+    uint64_t num_samples_ = 0;
+    Vec3f last_ = Vec3f::Zero();
+};
+
+template <typename F>
+void PlotHistory::ForEach(double x0, double x1, size_t max_buckets, F&& f) const {
+    if (num_samples_ == 0) {
+        return;
+    }
+
+    const Level& level = SelectLevel(x0, x1, max_buckets);
+    const size_t n = level.NumBuckets();
+
+    // first bucket that ends after x0
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        if (double(level.At(mid).x_ + level.width_) <= x0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    uint64_t last_x = 0;
+    bool visited = false;
+    for (size_t i = lo; i < n && double(level.At(i).x_) <= x1; ++i) {
+        const Bucket& b = level.At(i);
+        if (level.width_ == 1) {
+            f(double(b.x_), b.min_);
+            last_x = b.x_;
+        } else {
+            // partial pending bucket: end at its last sample
+            const uint64_t width = i < level.size_ ? level.width_ : level.num_pending_;
+            f(double(b.x_), b.min_);
+            f(double(b.x_ + width / 2), b.max_);
+            last_x = b.x_ + width / 2;
+        }
+        visited = true;
+    }
+
+    if (!visited || last_x < num_samples_ - 1) {
+        f(double(num_samples_ - 1), last_);
+    }
+}
+
+}  // namespace imu_gps::ui
+
+#endif  // IMU_GPS_UI_PLOT_HISTORY_H
@@ -2,28 +2,102 @@
 
 namespace imu_gps::ui {
 
+namespace {
+
+/// Draw count vertices of the bound vertex buffer starting at first
+void DrawRange(GLenum mode, int first, int count) {
+    if (count <= 0) {
+        return;
+    }
+    glDrawArrays(mode, first, count);
+}
+
+}  // namespace
+
+void UiTrajectory::Upload(const Vec3f* pts, int num, int slot) {
+    vbo_.Upload(pts, num * sizeof(Vec3f), slot * sizeof(Vec3f));
+}
+
 void UiTrajectory::AddPt(const SE3& pose) {
-    pos_.emplace_back(pose.translation().cast<float>());
-    if (pos_.size() > max_size_) {
-        pos_.erase(pos_.begin(), pos_.begin() + pos_.size() / 2);
+    if (!vbo_.IsValid()) {
+        vbo_.Reinitialise(pangolin::GlArrayBuffer, history_size_ + recent_size_, GL_FLOAT, 3, GL_DYNAMIC_DRAW);
+    }
+
+    const Vec3f pt = pose.translation().cast<float>();
+
+    if (num_recent_ < recent_size_) {
+        // ring is not full yet, append
+        recent_[num_recent_] = pt;
+        Upload(&recent_[num_recent_], 1, history_size_ + num_recent_);
+        ++num_recent_;
+        return;
+    }
+
+    // the oldest point leaves the ring, possibly into the history
+    const Vec3f& evicted = recent_[recent_head_];
+    if (num_evicted_++ % decimation_ == 0) {
+        if (history_.size() == history_size_) {
+            CompactHistory();
+        }
+        history_.emplace_back(evicted);
+        Upload(&history_.back(), 1, history_.size() - 1);
     }
-    vbo_ = pangolin::GlBuffer(pangolin::GlArrayBuffer, pos_);
+
+    recent_[recent_head_] = pt;
+    Upload(&recent_[recent_head_], 1, history_size_ + recent_head_);
+    recent_head_ = (recent_head_ + 1) % recent_size_;
+}
+
+void UiTrajectory::CompactHistory() {
+    for (size_t i = 1; 2 * i < history_.size(); ++i) {
+        history_[i] = history_[2 * i];
+    }
+    history_.resize((history_.size() + 1) / 2);
+    decimation_ *= 2;
+    Upload(history_.data(), history_.size(), 0);
 }
 
 void UiTrajectory::Render() {
-    if (!vbo_.IsValid()) {
+    if (!vbo_.IsValid() || num_recent_ == 0) {
         return;
     }
 
     glColor3f(color_[0], color_[1], color_[2]);
 
+    // The ring is drawn oldest first: [head, end) then [0, head).
+    const int hist_n = history_.size();
+    const int ring_first = history_size_ + recent_head_;
+    const int ring_tail = num_recent_ - recent_head_;
+
+    vbo_.Bind();
+    glVertexPointer(vbo_.count_per_element, vbo_.datatype, 0, 0);
+    glEnableClientState(GL_VERTEX_ARRAY);
+
     glLineWidth(3.0);
-    pangolin::RenderVbo(vbo_, GL_LINE_STRIP);
-    glLineWidth(1.0);
+    DrawRange(GL_LINE_STRIP, 0, hist_n);
+    DrawRange(GL_LINE_STRIP, ring_first, ring_tail);
+    DrawRange(GL_LINE_STRIP, history_size_, recent_head_);
 
     glPointSize(5.0);
-    pangolin::RenderVbo(vbo_, GL_POINTS);
+    DrawRange(GL_POINTS, 0, hist_n);
+    DrawRange(GL_POINTS, history_size_, num_recent_);
     glPointSize(1.0);
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    vbo_.Unbind();
+
+    // segments joining the regions: history -> oldest ring point, ring end -> ring start
+    glBegin(GL_LINES);
+    if (hist_n > 0) {
+        glVertex3fv(history_.back().data());
+        glVertex3fv(recent_[recent_head_].data());
+    }
+    if (recent_head_ > 0) {
+        glVertex3fv(recent_[recent_size_ - 1].data());
+        glVertex3fv(recent_[0].data());
+    }
+    glEnd();
+    glLineWidth(1.0);
 }
 
-}  // namespace imu_gps::ui
\ No newline at end of file
+}  // namespace imu_gps::ui
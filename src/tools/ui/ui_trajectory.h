@@ -7,10 +7,22 @@
 
 namespace imu_gps::ui {
 
-/// Trajectory drawing in the UI
+/**
+ * Trajectory drawing in the UI
+ *
+ * The points live in one preallocated GPU buffer made of two regions:
+ *  - [0, history_size_): old points, decimated. Every decimation_-th point leaving the recent ring is appended here.
+ *    When it is full, every other point is dropped and the decimation doubles, so any drive length fits.
+ *  - [history_size_, history_size_ + recent_size_): a ring of the most recent points at full rate.
+ * Adding a point only uploads the slots it touched, the full history is re-uploaded on the (rare) compaction only.
+ * Must be used from the thread that owns the GL context.
+ */
 class UiTrajectory {
    public:
-    UiTrajectory(const Vec3f& color) : color_(color) { pos_.reserve(max_size_); }
+    UiTrajectory(const Vec3f& color) : color_(color) {
+        history_.reserve(history_size_);
+        recent_.resize(recent_size_);
+    }
 
     /// Add a trajectory point
     void AddPt(const SE3& pose);
@@ -20,14 +32,31 @@ class UiTrajectory {
 
     /// Clear the trajectory data
     void Clear() {
-        pos_.clear();
-        pos_.reserve(max_size_);
+        history_.clear();
+        num_recent_ = 0;
+        recent_head_ = 0;
+        num_evicted_ = 0;
+        decimation_ = 1;
         vbo_.Free();
     }
 
    private:
-    int max_size_ = 1e6;           // Maximum number of points recorded
-    std::vector<Vec3f> pos_;       // Trajectory data
+    /// Upload points to the GPU buffer, starting at the given slot
+    void Upload(const Vec3f* pts, int num, int slot);
+
+    /// Drop every other history point and double the decimation
+    void CompactHistory();
+
+    static constexpr int history_size_ = 1 << 16;  // Capacity of the decimated history
+    static constexpr int recent_size_ = 1 << 16;   // Capacity of the full-rate ring
+
+    std::vector<Vec3f> history_;   // Decimated old points, CPU copy of the history region
+    std::vector<Vec3f> recent_;    // CPU copy of the ring region
+    int num_recent_ = 0;           // Valid points in the ring
+    int recent_head_ = 0;          // Slot of the oldest point in the ring once it is full
+    long num_evicted_ = 0;         // Points that left the ring so far
+    int decimation_ = 1;           // History keeps one out of decimation_ evicted points
+
     Vec3f color_ = Vec3f::Zero();  // Color for the trajectory
     pangolin::GlBuffer vbo_;       // GPU vertex buffer information
 };
@@ -2,19 +2,177 @@
 #include "common/math_utils.h"
 #include "utm_convert/utm.h"
 #include <glog/logging.h>
+#include <cmath>
 
 namespace imu_gps {
 
-bool LatLon2UTM(const Vec2d& latlon, UTMCoordinate& utm_coor) {
-    long zone = 0;
-    char char_north = 0;
-    long ret = Convert_Geodetic_To_UTM(
-        latlon[0] * math::kDEG2RAD, latlon[1] * math::kDEG2RAD, &zone,
-        &char_north, &utm_coor.xy_[0], &utm_coor.xy_[1]);
-    utm_coor.zone_ = (int)zone;
-    utm_coor.north_ = char_north == 'N';
+namespace {
 
-    return ret == 0;
+// Constants of thirdparty utm.cc / tranmerc.cc, the expressions are kept as they are there so that the results
+// stay bit-compatible
+constexpr double kPi = 3.14159265358979323e0;
+constexpr double kUtmMinLat = (-80.5 * kPi) / 180.0;
+constexpr double kUtmMaxLat = (84.5 * kPi) / 180.0;
+constexpr double kTmMaxLat = (kPi * 89.99) / 180.0;
+constexpr double kTmMaxDeltaLong = (kPi * 90) / 180.0;
+constexpr double kMinEasting = 100000, kMaxEasting = 900000;
+constexpr double kMinNorthing = 0, kMaxNorthing = 10000000;
+constexpr double kFalseEasting = 500000;
+constexpr double kFalseNorthingSouth = 10000000;
+constexpr double kScale = 0.9996;
+
+}  // namespace
+
+UtmProjector::UtmProjector() {
+    // WGS 84, as in Set_Transverse_Mercator_Parameters
+    const double a = 6378137.0;
+    const double f = 1 / 298.257223563;
+    a_ = a;
+    es_ = 2 * f - f * f;
+    ebs_ = (1 / (1 - es_)) - 1;
+
+    const double b = a * (1 - f);
+    const double tn = (a - b) / (a + b);
+    const double tn2 = tn * tn;
+    const double tn3 = tn2 * tn;
+    const double tn4 = tn3 * tn;
+    const double tn5 = tn4 * tn;
+    ap_ = a * (1.e0 - tn + 5.e0 * (tn2 - tn3) / 4.e0 + 81.e0 * (tn4 - tn5) / 64.e0);
+    bp_ = 3.e0 * a * (tn - tn2 + 7.e0 * (tn3 - tn4) / 8.e0 + 55.e0 * tn5 / 64.e0) / 2.e0;
+    cp_ = 15.e0 * a * (tn2 - tn3 + 3.e0 * (tn4 - tn5) / 4.e0) / 16.0;
+    dp_ = 35.e0 * a * (tn3 - tn4 + 11.e0 * tn5 / 16.e0) / 48.e0;
+    ep_ = 315.e0 * a * (tn4 - tn5) / 512.e0;
+
+    const double origin_lat = 0;
+    tmdo_ = ap_ * origin_lat - bp_ * sin(2.e0 * origin_lat) + cp_ * sin(4.e0 * origin_lat) -
+            dp_ * sin(6.e0 * origin_lat) + ep_ * sin(8.e0 * origin_lat);
+
+    for (int zone = 1; zone <= 60; ++zone) {
+        double cm = zone >= 31 ? (6 * zone - 183) * kPi / 180.0 : (6 * zone + 177) * kPi / 180.0;
+        if (cm > kPi) cm -= (2 * kPi);
+        central_meridian_[zone] = cm;
+    }
+}
+
+int UtmProjector::SelectZone(double& lat, double& lon) {
+    if ((lat < kUtmMinLat) || (lat > kUtmMaxLat) || (lon < -kPi) || (lon > (2 * kPi))) {
+        return 0;
+    }
+
+    if ((lat > -1.0e-9) && (lat < 0)) lat = 0.0;
+    if (lon < 0) lon += (2 * kPi) + 1.0e-10;
+
+    const long lat_deg = (long)(lat * 180.0 / kPi);
+    const long lon_deg = (long)(lon * 180.0 / kPi);
+
+    long zone;
+    if (lon < kPi) {
+        zone = (long)(31 + ((lon * 180.0 / kPi) / 6.0));
+    } else {
+        zone = (long)(((lon * 180.0 / kPi) / 6.0) - 29);
+    }
+    if (zone > 60) zone = 1;
+
+    // UTM special cases (Norway and Svalbard)
+    if ((lat_deg > 55) && (lat_deg < 64) && (lon_deg > -1) && (lon_deg < 3)) zone = 31;
+    if ((lat_deg > 55) && (lat_deg < 64) && (lon_deg > 2) && (lon_deg < 12)) zone = 32;
+    if ((lat_deg > 71) && (lon_deg > -1) && (lon_deg < 9)) zone = 31;
+    if ((lat_deg > 71) && (lon_deg > 8) && (lon_deg < 21)) zone = 33;
+    if ((lat_deg > 71) && (lon_deg > 20) && (lon_deg < 33)) zone = 35;
+    if ((lat_deg > 71) && (lon_deg > 32) && (lon_deg < 42)) zone = 37;
+    return int(zone);
+}
+
+void UtmProjector::Forward(double lat, double lon, int zone, double& easting, double& northing) const {
+    const double cm = central_meridian_[zone];
+    const double false_northing = lat < 0 ? kFalseNorthingSouth : 0;
+
+    if (lon > kPi) lon -= (2 * kPi);
+    double dlam = lon - cm;
+    if (dlam > kPi) dlam -= (2 * kPi);
+    if (dlam < -kPi) dlam += (2 * kPi);
+    if (fabs(dlam) < 2.e-10) dlam = 0.0;
+
+    const double s = sin(lat);
+    const double c = cos(lat);
+    const double c2 = c * c;
+    const double c3 = c2 * c;
+    const double c5 = c3 * c2;
+    const double c7 = c5 * c2;
+    const double t = tan(lat);
+    const double tan2 = t * t;
+    const double tan3 = tan2 * t;
+    const double tan4 = tan3 * t;
+    const double tan5 = tan4 * t;
+    const double tan6 = tan5 * t;
+    const double eta = ebs_ * c2;
+    const double eta2 = eta * eta;
+    const double eta3 = eta2 * eta;
+    const double eta4 = eta3 * eta;
+
+    // radius of curvature in prime vertical and true meridional distance
+    const double sn = a_ / sqrt(1.e0 - es_ * pow(s, 2));
+    const double tmd =
+        ap_ * lat - bp_ * sin(2.e0 * lat) + cp_ * sin(4.e0 * lat) - dp_ * sin(6.e0 * lat) + ep_ * sin(8.e0 * lat);
+
+    // northing
+    const double t1 = (tmd - tmdo_) * kScale;
+    const double t2 = sn * s * c * kScale / 2.e0;
+    const double t3 = sn * s * c3 * kScale * (5.e0 - tan2 + 9.e0 * eta + 4.e0 * eta2) / 24.e0;
+    const double t4 = sn * s * c5 * kScale *
+                      (61.e0 - 58.e0 * tan2 + tan4 + 270.e0 * eta - 330.e0 * tan2 * eta + 445.e0 * eta2 +
+                       324.e0 * eta3 - 680.e0 * tan2 * eta2 + 88.e0 * eta4 - 600.e0 * tan2 * eta3 -
+                       192.e0 * tan2 * eta4) /
+                      720.e0;
+    const double t5 = sn * s * c7 * kScale * (1385.e0 - 3111.e0 * tan2 + 543.e0 * tan4 - tan6) / 40320.e0;
+    northing = false_northing + t1 + pow(dlam, 2.e0) * t2 + pow(dlam, 4.e0) * t3 + pow(dlam, 6.e0) * t4 +
+               pow(dlam, 8.e0) * t5;
+
+    // easting
+    const double t6 = sn * c * kScale;
+    const double t7 = sn * c3 * kScale * (1.e0 - tan2 + eta) / 6.e0;
+    const double t8 = sn * c5 * kScale *
+                      (5.e0 - 18.e0 * tan2 + tan4 + 14.e0 * eta - 58.e0 * tan2 * eta + 13.e0 * eta2 + 4.e0 * eta3 -
+                       64.e0 * tan2 * eta2 - 24.e0 * tan2 * eta3) /
+                      120.e0;
+    const double t9 = sn * c7 * kScale * (61.e0 - 479.e0 * tan2 + 179.e0 * tan4 - tan6) / 5040.e0;
+    easting = kFalseEasting + dlam * t6 + pow(dlam, 3.e0) * t7 + pow(dlam, 5.e0) * t8 + pow(dlam, 7.e0) * t9;
+}
+
+bool UtmProjector::Project(double lat_deg, double lon_deg, UTMCoordinate& utm_coor) const {
+    double lat = lat_deg * math::kDEG2RAD;
+    double lon = lon_deg * math::kDEG2RAD;
+    const int zone = SelectZone(lat, lon);
+    if (zone == 0 || lat > kTmMaxLat) {
+        return false;
+    }
+
+    utm_coor.zone_ = zone;
+    utm_coor.north_ = lat >= 0;
+    Forward(lat, lon, zone, utm_coor.xy_[0], utm_coor.xy_[1]);
+    return utm_coor.xy_[0] >= kMinEasting && utm_coor.xy_[0] <= kMaxEasting && utm_coor.xy_[1] >= kMinNorthing &&
+           utm_coor.xy_[1] <= kMaxNorthing;
+}
+
+size_t UtmProjector::Project(const double* lat_deg, const double* lon_deg, size_t n, double* easting,
+                             double* northing, int* zone, bool* north, bool* valid) const {
+    size_t num_valid = 0;
+    UTMCoordinate utm;
+    for (size_t i = 0; i < n; ++i) {
+        const bool ok = Project(lat_deg[i], lon_deg[i], utm);
+        easting[i] = ok ? utm.xy_[0] : 0;
+        northing[i] = ok ? utm.xy_[1] : 0;
+        if (zone) zone[i] = ok ? utm.zone_ : 0;
+        if (north) north[i] = utm.north_;
+        if (valid) valid[i] = ok;
+        num_valid += ok;
+    }
+    return num_valid;
+}
+
+bool LatLon2UTM(const Vec2d& latlon, UTMCoordinate& utm_coor) {
+    static const UtmProjector projector;
+    return projector.Project(latlon[0], latlon[1], utm_coor);
 }
 
 bool UTM2LatLon(const UTMCoordinate& utm_coor, Vec2d& latlon) {
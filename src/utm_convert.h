@@ -3,8 +3,49 @@
 
 #include "common/gnss.h"
 
+#include <array>
+#include <cstddef>
+
 namespace imu_gps {
 
+/**
+ * WGS 84 latitude/longitude to UTM projection with precomputed constants.
+ *
+ * Gives the same result, bit for bit, as thirdparty Convert_Geodetic_To_UTM (no zone override), but the ellipsoid
+ * and per-zone transverse Mercator parameters are computed once in the constructor instead of on every fix. It also
+ * keeps no global state, so a const projector can be shared between threads.
+ * NOTE: The latitude and longitude units are in degrees.
+ */
+class UtmProjector {
+   public:
+    UtmProjector();
+
+    /// Project one point, false if it is outside the UTM range
+    bool Project(double lat_deg, double lon_deg, UTMCoordinate& utm_coor) const;
+
+    /**
+     * Project n points given as contiguous arrays. The zone, hemisphere and valid outputs may be null.
+     * Invalid points get easting = northing = 0.
+     * @return number of valid points
+     */
+    size_t Project(const double* lat_deg, const double* lon_deg, size_t n, double* easting, double* northing,
+                   int* zone = nullptr, bool* north = nullptr, bool* valid = nullptr) const;
+
+   private:
+    /// Zone of a latitude/longitude in radians, 0 if out of range. May adjust lat and lon as the thirdparty code does.
+    static int SelectZone(double& lat, double& lon);
+
+    /// Transverse Mercator forward projection with the constants of a zone
+    void Forward(double lat, double lon, int zone, double& easting, double& northing) const;
+
+    // ellipsoid constants
+    double a_ = 0, es_ = 0, ebs_ = 0;
+    double ap_ = 0, bp_ = 0, cp_ = 0, dp_ = 0, ep_ = 0;
+    double tmdo_ = 0;  // true meridional distance of the latitude of origin
+
+    std::array<double, 61> central_meridian_{};  // by zone, index 0 unused
+};
+
 /**
  * Calculate UTM pose and 6-DOF pose corresponding to GNSS readings in this
  * book.
@@ -28,7 +69,7 @@ bool ConvertGps2UTM(GNSS& gnss_reading, const Vec2d& antenna_pos,
 bool ConvertGps2UTMOnlyTrans(GNSS& gnss_reading);
 
 /**
- * Convert latitude and longitude to UTM.
+ * Convert latitude and longitude to UTM, through a shared UtmProjector.
  * NOTE: The latitude and longitude units are in degrees.
  * @param latlon
  * @param utm_coor